@@ -19,7 +19,8 @@ struct arena {
 
 #define DEFAULT_STORAGE_SIZE 8
 
-static arena *current_arena;
+//systems running on different threads each have their own current arena
+static __thread arena *current_arena;
 
 arena *get_current_arena()
 {
@@ -78,6 +79,28 @@ void mark_all_free()
 	}
 }
 
+size_t arena_block_count()
+{
+	return get_current_arena()->used_count;
+}
+
+void mark_free_since(size_t count)
+{
+	arena *cur = get_current_arena();
+	if (cur->used_count <= count) {
+		return;
+	}
+	size_t num_free = cur->used_count - count;
+	if (cur->free_storage < cur->free_count + num_free) {
+		cur->free_storage = cur->free_count + num_free;
+		cur->free_blocks = realloc(cur->free_blocks, cur->free_storage * sizeof(void*));
+	}
+	for (; cur->used_count > count; cur->used_count--)
+	{
+		cur->free_blocks[cur->free_count++] = cur->used_blocks[cur->used_count-1];
+	}
+}
+
 void *try_alloc_arena()
 {
 	if (!current_arena || !current_arena->free_count) {
@@ -5,6 +5,7 @@
 */
 #ifndef ARENA_H_
 #define ARENA_H_
+#include <stddef.h>
 
 typedef struct arena arena;
 
@@ -14,5 +15,9 @@ arena *start_new_arena();
 void track_block(void *block);
 void mark_all_free();
 void *try_alloc_arena();
+//Returns the number of blocks currently in use in the current arena
+size_t arena_block_count();
+//Marks blocks that were allocated after arena_block_count returned count as free
+void mark_free_since(size_t count);
 
 #endif //ARENA_H_
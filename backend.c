@@ -5,6 +5,7 @@
 */
 #include "backend.h"
 #include <stdlib.h>
+#include <string.h>
 
 deferred_addr * defer_address(deferred_addr * old_head, uint32_t address, uint8_t *dest)
 {
@@ -51,6 +52,23 @@ void process_deferred(deferred_addr ** head_ptr, void * context, native_addr_fun
 	}
 }
 
+//Forgets all translated code so the code buffer can be reused, generated stubs are left alone
+void discard_translations(cpu_options *opts, uint32_t num_map_chunks)
+{
+	for (uint32_t i = 0; i < num_map_chunks; i++)
+	{
+		free(opts->native_code_map[i].offsets);
+	}
+	memset(opts->native_code_map, 0, sizeof(native_map_slot) * num_map_chunks);
+	uint32_t slots = ram_size(opts) / 1024;
+	for (uint32_t i = 0; i < slots; i++)
+	{
+		free(opts->ram_inst_sizes[i]);
+		opts->ram_inst_sizes[i] = NULL;
+	}
+	remove_deferred_until(&opts->deferred, NULL);
+}
+
 memmap_chunk const *find_map_chunk(uint32_t address, cpu_options *opts, uint16_t flags, uint32_t *size_sum)
 {
 	if (size_sum) {
@@ -98,6 +98,7 @@ typedef struct {
 	uint32_t           max_address;
 	uint32_t           bus_cycles;
 	uint32_t           clock_divider;
+	uint32_t           static_cycles; //running total of cycles added with cycles(), used to size coalesced checks
 	uint32_t           move_pc_off;
 	uint32_t           move_pc_size;
 	int32_t            mem_ptr_off;
@@ -118,10 +119,13 @@ typedef uint8_t * (*native_addr_func)(void * context, uint32_t address);
 deferred_addr * defer_address(deferred_addr * old_head, uint32_t address, uint8_t *dest);
 void remove_deferred_until(deferred_addr **head_ptr, deferred_addr * remove_to);
 void process_deferred(deferred_addr ** head_ptr, void * context, native_addr_func get_native);
+void discard_translations(cpu_options *opts, uint32_t num_map_chunks);
 
 void cycles(cpu_options *opts, uint32_t num);
 void check_cycles_int(cpu_options *opts, uint32_t address);
 void check_cycles(cpu_options * opts);
+uint8_t *check_cycles_ahead(cpu_options *opts, code_ptr *fast_off);
+void patch_cycles_ahead(uint8_t *ahead, uint32_t num);
 void check_code_prologue(code_info *code);
 void log_address(cpu_options *opts, uint32_t address, char * format);
 
@@ -4,6 +4,9 @@
 
 void cycles(cpu_options *opts, uint32_t num)
 {
+	if ((int32_t)num > 0) {
+		opts->static_cycles += num*opts->clock_divider;
+	}
 	if (opts->limit < 0) {
 		sub_ir(&opts->code, num*opts->clock_divider, opts->cycles, SZ_D);
 	} else {
@@ -29,6 +32,39 @@ void check_cycles_int(cpu_options *opts, uint32_t address)
 	*jmp_off = code->cur - (jmp_off+1);
 }
 
+//Emits a test for whether the cycle limit will be reached within a number of cycles
+//that isn't known yet and is filled in later with patch_cycles_ahead
+//Control falls through when it will be reached, otherwise it jumps to the location
+//that the caller writes to fast_off, so the slow path in between needs to be short
+uint8_t *check_cycles_ahead(cpu_options *opts, code_ptr *fast_off)
+{
+	code_info *code = &opts->code;
+	check_alloc_code(code, MAX_INST_LEN*8);
+	uint8_t cc;
+	uint8_t *ahead;
+	mov_rr(code, opts->cycles, opts->scratch1, SZ_D);
+	//placeholder value is large enough to force a 32-bit immediate
+	if (opts->limit < 0) {
+		sub_ir(code, 0x10000, opts->scratch1, SZ_D);
+		ahead = code->cur - sizeof(uint32_t);
+		cmp_ir(code, 1, opts->scratch1, SZ_D);
+		cc = CC_NS;
+	} else {
+		add_ir(code, 0x10000, opts->scratch1, SZ_D);
+		ahead = code->cur - sizeof(uint32_t);
+		cmp_rr(code, opts->scratch1, opts->limit, SZ_D);
+		cc = CC_A;
+	}
+	*fast_off = code->cur+1;
+	jcc(code, cc, code->cur+2);
+	return ahead;
+}
+
+void patch_cycles_ahead(uint8_t *ahead, uint32_t num)
+{
+	memcpy(ahead, &num, sizeof(num));
+}
+
 void retranslate_calc(cpu_options *opts)
 {
 	code_info *code = &opts->code;
@@ -0,0 +1,91 @@
+#include <stdlib.h>
+#include <time.h>
+#include "bench.h"
+#if defined(X86_64) || defined(X86_32)
+#include <x86intrin.h>
+#endif
+
+static const char *component_names[BENCH_NUM_COMPONENTS] = {
+	"m68k", "z80", "vdp", "ym2612", "psg", "sync"
+};
+
+static uint64_t bench_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t bench_host_cycles(void)
+{
+#if defined(X86_64) || defined(X86_32)
+	return __rdtsc();
+#else
+	return bench_ns();
+#endif
+}
+
+bench_state *bench_new(void)
+{
+	bench_state *bench = calloc(1, sizeof(bench_state));
+	//everything not claimed by another component is time spent in the 68K
+	bench->stack[0] = BENCH_M68K;
+	return bench;
+}
+
+void bench_start(bench_state *bench)
+{
+	bench->start_ns = bench_ns();
+	bench->last = bench_host_cycles();
+}
+
+static void bench_charge(bench_state *bench)
+{
+	uint64_t now = bench_host_cycles();
+	bench->cycles[bench->stack[bench->depth]] += now - bench->last;
+	bench->last = now;
+}
+
+void bench_enter(bench_state *bench, uint8_t component)
+{
+	bench_charge(bench);
+	if (bench->depth < BENCH_MAX_DEPTH - 1) {
+		bench->depth++;
+	}
+	bench->stack[bench->depth] = component;
+}
+
+void bench_leave(bench_state *bench)
+{
+	bench_charge(bench);
+	if (bench->depth) {
+		bench->depth--;
+	}
+}
+
+void bench_report(bench_state *bench, FILE *f)
+{
+	bench_charge(bench);
+	double wall = (bench_ns() - bench->start_ns) / 1e9;
+	uint64_t total = 0;
+	for (int i = 0; i < BENCH_NUM_COMPONENTS; i++)
+	{
+		total += bench->cycles[i];
+	}
+	fprintf(f, "{\n\t\"frames\": %u,\n\t\"wall_seconds\": %.6f,\n\t\"fps\": %.3f,\n", bench->frames, wall, wall > 0 ? bench->frames / wall : 0.0);
+#if defined(X86_64) || defined(X86_32)
+	fputs("\t\"cycle_unit\": \"tsc\",\n", f);
+#else
+	fputs("\t\"cycle_unit\": \"ns\",\n", f);
+#endif
+	fprintf(f, "\t\"total_cycles\": %llu,\n\t\"components\": {\n", (unsigned long long)total);
+	for (int i = 0; i < BENCH_NUM_COMPONENTS; i++)
+	{
+		fprintf(f, "\t\t\"%s\": {\"cycles\": %llu, \"percent\": %.2f}%s\n", component_names[i],
+			(unsigned long long)bench->cycles[i], total ? 100.0 * bench->cycles[i] / total : 0.0,
+			i == BENCH_NUM_COMPONENTS - 1 ? "" : ","
+		);
+	}
+	fputs("\t}\n}\n", f);
+	fflush(f);
+}
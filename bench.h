@@ -0,0 +1,34 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+enum {
+	BENCH_M68K,
+	BENCH_Z80,
+	BENCH_VDP,
+	BENCH_YM,
+	BENCH_PSG,
+	BENCH_SYNC,
+	BENCH_NUM_COMPONENTS
+};
+
+#define BENCH_MAX_DEPTH 8
+
+typedef struct {
+	uint64_t cycles[BENCH_NUM_COMPONENTS];
+	uint64_t last;
+	uint64_t start_ns;
+	uint32_t frames;
+	uint8_t  stack[BENCH_MAX_DEPTH];
+	uint8_t  depth;
+} bench_state;
+
+bench_state *bench_new(void);
+void bench_start(bench_state *bench);
+void bench_enter(bench_state *bench, uint8_t component);
+void bench_leave(bench_state *bench);
+void bench_report(bench_state *bench, FILE *f);
+
+#endif //BENCH_H_
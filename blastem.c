@@ -34,8 +34,6 @@
 #endif
 
 int headless = 0;
-int exit_after = 0;
-int z80_enabled = 1;
 int frame_limit = 0;
 uint8_t use_native_states = 1;
 
@@ -62,6 +60,7 @@ int load_smd_rom(long filesize, FILE * f, void **buffer)
 		}
 		filesize -= SMD_BLOCK_SIZE;
 	}
+	fclose(f);
 	return rom_size;
 }
 
@@ -95,6 +94,12 @@ uint32_t load_rom(char * filename, void **dst, system_type *stype)
 			return load_smd_rom(filesize, f, dst);
 		}
 	}
+	//plain images are mapped rather than read, the byteswap then only has to touch each page once
+	*dst = map_file_private(f, filesize, nearest_pow2(filesize));
+	if (*dst) {
+		fclose(f);
+		return filesize;
+	}
 	*dst = malloc(nearest_pow2(filesize));
 	if (filesize != fread(*dst, 1, filesize, f)) {
 		fatal_error("Error reading from %s\n", filename);
@@ -112,7 +117,6 @@ char *save_state_path;
 
 
 
-char * save_filename;
 system_header *current_system;
 system_header *menu_system;
 system_header *game_system;
@@ -158,8 +162,8 @@ void setup_saves(system_media *media, rom_info *info, system_header *context)
 	static uint8_t persist_save_registered;
 	char *save_dir = get_save_dir(info->is_save_lock_on ? media->chain : media);
 	char const *parts[] = {save_dir, PATH_SEP, info->save_type == SAVE_I2C ? "save.eeprom" : info->save_type == SAVE_NOR ? "save.nor" : "save.sram"};
-	free(save_filename);
-	save_filename = alloc_concat_m(3, parts);
+	free(context->save_filename);
+	context->save_filename = alloc_concat_m(3, parts);
 	if (info->is_save_lock_on) {
 		//initial save dir was calculated based on lock-on cartridge because that's where the save device is
 		//save directory used for save states should still be located in the normal place
@@ -251,6 +255,8 @@ int main(int argc, char ** argv)
 	uint8_t start_in_debugger = 0;
 	uint8_t fullscreen = FULLSCREEN_DEFAULT, use_gl = 1;
 	uint8_t debug_target = 0;
+	uint32_t exit_after = 0;
+	bench_state *bench = NULL;
 	for (int i = 1; i < argc; i++) {
 		if (argv[i][0] == '-') {
 			switch(argv[i][1]) {
@@ -262,6 +268,22 @@ int main(int argc, char ** argv)
 				headless = 1;
 				exit_after = atoi(argv[i]);
 				break;
+			case '-':
+				if (!strcmp(argv[i] + 2, "benchmark")) {
+					i++;
+					if (i >= argc) {
+						fatal_error("--benchmark must be followed by a frame count\n");
+					}
+					headless = 1;
+					exit_after = atoi(argv[i]);
+					if (!exit_after) {
+						fatal_error("--benchmark frame count must be greater than zero\n");
+					}
+					bench = bench_new();
+				} else {
+					fatal_error("Unrecognized switch %s\n", argv[i]);
+				}
+				break;
 			case 'd':
 				start_in_debugger = 1;
 				//allow debugging the menu
@@ -282,13 +304,24 @@ int main(int argc, char ** argv)
 				break;
 			case 'l':
 				opts |= OPT_ADDRESS_LOG;
+				//-lr adds register changes, -lm adds memory writes
+				for (char *mod = argv[i] + 2; *mod; mod++)
+				{
+					if (*mod == 'r') {
+						opts |= OPT_LOG_REGS;
+					} else if (*mod == 'm') {
+						opts |= OPT_LOG_MEM;
+					} else {
+						fatal_error("Unrecognized switch %s\n", argv[i]);
+					}
+				}
 				break;
 			case 'v':
 				info_message("blastem %s\n", BLASTEM_VERSION);
 				return 0;
 				break;
 			case 'n':
-				z80_enabled = 0;
+				opts |= OPT_NO_Z80;
 				break;
 			case 'r':
 				i++;
@@ -359,8 +392,12 @@ int main(int argc, char ** argv)
 					"	-d          Enter debugger on startup\n"
 					"	-n          Disable Z80\n"
 					"	-v          Display version number and exit\n"
-					"	-l          Log 68K code addresses (useful for assemblers)\n"
+					"	-l          Log 68K code addresses to address.trace, tracedump converts it to text\n"
+					"	-lr         Also log every executed instruction along with register changes\n"
+					"	-lm         Also log memory writes, can be combined with r as -lrm\n"
 					"	-y          Log individual YM-2612 channels to WAVE files\n"
+					"	--benchmark N  Run N frames with no video or audio output and a fixed\n"
+					"	               input script, then print a JSON timing report\n"
 				);
 				return 0;
 			default:
@@ -455,6 +492,7 @@ int main(int argc, char ** argv)
 	} else if (state_format && strcmp(state_format, "native")) {
 		warning("%s is not a valid value for the ui.state_format setting. Valid values are gst and native\n", state_format);
 	}
+	uint8_t warm_switch = !strcmp("on", tern_find_path_default(config, "system\0warm_switch\0", (tern_val){.ptrval = "on"}, TVAL_PTR).ptrval);
 	setup_saves(&cart, &info, current_system);
 	update_title(info.name);
 	if (menu) {
@@ -465,6 +503,11 @@ int main(int argc, char ** argv)
 
 	current_system->debugger_type = dtype;
 	current_system->enter_debugger = start_in_debugger && menu == debug_target;
+	current_system->exit_after = exit_after;
+	current_system->bench = bench;
+	if (bench) {
+		bench_start(bench);
+	}
 	current_system->start_context(current_system,  menu ? NULL : statefile);
 	for(;;)
 	{
@@ -476,12 +519,10 @@ int main(int argc, char ** argv)
 			current_system->next_rom = NULL;
 			if (game_system) {
 				game_system->persist_save(game_system);
-				//swap to game context arena and mark all allocated pages in it free
+				//swap to game context arena
 				if (menu) {
 					current_system->arena = set_current_arena(game_system->arena);
 				}
-				mark_all_free();
-				game_system->free_context(game_system);
 			} else {
 				//start a new arena and save old one in suspended genesis context
 				current_system->arena = start_new_arena();
@@ -502,8 +543,21 @@ int main(int argc, char ** argv)
 			if (stype == SYSTEM_UNKNOWN) {
 				fatal_error("Failed to detect system type for %s\n", next_rom);
 			}
-			//allocate new system context
-			game_system = alloc_config_system(stype, &cart, opts,force_region, &info);
+			system_header *reloaded = NULL;
+			if (game_system && warm_switch) {
+				reloaded = reload_config_system(game_system, stype, &cart, opts, force_region, &info);
+			}
+			if (reloaded) {
+				game_system = reloaded;
+			} else {
+				if (game_system) {
+					//mark all allocated pages in the game arena free
+					mark_all_free();
+					game_system->free_context(game_system);
+				}
+				//allocate new system context
+				game_system = alloc_config_system(stype, &cart, opts,force_region, &info);
+			}
 			if (!game_system) {
 				fatal_error("Failed to configure emulated machine for %s\n", next_rom);
 			}
@@ -5,6 +5,7 @@
 */
 #include "tern.h"
 #include "util.h"
+#include "hash.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -88,6 +89,214 @@ tern_node *parse_config(char * config_data)
 	return parse_config_int(&config_data, 0, &line);
 }
 
+#define CONFIG_CACHE_MAGIC "BCFG"
+#define CONFIG_CACHE_VERSION 2
+#define CONFIG_CACHE_DIR "blastem" PATH_SEP "config_cache"
+#define SHA1_SIZE 20
+
+//Compiled form of a parsed config file, stored in the user data directory so later launches
+//can skip tokenizing and rebuild the tree with a single pass. It is only used while the
+//contents of the source file still match the hash it was built from
+typedef struct {
+	char     magic[4];
+	uint32_t version;
+	uint8_t  source_hash[SHA1_SIZE];
+	uint32_t num_nodes;
+	uint32_t strings_size;
+	uint32_t root;
+} config_cache_header;
+
+//node references are 1-based indices with 0 for NULL, string values are 1-based offsets
+typedef struct {
+	uint32_t left;
+	uint32_t right;
+	uint32_t straight;
+	char     el;
+	uint8_t  valtype;
+} config_cache_node;
+
+typedef struct {
+	config_cache_node *nodes;
+	char              *strings;
+	uint32_t          num_nodes;
+	uint32_t          node_storage;
+	uint32_t          strings_size;
+	uint32_t          string_storage;
+	uint8_t           unsupported;
+} config_cache_builder;
+
+static uint32_t cache_add_string(config_cache_builder *builder, char *str)
+{
+	uint32_t len = strlen(str) + 1;
+	if (builder->strings_size + len > builder->string_storage) {
+		builder->string_storage = builder->string_storage ? builder->string_storage * 2 : 4096;
+		if (builder->string_storage < builder->strings_size + len) {
+			builder->string_storage = builder->strings_size + len;
+		}
+		builder->strings = realloc(builder->strings, builder->string_storage);
+	}
+	memcpy(builder->strings + builder->strings_size, str, len);
+	builder->strings_size += len;
+	return builder->strings_size - len + 1;
+}
+
+static uint32_t cache_add_node(config_cache_builder *builder, tern_node *node)
+{
+	if (!node) {
+		return 0;
+	}
+	if (builder->num_nodes == builder->node_storage) {
+		builder->node_storage = builder->node_storage ? builder->node_storage * 2 : 1024;
+		builder->nodes = realloc(builder->nodes, builder->node_storage * sizeof(config_cache_node));
+	}
+	uint32_t index = builder->num_nodes++;
+	config_cache_node out = {
+		.el = node->el,
+		.valtype = node->valtype
+	};
+	out.left = cache_add_node(builder, node->left);
+	out.right = cache_add_node(builder, node->right);
+	if (node->el) {
+		out.straight = cache_add_node(builder, node->straight.next);
+	} else if (node->valtype == TVAL_NODE) {
+		out.straight = cache_add_node(builder, node->straight.value.ptrval);
+	} else if (node->valtype == TVAL_PTR) {
+		out.straight = cache_add_string(builder, node->straight.value.ptrval);
+	} else {
+		builder->unsupported = 1;
+	}
+	builder->nodes[index] = out;
+	return index + 1;
+}
+
+static void write_config_cache(char *cache_path, tern_node *config, uint8_t *source_hash)
+{
+	config_cache_builder builder = {0};
+	uint32_t root = cache_add_node(&builder, config);
+	if (!builder.unsupported) {
+		char *tmp_path = alloc_concat(cache_path, ".tmp");
+		FILE *f = fopen(tmp_path, "wb");
+		if (f) {
+			config_cache_header header = {
+				.version = CONFIG_CACHE_VERSION,
+				.num_nodes = builder.num_nodes,
+				.strings_size = builder.strings_size,
+				.root = root
+			};
+			memcpy(header.magic, CONFIG_CACHE_MAGIC, sizeof(header.magic));
+			memcpy(header.source_hash, source_hash, sizeof(header.source_hash));
+			uint8_t ok = fwrite(&header, sizeof(header), 1, f) == 1
+				&& fwrite(builder.nodes, sizeof(config_cache_node), builder.num_nodes, f) == builder.num_nodes
+				&& fwrite(builder.strings, 1, builder.strings_size, f) == builder.strings_size;
+			ok = !fclose(f) && ok;
+			if (!ok || rename(tmp_path, cache_path)) {
+				remove(tmp_path);
+			}
+		}
+		free(tmp_path);
+	}
+	free(builder.nodes);
+	free(builder.strings);
+}
+
+static tern_node *read_config_cache(char *cache_path, uint8_t *source_hash)
+{
+	FILE *f = fopen(cache_path, "rb");
+	if (!f) {
+		return NULL;
+	}
+	tern_node *ret = NULL;
+	config_cache_header header;
+	if (fread(&header, sizeof(header), 1, f) != 1
+		|| memcmp(header.magic, CONFIG_CACHE_MAGIC, sizeof(header.magic))
+		|| header.version != CONFIG_CACHE_VERSION
+		|| memcmp(header.source_hash, source_hash, sizeof(header.source_hash))
+		|| !header.root || header.root > header.num_nodes
+	) {
+		goto done;
+	}
+	long expected = sizeof(header) + (long)header.num_nodes * sizeof(config_cache_node) + header.strings_size;
+	if (file_size(f) != expected) {
+		goto done;
+	}
+	fseek(f, sizeof(header), SEEK_SET);
+	config_cache_node *nodes = malloc(header.num_nodes * sizeof(config_cache_node));
+	//string storage is referenced by the returned tree so it is never freed, just like strdup'd values
+	char *strings = malloc(header.strings_size);
+	tern_node *out = malloc(header.num_nodes * sizeof(tern_node));
+	if (
+		fread(nodes, sizeof(config_cache_node), header.num_nodes, f) != header.num_nodes
+		|| fread(strings, 1, header.strings_size, f) != header.strings_size
+	) {
+		goto fail;
+	}
+	for (uint32_t i = 0; i < header.num_nodes; i++)
+	{
+		config_cache_node *node = nodes + i;
+		if (node->left > header.num_nodes || node->right > header.num_nodes) {
+			goto fail;
+		}
+		out[i].left = node->left ? out + node->left - 1 : NULL;
+		out[i].right = node->right ? out + node->right - 1 : NULL;
+		out[i].el = node->el;
+		out[i].valtype = node->valtype;
+		if (node->el || node->valtype == TVAL_NODE) {
+			if (node->straight > header.num_nodes) {
+				goto fail;
+			}
+			out[i].straight.next = node->straight ? out + node->straight - 1 : NULL;
+		} else if (node->valtype == TVAL_PTR) {
+			if (!node->straight || node->straight > header.strings_size) {
+				goto fail;
+			}
+			out[i].straight.value.ptrval = strings + node->straight - 1;
+		} else {
+			goto fail;
+		}
+	}
+	if (header.strings_size && strings[header.strings_size - 1]) {
+		goto fail;
+	}
+	free(nodes);
+	ret = out + header.root - 1;
+	goto done;
+fail:
+	free(nodes);
+	free(strings);
+	free(out);
+done:
+	fclose(f);
+	return ret;
+}
+
+//Returns the path of the cache for config_path, one file per source path named after its hash.
+//Returns NULL if there is no user data directory
+static char *config_cache_path(char *config_path)
+{
+	char const *userdata = get_userdata_dir();
+	if (!userdata) {
+		return NULL;
+	}
+	char const *dir_pieces[] = {userdata, PATH_SEP, CONFIG_CACHE_DIR};
+	char *dir = alloc_concat_m(3, dir_pieces);
+	if (!ensure_dir_exists(dir)) {
+		free(dir);
+		return NULL;
+	}
+	uint8_t path_hash[SHA1_SIZE];
+	sha1((uint8_t *)config_path, strlen(config_path), path_hash);
+	char name[SHA1_SIZE * 2 + sizeof(".bin")];
+	for (int i = 0; i < SHA1_SIZE; i++)
+	{
+		sprintf(name + i * 2, "%02x", path_hash[i]);
+	}
+	strcat(name, ".bin");
+	char const *pieces[] = {dir, PATH_SEP, name};
+	char *ret = alloc_concat_m(3, pieces);
+	free(dir);
+	return ret;
+}
+
 tern_node *parse_config_file(char *config_path)
 {
 	tern_node * ret = NULL;
@@ -104,8 +313,20 @@ tern_node *parse_config_file(char *config_path)
 		goto config_read_fail;
 	}
 	config_data[config_size] = '\0';
-
-	ret = parse_config(config_data);
+	//hashing is far cheaper than tokenizing, and unlike timestamps it can't miss an edit
+	uint8_t source_hash[SHA1_SIZE];
+	sha1((uint8_t *)config_data, config_size, source_hash);
+	char *cache_path = config_cache_path(config_path);
+	if (cache_path) {
+		ret = read_config_cache(cache_path, source_hash);
+	}
+	if (!ret) {
+		ret = parse_config(config_data);
+		if (ret && cache_path) {
+			write_config_cache(cache_path, ret, source_hash);
+		}
+	}
+	free(cache_path);
 config_read_fail:
 	free(config_data);
 config_empty:
@@ -116,6 +337,18 @@ open_fail:
 
 tern_node *parse_bundled_config(char *config_name)
 {
+#ifndef __ANDROID__
+	//bundled files are plain files next to the executable so they can use the compiled cache too
+	char *exe_dir = get_exe_dir();
+	if (!exe_dir) {
+		return NULL;
+	}
+	char const *pieces[] = {exe_dir, PATH_SEP, config_name};
+	char *path = alloc_concat_m(3, pieces);
+	tern_node *ret = parse_config_file(path);
+	free(path);
+	return ret;
+#else
 	uint32_t confsize;
 	char *confdata = read_bundled_file(config_name, &confsize);
 	tern_node *ret = NULL;
@@ -125,6 +358,7 @@ tern_node *parse_bundled_config(char *config_name)
 		free(confdata);
 	}
 	return ret;
+#endif
 }
 
 tern_node *load_config()
@@ -14,6 +14,24 @@ static bp_def * breakpoints = NULL;
 static bp_def * zbreakpoints = NULL;
 static uint32_t bp_index = 0;
 static uint32_t zbp_index = 0;
+static watch_def * watchpoints = NULL;
+static uint32_t watch_index = 0;
+
+//The watch ranges themselves live in the 68K context, so a list that outlived its context
+//(e.g. after a warm switch to another ROM) describes watchpoints that no longer exist
+static void drop_stale_watchpoints(m68k_context *context)
+{
+	if (context->num_watchpoints) {
+		return;
+	}
+	while (watchpoints)
+	{
+		watch_def *next = watchpoints->next;
+		free(watchpoints);
+		watchpoints = next;
+	}
+	watch_index = 0;
+}
 
 bp_def ** find_breakpoint(bp_def ** cur, uint32_t address)
 {
@@ -98,6 +116,150 @@ uint32_t m68k_read_long(uint32_t address, m68k_context *context)
 	return m68k_read_word(address, context) << 16 | m68k_read_word(address + 2, context);
 }
 
+static char *skip_spaces(char *cur)
+{
+	while (*cur == ' ') {
+		cur++;
+	}
+	return cur;
+}
+
+static uint8_t parse_operand_size(char **cur, uint8_t default_size)
+{
+	char *s = *cur;
+	if (s[0] == '.' && (s[1] == 'b' || s[1] == 'w' || s[1] == 'l')) {
+		*cur = s + 2;
+		return s[1] == 'b' ? 1 : s[1] == 'w' ? 2 : 4;
+	}
+	return default_size;
+}
+
+//operands use the same syntax as the p command plus hits and immediate values
+static char *parse_cond_operand(char *cur, m68k_cond_operand *op)
+{
+	cur = skip_spaces(cur);
+	char *after;
+	if ((cur[0] == 'd' || cur[0] == 'a') && cur[1] >= '0' && cur[1] <= '7') {
+		op->kind = cur[0] == 'd' ? M68K_COND_DREG : M68K_COND_AREG;
+		op->value = cur[1] - '0';
+		cur += 2;
+		op->size = parse_operand_size(&cur, 4);
+	} else if ((cur[0] == '0' && cur[1] == 'x') || cur[0] == '$') {
+		op->kind = M68K_COND_MEM;
+		op->value = strtoul(cur + (cur[0] == '0' ? 2 : 1), &after, 16);
+		if (after == cur) {
+			return NULL;
+		}
+		cur = after;
+		op->size = parse_operand_size(&cur, 2);
+	} else if (!strncmp(cur, "hits", 4)) {
+		op->kind = M68K_COND_HITS;
+		op->size = 4;
+		cur += 4;
+	} else if (cur[0] == '#' || (cur[0] >= '0' && cur[0] <= '9')) {
+		if (cur[0] == '#') {
+			cur++;
+		}
+		op->kind = M68K_COND_IMMED;
+		op->size = 4;
+		if (cur[0] == '$') {
+			op->value = strtoul(cur + 1, &after, 16);
+		} else {
+			op->value = strtoul(cur, &after, 0);
+		}
+		if (after == cur) {
+			return NULL;
+		}
+		cur = after;
+	} else {
+		return NULL;
+	}
+	return cur;
+}
+
+//Parses conditions of the form "d0.w == #3 && $FF0010.b != 0 && hits > 100"
+static m68k_bp_condition *parse_condition(char *expr)
+{
+	static const struct {
+		char    *text;
+		uint8_t op;
+	} ops[] = {
+		{"==", M68K_COND_EQ},
+		{"!=", M68K_COND_NE},
+		{"<=", M68K_COND_LE},
+		{">=", M68K_COND_GE},
+		{"<", M68K_COND_LT},
+		{">", M68K_COND_GT}
+	};
+	m68k_bp_condition *cond = calloc(1, sizeof(m68k_bp_condition));
+	uint32_t storage = 0;
+	char *cur = expr;
+	for (;;)
+	{
+		if (cond->num_terms == storage) {
+			storage = storage ? storage * 2 : 2;
+			cond->terms = realloc(cond->terms, storage * sizeof(m68k_cond_term));
+		}
+		m68k_cond_term *term = cond->terms + cond->num_terms;
+		cur = parse_cond_operand(cur, &term->left);
+		if (!cur) {
+			break;
+		}
+		cur = skip_spaces(cur);
+		uint32_t i;
+		for (i = 0; i < sizeof(ops)/sizeof(*ops); i++)
+		{
+			size_t len = strlen(ops[i].text);
+			if (!strncmp(cur, ops[i].text, len)) {
+				term->op = ops[i].op;
+				cur += len;
+				break;
+			}
+		}
+		if (i == sizeof(ops)/sizeof(*ops)) {
+			break;
+		}
+		cur = parse_cond_operand(cur, &term->right);
+		if (!cur) {
+			break;
+		}
+		cond->num_terms++;
+		cur = skip_spaces(cur);
+		if (!*cur) {
+			return cond;
+		}
+		if (cur[0] != '&' || cur[1] != '&') {
+			break;
+		}
+		cur += 2;
+	}
+	fprintf(stderr, "Invalid breakpoint condition %s\n", expr);
+	free(cond->terms);
+	free(cond);
+	return NULL;
+}
+
+static void set_condition(m68k_context *context, bp_def *bp, char *expr)
+{
+	m68k_bp_condition *cond = NULL;
+	expr = skip_spaces(expr);
+	if (*expr) {
+		cond = parse_condition(expr);
+		if (!cond) {
+			return;
+		}
+	}
+	if (!m68k_breakpoint_condition(context, bp->address, cond)) {
+		fprintf(stderr, "Condition %s uses memory that can't be checked without side effects\n", expr);
+		return;
+	}
+	if (cond) {
+		printf("68K Breakpoint %d condition set to %s\n", bp->index, expr);
+	} else {
+		printf("68K Breakpoint %d is now unconditional\n", bp->index);
+	}
+}
+
 void debugger_print(m68k_context *context, char format_char, char *param)
 {
 	uint32_t value;
@@ -584,7 +746,22 @@ int run_debugger_command(m68k_context *context, char *input_buf, m68kinst inst,
 	switch(input_buf[0])
 	{
 		case 'c':
-			if (input_buf[1] == 0 || input_buf[1] == 'o' && input_buf[2] == 'n')
+			if (input_buf[1] == 'o' && input_buf[2] == 'n' && input_buf[3] == 'd') {
+				//cond <index> [condition], clears the condition if none is given
+				param = find_param(input_buf);
+				if (!param) {
+					fputs("cond command requires a parameter\n", stderr);
+					break;
+				}
+				char *expr;
+				value = strtol(param, &expr, 10);
+				this_bp = find_breakpoint_idx(&breakpoints, value);
+				if (!*this_bp) {
+					fprintf(stderr, "Breakpoint %d does not exist\n", value);
+					break;
+				}
+				set_condition(context, *this_bp, expr);
+			} else if (input_buf[1] == 0 || input_buf[1] == 'o' && input_buf[2] == 'n')
 			{
 				puts("Continuing");
 				return 0;
@@ -658,7 +835,8 @@ int run_debugger_command(m68k_context *context, char *input_buf, m68kinst inst,
 					fputs("b command requires a parameter\n", stderr);
 					break;
 				}
-				value = strtol(param, NULL, 16);
+				char *expr;
+				value = strtol(param, &expr, 16);
 				insert_breakpoint(context, value, debugger);
 				new_bp = malloc(sizeof(bp_def));
 				new_bp->next = breakpoints;
@@ -667,6 +845,10 @@ int run_debugger_command(m68k_context *context, char *input_buf, m68kinst inst,
 				new_bp->commands = NULL;
 				breakpoints = new_bp;
 				printf("68K Breakpoint %d set at %X\n", new_bp->index, value);
+				//anything after the address is a condition
+				if (*skip_spaces(expr)) {
+					set_condition(context, new_bp, expr);
+				}
 			}
 			break;
 		case 'a':
@@ -694,6 +876,25 @@ int run_debugger_command(m68k_context *context, char *input_buf, m68kinst inst,
 				}
 				debugger_print(context, format_char, param);
 				add_display(&displays, &disp_index, format_char, param);
+			} else if (input_buf[1] == 'w') {
+				param = find_param(input_buf);
+				if (!param) {
+					fputs("dw command requires a parameter\n", stderr);
+					break;
+				}
+				value = atoi(param);
+				watch_def **this_watch = &watchpoints;
+				while (*this_watch && (*this_watch)->index != value) {
+					this_watch = &(*this_watch)->next;
+				}
+				if (!*this_watch) {
+					fprintf(stderr, "Watchpoint %d does not exist\n", value);
+					break;
+				}
+				watch_def *to_remove = *this_watch;
+				*this_watch = to_remove->next;
+				m68k_remove_watchpoint(context, to_remove->start, to_remove->end, to_remove->type);
+				free(to_remove);
 			} else {
 				param = find_param(input_buf);
 				if (!param) {
@@ -708,6 +909,7 @@ int run_debugger_command(m68k_context *context, char *input_buf, m68kinst inst,
 				}
 				new_bp = *this_bp;
 				*this_bp = (*this_bp)->next;
+				remove_breakpoint(context, new_bp->address);
 				if (new_bp->commands) {
 					free(new_bp->commands);
 				}
@@ -812,6 +1014,31 @@ int run_debugger_command(m68k_context *context, char *input_buf, m68kinst inst,
 			}
 			insert_breakpoint(context, after, debugger);
 			return 0;
+		case 'w': {
+			//w - write watchpoint, wr - read watchpoint, wa - access watchpoint
+			uint8_t type = input_buf[1] == 'r' ? M68K_WATCH_READ : input_buf[1] == 'a' ? M68K_WATCH_ACCESS : M68K_WATCH_WRITE;
+			param = find_param(input_buf);
+			if (!param) {
+				fputs("w command requires a parameter\n", stderr);
+				break;
+			}
+			char *len_param;
+			value = strtol(param, &len_param, 16);
+			uint32_t len = strtol(len_param, NULL, 16);
+			if (!len) {
+				len = 1;
+			}
+			watch_def *new_watch = malloc(sizeof(watch_def));
+			new_watch->next = watchpoints;
+			new_watch->start = value & 0xFFFFFF;
+			new_watch->end = new_watch->start + len;
+			new_watch->type = type;
+			new_watch->index = watch_index++;
+			watchpoints = new_watch;
+			m68k_add_watchpoint(context, new_watch->start, new_watch->end, type, debugger);
+			printf("68K Watchpoint %d set on %X-%X\n", new_watch->index, new_watch->start, new_watch->end - 1);
+			break;
+		}
 		case 'v': {
 			genesis_context * gen = context->system;
 			//VDP debug commands
@@ -898,6 +1125,7 @@ void debugger(m68k_context * context, uint32_t address)
 	m68kinst inst;
 
 	init_terminal();
+	drop_stale_watchpoints(context);
 
 	sync_components(context, 0);
 	//probably not necessary, but let's play it safe
@@ -946,6 +1174,8 @@ void debugger(m68k_context * context, uint32_t address)
 		} else {
 			return;
 		}
+	} else if (context->watch_type) {
+		printf("68K Watchpoint hit, %s %X\n", context->watch_access == M68K_WATCH_WRITE ? "write to" : "read from", context->watch_address);
 	} else {
 		remove_breakpoint(context, address);
 	}
@@ -19,6 +19,14 @@ typedef struct bp_def {
 	uint32_t      index;
 } bp_def;
 
+typedef struct watch_def {
+	struct watch_def *next;
+	uint32_t         start;
+	uint32_t         end;
+	uint32_t         index;
+	uint8_t          type;
+} watch_def;
+
 bp_def ** find_breakpoint(bp_def ** cur, uint32_t address);
 bp_def ** find_breakpoint_idx(bp_def ** cur, uint32_t index);
 void add_display(disp_def ** head, uint32_t *index, char format_char, char * param);
@@ -55,6 +55,8 @@ static uint16_t branch_f;
 
 static bp_def * breakpoints = NULL;
 static uint32_t bp_index = 0;
+//watchpoint types for Z2, Z3 and Z4
+static const uint8_t watch_types[] = {M68K_WATCH_WRITE, M68K_WATCH_READ, M68K_WATCH_ACCESS};
 
 
 void hex_32(uint32_t num, char * out)
@@ -209,9 +211,9 @@ void gdb_run_command(m68k_context * context, uint32_t pc, char * command)
 		uint32_t after = pc + (after_pc-pc_ptr)*2;
 
 		if (inst.op == M68K_RTS) {
-			after = (read_dma_value(context->aregs[7]/2) << 16) | read_dma_value(context->aregs[7]/2 + 1);
+			after = (read_dma_value(context->system, context->aregs[7]/2) << 16) | read_dma_value(context->system, context->aregs[7]/2 + 1);
 		} else if (inst.op == M68K_RTE || inst.op == M68K_RTR) {
-			after = (read_dma_value((context->aregs[7]+2)/2) << 16) | read_dma_value((context->aregs[7]+2)/2 + 1);
+			after = (read_dma_value(context->system, (context->aregs[7]+2)/2) << 16) | read_dma_value(context->system, (context->aregs[7]+2)/2 + 1);
 		} else if(m68k_is_branch(&inst)) {
 			if (inst.op == M68K_BCC && inst.extra.cond != COND_TRUE) {
 				branch_f = after;
@@ -250,8 +252,13 @@ void gdb_run_command(m68k_context * context, uint32_t pc, char * command)
 			new_bp->index = bp_index++;
 			breakpoints = new_bp;
 			gdb_send_command("OK");
+		} else if (type <= '4') {
+			char *rest;
+			uint32_t address = strtoul(command+3, &rest, 16);
+			uint32_t len = *rest == ',' ? strtoul(rest+1, NULL, 16) : 1;
+			m68k_add_watchpoint(context, address, address + len, watch_types[type - '2'], gdb_debug_enter);
+			gdb_send_command("OK");
 		} else {
-			//watchpoints are not currently supported
 			gdb_send_command("");
 		}
 		break;
@@ -269,8 +276,13 @@ void gdb_run_command(m68k_context * context, uint32_t pc, char * command)
 				free(to_remove);
 			}
 			gdb_send_command("OK");
+		} else if (type <= '4') {
+			char *rest;
+			uint32_t address = strtoul(command+3, &rest, 16);
+			uint32_t len = *rest == ',' ? strtoul(rest+1, NULL, 16) : 1;
+			m68k_remove_watchpoint(context, address, address + len, watch_types[type - '2']);
+			gdb_send_command("OK");
 		} else {
-			//watchpoints are not currently supported
 			gdb_send_command("");
 		}
 		break;
@@ -433,9 +445,9 @@ void gdb_run_command(m68k_context * context, uint32_t pc, char * command)
 				uint32_t after = pc + (after_pc-pc_ptr)*2;
 
 				if (inst.op == M68K_RTS) {
-					after = (read_dma_value(context->aregs[7]/2) << 16) | read_dma_value(context->aregs[7]/2 + 1);
+					after = (read_dma_value(context->system, context->aregs[7]/2) << 16) | read_dma_value(context->system, context->aregs[7]/2 + 1);
 				} else if (inst.op == M68K_RTE || inst.op == M68K_RTR) {
-					after = (read_dma_value((context->aregs[7]+2)/2) << 16) | read_dma_value((context->aregs[7]+2)/2 + 1);
+					after = (read_dma_value(context->system, (context->aregs[7]+2)/2) << 16) | read_dma_value(context->system, (context->aregs[7]+2)/2 + 1);
 				} else if(m68k_is_branch(&inst)) {
 					if (inst.op == M68K_BCC && inst.extra.cond != COND_TRUE) {
 						branch_f = after;
@@ -478,7 +490,15 @@ void  gdb_debug_enter(m68k_context * context, uint32_t pc)
 {
 	dfprintf(stderr, "Entered debugger at address %X\n", pc);
 	if (expect_break_response) {
-		gdb_send_command("S05");
+		if (context->watch_type) {
+			//report which watchpoint stopped us so gdb can show the changed value
+			char *kind = context->watch_type == M68K_WATCH_WRITE ? "watch" : context->watch_type == M68K_WATCH_READ ? "rwatch" : "awatch";
+			char reply[32];
+			snprintf(reply, sizeof(reply), "T05%s:%X;", kind, context->watch_address);
+			gdb_send_command(reply);
+		} else {
+			gdb_send_command("S05");
+		}
 		expect_break_response = 0;
 	}
 	if ((pc & 0xFFFFFF) == branch_t) {
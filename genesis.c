@@ -6,6 +6,7 @@
 #include "genesis.h"
 #include "blastem.h"
 #include "nor.h"
+#include "save_file.h"
 #include <stdlib.h>
 #include <ctype.h>
 #include <time.h>
@@ -15,6 +16,7 @@
 #include "util.h"
 #include "debug.h"
 #include "gdb_remote.h"
+#include "arena.h"
 #define MCLKS_NTSC 53693175
 #define MCLKS_PAL  53203395
 
@@ -145,22 +147,59 @@ void genesis_deserialize(deserialize_buffer *buf, genesis_context *gen)
 	update_z80_bank_pointer(gen);
 }
 
-uint16_t read_dma_value(uint32_t address)
+uint16_t read_dma_value(system_header *system, uint32_t address)
 {
-	genesis_context *genesis = (genesis_context *)current_system;
+	genesis_context *genesis = (genesis_context *)system;
 	//TODO: Figure out what happens when you try to DMA from weird adresses like IO or banked Z80 area
 	if ((address >= 0xA00000 && address < 0xB00000) || (address >= 0xC00000 && address <= 0xE00000)) {
 		return 0;
 	}
 	
 	//addresses here are word addresses (i.e. bit 0 corresponds to A1), so no need to do multiply by 2
-	return read_word(address * 2, (void **)genesis->m68k->mem_pointers, &genesis->m68k->options->gen, genesis->m68k);
+	address *= 2;
+	cpu_options *opts = &genesis->m68k->options->gen;
+	//DMA reads walk sequentially through one chunk, so remember it rather than searching the memory map per word
+	memmap_chunk const *chunk = genesis->dma_chunk;
+	uint32_t masked = address & opts->address_mask;
+	if (!chunk || masked < chunk->start || masked >= chunk->end) {
+		chunk = find_map_chunk(address, opts, 0, NULL);
+		genesis->dma_chunk = chunk && (chunk->flags & MMAP_READ) && !(chunk->flags & (MMAP_ONLY_ODD|MMAP_ONLY_EVEN)) ? chunk : NULL;
+	}
+	if (genesis->dma_chunk) {
+		uint8_t *base = chunk->flags & MMAP_PTR_IDX ? genesis->m68k->mem_pointers[chunk->ptr_index] : chunk->buffer;
+		if (base) {
+			return *(uint16_t *)(base + ((address - chunk->start) & chunk->mask));
+		}
+	}
+	return read_word(address, (void **)genesis->m68k->mem_pointers, opts, genesis->m68k);
 }
 
 static uint16_t get_open_bus_value(system_header *system)
 {
 	genesis_context *genesis = (genesis_context *)system;
-	return read_dma_value(genesis->m68k->last_prefetch_address/2);
+	return read_dma_value(system, genesis->m68k->last_prefetch_address/2);
+}
+
+//VDP event times only move when the VDP state feeding them changes or once an event has been reached
+//so they are only recomputed when timing_serial changes or the VDP catches up to the earliest one
+static void update_vdp_events(genesis_context *gen)
+{
+	vdp_context *vdp = gen->vdp;
+	if (gen->vdp_events_serial == vdp->timing_serial && vdp->cycles < gen->vdp_events_valid_until) {
+		return;
+	}
+	gen->vdp_events_serial = vdp->timing_serial;
+	gen->next_vint = vdp_next_vint(vdp);
+	gen->next_hint = vdp_next_hint(vdp);
+	gen->frame_end = vdp_cycles_to_frame_end(vdp);
+	uint32_t valid_until = gen->frame_end;
+	if (gen->next_vint < valid_until) {
+		valid_until = gen->next_vint;
+	}
+	if (gen->next_hint < valid_until) {
+		valid_until = gen->next_hint;
+	}
+	gen->vdp_events_valid_until = valid_until;
 }
 
 static void adjust_int_cycle(m68k_context * context, vdp_context * v_context)
@@ -170,24 +209,17 @@ static void adjust_int_cycle(m68k_context * context, vdp_context * v_context)
 	if (context->sync_cycle - context->current_cycle > gen->max_cycles) {
 		context->sync_cycle = context->current_cycle + gen->max_cycles;
 	}
-	context->int_cycle = CYCLE_NEVER;
-	if ((context->status & 0x7) < 6) {
-		uint32_t next_vint = vdp_next_vint(v_context);
-		if (next_vint != CYCLE_NEVER) {
-			context->int_cycle = next_vint;
-			context->int_num = 6;
-		}
-		if ((context->status & 0x7) < 4) {
-			uint32_t next_hint = vdp_next_hint(v_context);
-			if (next_hint != CYCLE_NEVER) {
-				next_hint = next_hint < context->current_cycle ? context->current_cycle : next_hint;
-				if (next_hint < context->int_cycle) {
-					context->int_cycle = next_hint;
-					context->int_num = 4;
-
-				}
-			}
-		}
+	update_vdp_events(gen);
+	uint32_t next_hint = CYCLE_NEVER;
+	if ((context->status & 0x7) < 4 && gen->next_hint != CYCLE_NEVER) {
+		next_hint = gen->next_hint < context->current_cycle ? context->current_cycle : gen->next_hint;
+	}
+	sched_set(&gen->int_events, GEN_EVENT_VINT, (context->status & 0x7) < 6 ? gen->next_vint : CYCLE_NEVER);
+	sched_set(&gen->int_events, GEN_EVENT_HINT, next_hint);
+	uint8_t int_event;
+	context->int_cycle = sched_next(&gen->int_events, &int_event);
+	if (context->int_cycle != CYCLE_NEVER) {
+		context->int_num = int_event == GEN_EVENT_VINT ? 6 : 4;
 	}
 	if (context->int_cycle > context->current_cycle && context->int_pending == INT_PENDING_SR_CHANGE) {
 		context->int_pending = INT_PENDING_NONE;
@@ -247,8 +279,15 @@ static void z80_next_int_pulse(z80_context * z_context)
 static void sync_z80(z80_context * z_context, uint32_t mclks)
 {
 #ifndef NO_Z80
-	if (z80_enabled) {
+	genesis_context *gen = z_context->system;
+	if (gen->z80_enabled) {
+		if (gen->header.bench) {
+			bench_enter(gen->header.bench, BENCH_Z80);
+		}
 		z80_run(z_context, mclks);
+		if (gen->header.bench) {
+			bench_leave(gen->header.bench);
+		}
 	} else
 #endif
 	{
@@ -256,8 +295,32 @@ static void sync_z80(z80_context * z_context, uint32_t mclks)
 	}
 }
 
+static void sync_sound_bench(genesis_context * gen, uint32_t target)
+{
+	bench_state *bench = gen->header.bench;
+	while (target > gen->psg->cycles && target - gen->psg->cycles > MAX_SOUND_CYCLES) {
+		uint32_t cur_target = gen->psg->cycles + MAX_SOUND_CYCLES;
+		bench_enter(bench, BENCH_PSG);
+		psg_run(gen->psg, cur_target);
+		bench_leave(bench);
+		bench_enter(bench, BENCH_YM);
+		ym_run(gen->ym, cur_target);
+		bench_leave(bench);
+	}
+	bench_enter(bench, BENCH_PSG);
+	psg_run(gen->psg, target);
+	bench_leave(bench);
+	bench_enter(bench, BENCH_YM);
+	ym_run(gen->ym, target);
+	bench_leave(bench);
+}
+
 static void sync_sound(genesis_context * gen, uint32_t target)
 {
+	if (gen->header.bench) {
+		sync_sound_bench(gen, target);
+		return;
+	}
 	//printf("YM | Cycle: %d, bpos: %d, PSG | Cycle: %d, bpos: %d\n", gen->ym->current_cycle, gen->ym->buffer_pos, gen->psg->cycles, gen->psg->buffer_pos * 2);
 	while (target > gen->psg->cycles && target - gen->psg->cycles > MAX_SOUND_CYCLES) {
 		uint32_t cur_target = gen->psg->cycles + MAX_SOUND_CYCLES;
@@ -272,16 +335,11 @@ static void sync_sound(genesis_context * gen, uint32_t target)
 	//printf("Target: %d, YM bufferpos: %d, PSG bufferpos: %d\n", target, gen->ym->buffer_pos, gen->psg->buffer_pos * 2);
 }
 
-//TODO: move this inside the system context
-static uint32_t last_frame_num;
-
 //My refresh emulation isn't currently good enough and causes more problems than it solves
 #define REFRESH_EMULATION
 #ifdef REFRESH_EMULATION
 #define REFRESH_INTERVAL 128
 #define REFRESH_DELAY 2
-uint32_t last_sync_cycle;
-uint32_t refresh_counter;
 #endif
 
 #include <limits.h>
@@ -293,28 +351,44 @@ m68k_context * sync_components(m68k_context * context, uint32_t address)
 	genesis_context * gen = context->system;
 	vdp_context * v_context = gen->vdp;
 	z80_context * z_context = gen->z80;
+	if (gen->header.bench) {
+		bench_enter(gen->header.bench, BENCH_SYNC);
+	}
 #ifdef REFRESH_EMULATION
 	//lame estimation of refresh cycle delay
-	refresh_counter += context->current_cycle - last_sync_cycle;
+	gen->refresh_counter += context->current_cycle - gen->last_sync_cycle;
 	if (!gen->bus_busy) {
-		context->current_cycle += REFRESH_DELAY * MCLKS_PER_68K * (refresh_counter / (MCLKS_PER_68K * REFRESH_INTERVAL));
+		context->current_cycle += REFRESH_DELAY * MCLKS_PER_68K * (gen->refresh_counter / (MCLKS_PER_68K * REFRESH_INTERVAL));
 	}
-	refresh_counter = refresh_counter % (MCLKS_PER_68K * REFRESH_INTERVAL);
+	gen->refresh_counter = gen->refresh_counter % (MCLKS_PER_68K * REFRESH_INTERVAL);
 #endif
 
 	uint32_t mclks = context->current_cycle;
 	sync_z80(z_context, mclks);
 	sync_sound(gen, mclks);
-	vdp_run_context(v_context, mclks);
-	if (v_context->frame != last_frame_num) {
+	if (gen->header.bench) {
+		bench_enter(gen->header.bench, BENCH_VDP);
+		vdp_run_context(v_context, mclks);
+		bench_leave(gen->header.bench);
+	} else {
+		vdp_run_context(v_context, mclks);
+	}
+	if (v_context->frame != gen->last_frame_num) {
 		//printf("reached frame end %d | MCLK Cycles: %d, Target: %d, VDP cycles: %d, vcounter: %d, hslot: %d\n", last_frame_num, mclks, gen->frame_end, v_context->cycles, v_context->vcounter, v_context->hslot);
-		last_frame_num = v_context->frame;
+		gen->last_frame_num = v_context->frame;
 
 		wait_render_frame(v_context, 0);
 
-		if(exit_after){
-			--exit_after;
-			if (!exit_after) {
+		if (gen->header.bench) {
+			gen->header.bench->frames++;
+			io_script_input(&gen->io, gen->header.bench->frames);
+		}
+		if(gen->header.exit_after){
+			--gen->header.exit_after;
+			if (!gen->header.exit_after) {
+				if (gen->header.bench) {
+					bench_report(gen->header.bench, stdout);
+				}
 				exit(0);
 			}
 		}
@@ -325,15 +399,19 @@ m68k_context * sync_components(m68k_context * context, uint32_t address)
 			io_adjust_cycles(gen->io.ports+1, context->current_cycle, deduction);
 			io_adjust_cycles(gen->io.ports+2, context->current_cycle, deduction);
 			context->current_cycle -= deduction;
+			if (context->options->address_log) {
+				trace_adjust_cycles(context->options->address_log, deduction);
+			}
 			z80_adjust_cycles(z_context, deduction);
 			gen->ym->current_cycle -= deduction;
 			gen->psg->cycles -= deduction;
+			sched_adjust(&gen->int_events, deduction);
 			if (gen->ym->write_cycle != CYCLE_NEVER) {
 				gen->ym->write_cycle = gen->ym->write_cycle >= deduction ? gen->ym->write_cycle - deduction : 0;
 			}
 		}
 	}
-	gen->frame_end = vdp_cycles_to_frame_end(v_context);
+	update_vdp_events(gen);
 	context->sync_cycle = gen->frame_end;
 	//printf("Set sync cycle to: %d @ %d, vcounter: %d, hslot: %d\n", context->sync_cycle, context->current_cycle, v_context->vcounter, v_context->hslot);
 	if (context->int_ack) {
@@ -341,11 +419,14 @@ m68k_context * sync_components(m68k_context * context, uint32_t address)
 		vdp_int_ack(v_context);
 		context->int_ack = 0;
 	}
-	if (!address && (gen->header.enter_debugger || gen->header.save_state)) {
+	if (!address && (gen->header.enter_debugger || gen->header.save_state || context->watch_handler)) {
 		context->sync_cycle = context->current_cycle + 1;
 	}
 	adjust_int_cycle(context, v_context);
 	if (address) {
+		if (context->watch_handler) {
+			m68k_watch_dispatch(context, address);
+		}
 		if (gen->header.enter_debugger) {
 			gen->header.enter_debugger = 0;
 			debugger(context, address);
@@ -390,8 +471,11 @@ m68k_context * sync_components(m68k_context * context, uint32_t address)
 		}
 	}
 #ifdef REFRESH_EMULATION
-	last_sync_cycle = context->current_cycle;
+	gen->last_sync_cycle = context->current_cycle;
 #endif
+	if (gen->header.bench) {
+		bench_leave(gen->header.bench);
+	}
 	return context;
 }
 
@@ -401,16 +485,16 @@ static m68k_context * vdp_port_write(uint32_t vdp_port, m68k_context * context,
 		fatal_error("machine freeze due to write to address %X\n", 0xC00000 | vdp_port);
 	}
 	vdp_port &= 0x1F;
+	genesis_context * gen = context->system;
 	//printf("vdp_port write: %X, value: %X, cycle: %d\n", vdp_port, value, context->current_cycle);
 #ifdef REFRESH_EMULATION
 	//do refresh check here so we can avoid adding a penalty for a refresh that happens during a VDP access
-	refresh_counter += context->current_cycle - 4*MCLKS_PER_68K - last_sync_cycle;
-	context->current_cycle += REFRESH_DELAY * MCLKS_PER_68K * (refresh_counter / (MCLKS_PER_68K * REFRESH_INTERVAL));
-	refresh_counter = refresh_counter % (MCLKS_PER_68K * REFRESH_INTERVAL);
-	last_sync_cycle = context->current_cycle;
+	gen->refresh_counter += context->current_cycle - 4*MCLKS_PER_68K - gen->last_sync_cycle;
+	context->current_cycle += REFRESH_DELAY * MCLKS_PER_68K * (gen->refresh_counter / (MCLKS_PER_68K * REFRESH_INTERVAL));
+	gen->refresh_counter = gen->refresh_counter % (MCLKS_PER_68K * REFRESH_INTERVAL);
+	gen->last_sync_cycle = context->current_cycle;
 #endif
 	sync_components(context, 0);
-	genesis_context * gen = context->system;
 	vdp_context *v_context = gen->vdp;
 	uint32_t before_cycle = v_context->cycles;
 	if (vdp_port < 0x10) {
@@ -461,7 +545,8 @@ static m68k_context * vdp_port_write(uint32_t vdp_port, m68k_context * context,
 					}
 				}
 			} else {
-				context->sync_cycle = gen->frame_end = vdp_cycles_to_frame_end(v_context);
+				update_vdp_events(gen);
+				context->sync_cycle = gen->frame_end;
 				//printf("Set sync cycle to: %d @ %d, vcounter: %d, hslot: %d\n", context->sync_cycle, context->current_cycle, v_context->vcounter, v_context->hslot);
 				adjust_int_cycle(context, v_context);
 			}
@@ -487,16 +572,16 @@ static m68k_context * vdp_port_write(uint32_t vdp_port, m68k_context * context,
 		vdp_test_port_write(gen->vdp, value);
 	}
 #ifdef REFRESH_EMULATION
-	last_sync_cycle -= 4;
+	gen->last_sync_cycle -= 4;
 	//refresh may have happened while we were waiting on the VDP,
 	//so advance refresh_counter but don't add any delays
 	if (vdp_port >= 4 && vdp_port < 8 && v_context->cycles != before_cycle) {
-		refresh_counter = 0;
+		gen->refresh_counter = 0;
 	} else {
-		refresh_counter += (context->current_cycle - last_sync_cycle);
-		refresh_counter = refresh_counter % (MCLKS_PER_68K * REFRESH_INTERVAL);
+		gen->refresh_counter += (context->current_cycle - gen->last_sync_cycle);
+		gen->refresh_counter = gen->refresh_counter % (MCLKS_PER_68K * REFRESH_INTERVAL);
 	}
-	last_sync_cycle = context->current_cycle;
+	gen->last_sync_cycle = context->current_cycle;
 #endif
 	return context;
 }
@@ -540,16 +625,16 @@ static uint16_t vdp_port_read(uint32_t vdp_port, m68k_context * context)
 		fatal_error("machine freeze due to read from address %X\n", 0xC00000 | vdp_port);
 	}
 	vdp_port &= 0x1F;
+	genesis_context *gen = context->system;
 	uint16_t value;
 #ifdef REFRESH_EMULATION
 	//do refresh check here so we can avoid adding a penalty for a refresh that happens during a VDP access
-	refresh_counter += context->current_cycle - 4*MCLKS_PER_68K - last_sync_cycle;
-	context->current_cycle += REFRESH_DELAY * MCLKS_PER_68K * (refresh_counter / (MCLKS_PER_68K * REFRESH_INTERVAL));
-	refresh_counter = refresh_counter % (MCLKS_PER_68K * REFRESH_INTERVAL);
-	last_sync_cycle = context->current_cycle;
+	gen->refresh_counter += context->current_cycle - 4*MCLKS_PER_68K - gen->last_sync_cycle;
+	context->current_cycle += REFRESH_DELAY * MCLKS_PER_68K * (gen->refresh_counter / (MCLKS_PER_68K * REFRESH_INTERVAL));
+	gen->refresh_counter = gen->refresh_counter % (MCLKS_PER_68K * REFRESH_INTERVAL);
+	gen->last_sync_cycle = context->current_cycle;
 #endif
 	sync_components(context, 0);
-	genesis_context *gen = context->system;
 	vdp_context * v_context = gen->vdp;
 	uint32_t before_cycle = v_context->cycles;
 	if (vdp_port < 0x10) {
@@ -570,18 +655,17 @@ static uint16_t vdp_port_read(uint32_t vdp_port, m68k_context * context)
 		//printf("68K paused for %d (%d) cycles at cycle %d (%d) for read\n", v_context->cycles - context->current_cycle, v_context->cycles - before_cycle, context->current_cycle, before_cycle);
 		context->current_cycle = v_context->cycles;
 		//Lock the Z80 out of the bus until the VDP access is complete
-		genesis_context *gen = context->system;
 		gen->bus_busy = 1;
 		sync_z80(gen->z80, v_context->cycles);
 		gen->bus_busy = 0;
 	}
 #ifdef REFRESH_EMULATION
-	last_sync_cycle -= 4;
+	gen->last_sync_cycle -= 4;
 	//refresh may have happened while we were waiting on the VDP,
 	//so advance refresh_counter but don't add any delays
-	refresh_counter += (context->current_cycle - last_sync_cycle);
-	refresh_counter = refresh_counter % (MCLKS_PER_68K * REFRESH_INTERVAL);
-	last_sync_cycle = context->current_cycle;
+	gen->refresh_counter += (context->current_cycle - gen->last_sync_cycle);
+	gen->refresh_counter = gen->refresh_counter % (MCLKS_PER_68K * REFRESH_INTERVAL);
+	gen->last_sync_cycle = context->current_cycle;
 #endif
 	return value;
 }
@@ -631,16 +715,13 @@ static uint8_t z80_vdp_port_read(uint32_t vdp_port, void * vcontext)
 	return vdp_port & 1 ? ret : ret >> 8;
 }
 
-//TODO: Move this inside the system context
-static uint32_t zram_counter = 0;
-
 static m68k_context * io_write(uint32_t location, m68k_context * context, uint8_t value)
 {
 	genesis_context * gen = context->system;
 	if (location < 0x10000) {
 		//Access to Z80 memory incurs a one 68K cycle wait state
 		context->current_cycle += MCLKS_PER_68K;
-		if (!z80_enabled || z80_get_busack(gen->z80, context->current_cycle)) {
+		if (!gen->z80_enabled || z80_get_busack(gen->z80, context->current_cycle)) {
 			location &= 0x7FFF;
 			if (location < 0x4000) {
 				gen->zram[location & 0x1FFF] = value;
@@ -718,7 +799,7 @@ static m68k_context * io_write(uint32_t location, m68k_context * context, uint8_
 			if (location == 0x1100) {
 				if (value & 1) {
 					dputs("bus requesting Z80");
-					if (z80_enabled) {
+					if (gen->z80_enabled) {
 						z80_assert_busreq(gen->z80, context->current_cycle);
 					} else {
 						gen->z80->busack = 1;
@@ -728,13 +809,13 @@ static m68k_context * io_write(uint32_t location, m68k_context * context, uint8_
 						dputs("releasing z80 bus");
 						#ifdef DO_DEBUG_PRINT
 						char fname[20];
-						sprintf(fname, "zram-%d", zram_counter++);
+						sprintf(fname, "zram-%d", gen->zram_counter++);
 						FILE * f = fopen(fname, "wb");
 						fwrite(z80_ram, 1, sizeof(z80_ram), f);
 						fclose(f);
 						#endif
 					}
-					if (z80_enabled) {
+					if (gen->z80_enabled) {
 						z80_clear_busreq(gen->z80, context->current_cycle);
 					} else {
 						gen->z80->busack = 0;
@@ -743,13 +824,13 @@ static m68k_context * io_write(uint32_t location, m68k_context * context, uint8_
 			} else if (location == 0x1200) {
 				sync_z80(gen->z80, context->current_cycle);
 				if (value & 1) {
-					if (z80_enabled) {
+					if (gen->z80_enabled) {
 						z80_clear_reset(gen->z80, context->current_cycle);
 					} else {
 						gen->z80->reset = 0;
 					}
 				} else {
-					if (z80_enabled) {
+					if (gen->z80_enabled) {
 						z80_assert_reset(gen->z80, context->current_cycle);
 					} else {
 						gen->z80->reset = 1;
@@ -785,7 +866,7 @@ static uint8_t io_read(uint32_t location, m68k_context * context)
 	if (location < 0x10000) {
 		//Access to Z80 memory incurs a one 68K cycle wait state
 		context->current_cycle += MCLKS_PER_68K;
-		if (!z80_enabled || z80_get_busack(gen->z80, context->current_cycle)) {
+		if (!gen->z80_enabled || z80_get_busack(gen->z80, context->current_cycle)) {
 			location &= 0x7FFF;
 			if (location < 0x4000) {
 				value = gen->zram[location & 0x1FFF];
@@ -857,7 +938,7 @@ static uint8_t io_read(uint32_t location, m68k_context * context)
 			}
 		} else {
 			if (location == 0x1100) {
-				value = z80_enabled ? !z80_get_busack(gen->z80, context->current_cycle) : !gen->z80->busack;
+				value = gen->z80_enabled ? !z80_get_busack(gen->z80, context->current_cycle) : !gen->z80->busack;
 				value |= (get_open_bus_value(&gen->header) >> 8) & 0xFE;
 				dprintf("Byte read of BUSREQ returned %d @ %d (reset: %d)\n", value, context->current_cycle, gen->z80->reset);
 			} else if (location == 0x1200) {
@@ -1058,11 +1139,53 @@ static uint8_t load_state(system_header *system, uint8_t slot)
 	return ret;
 }
 
+//Translates the entry points listed in an address map generated ahead of time by trans -m
+static void load_code_map(genesis_context *gen)
+{
+	char *map_template = tern_find_path(config, "system\0code_map_path\0", TVAL_PTR).ptrval;
+	if (!map_template) {
+		return;
+	}
+	tern_node *vars = tern_insert_ptr(NULL, "HOME", get_home_dir());
+	vars = tern_insert_ptr(vars, "EXEDIR", get_exe_dir());
+	vars = tern_insert_ptr(vars, "USERDATA", (char *)get_userdata_dir());
+	char *map_dir = replace_vars(map_template, vars, 1);
+	tern_free(vars);
+	char hex_hash[41];
+	bin_to_hex((uint8_t *)hex_hash, gen->rom_hash, sizeof(gen->rom_hash));
+	char const *parts[] = {map_dir, PATH_SEP, hex_hash, ".map"};
+	char *path = alloc_concat_m(4, parts);
+	free(map_dir);
+	FILE *f = fopen(path, "r");
+	free(path);
+	if (!f) {
+		return;
+	}
+	uint32_t num_entries = 0, entry_storage = 1024;
+	uint32_t *entries = malloc(entry_storage * sizeof(uint32_t));
+	unsigned int address;
+	while (fscanf(f, "%X", &address) == 1)
+	{
+		if (num_entries == entry_storage) {
+			entry_storage *= 2;
+			entries = realloc(entries, entry_storage * sizeof(uint32_t));
+		}
+		entries[num_entries++] = address;
+	}
+	fclose(f);
+	m68k_pretranslate_entries(gen->m68k, entries, num_entries);
+	free(entries);
+}
+
 static void start_genesis(system_header *system, char *statefile)
 {
 	genesis_context *gen = (genesis_context *)system;
 	set_keybindings(&gen->io);
 	render_set_video_standard((gen->version_reg & HZ50) ? VID_PAL : VID_NTSC);
+	if (!strcmp("on", tern_find_path_default(config, "system\0pretranslate\0", (tern_val){.ptrval = "on"}, TVAL_PTR).ptrval)) {
+		m68k_pretranslate(gen->m68k);
+	}
+	load_code_map(gen);
 	if (statefile) {
 		//first try loading as a native format savestate
 		deserialize_buffer state;
@@ -1134,7 +1257,12 @@ static void request_exit(system_header *system)
 static void persist_save(system_header *system)
 {
 	genesis_context *gen = (genesis_context *)system;
-	if (gen->save_type == SAVE_NONE) {
+	if (gen->save_type == SAVE_NONE || !gen->header.save_filename) {
+		return;
+	}
+	char *save_filename = gen->header.save_filename;
+	if (sync_save_file(gen->save_map)) {
+		printf("Saved %s to %s\n", save_type_name(gen->save_type), save_filename);
 		return;
 	}
 	FILE * f = fopen(save_filename, "wb");
@@ -1150,6 +1278,17 @@ static void persist_save(system_header *system)
 static void load_save(system_header *system)
 {
 	genesis_context *gen = (genesis_context *)system;
+	char *save_filename = gen->header.save_filename;
+	if (!save_filename) {
+		return;
+	}
+	uint32_t flush_interval = atoi(tern_find_path_default(config, "system\0save_flush_interval\0", (tern_val){.ptrval = "5"}, TVAL_PTR).ptrval);
+	unmap_save_file(gen->save_map);
+	gen->save_map = map_save_file(save_filename, gen->save_storage, gen->save_size, flush_interval);
+	if (gen->save_map) {
+		printf("Mapped %s from %s\n", save_type_name(gen->save_type), save_filename);
+		return;
+	}
 	FILE * f = fopen(save_filename, "rb");
 	if (f) {
 		uint32_t read = fread(gen->save_storage, 1, gen->save_size, f);
@@ -1170,32 +1309,33 @@ static void soft_reset(system_header *system)
 static void free_genesis(system_header *system)
 {
 	genesis_context *gen = (genesis_context *)system;
+	cleanup_io_devices(&gen->io);
+	if (gen->m68k->options->address_log) {
+		trace_close(gen->m68k->options->address_log);
+	}
 	vdp_free(gen->vdp);
 	m68k_options_free(gen->m68k->options);
-	free(gen->cart);
+	release_file_buffer(gen->cart);
 	free(gen->m68k);
 	free(gen->work_ram);
+#ifndef NO_Z80
+	free((void *)gen->z80->options->gen.memmap);
+#endif
 	z80_options_free(gen->z80->options);
 	free(gen->z80);
 	free(gen->zram);
 	ym_free(gen->ym);
 	psg_free(gen->psg);
-	free(gen->save_storage);
+	unmap_save_file(gen->save_map);
+	free_save_buffer(gen->save_storage, gen->save_size);
 	free(gen->header.save_dir);
-	free(gen->lock_on);
+	free(gen->header.save_filename);
+	release_file_buffer(gen->lock_on);
 	free(gen);
 }
 
-genesis_context *alloc_init_genesis(rom_info *rom, void *main_rom, void *lock_on, uint32_t system_opts, uint8_t force_region)
+static void init_header(genesis_context *gen)
 {
-	static memmap_chunk z80_map[] = {
-		{ 0x0000, 0x4000,  0x1FFF, 0, 0, MMAP_READ | MMAP_WRITE | MMAP_CODE, NULL, NULL, NULL, NULL,              NULL },
-		{ 0x8000, 0x10000, 0x7FFF, 0, 0, 0,                                  NULL, NULL, NULL, z80_read_bank,     z80_write_bank},
-		{ 0x4000, 0x6000,  0x0003, 0, 0, 0,                                  NULL, NULL, NULL, z80_read_ym,       z80_write_ym},
-		{ 0x6000, 0x6100,  0xFFFF, 0, 0, 0,                                  NULL, NULL, NULL, NULL,              z80_write_bank_reg},
-		{ 0x7F00, 0x8000,  0x00FF, 0, 0, 0,                                  NULL, NULL, NULL, z80_vdp_port_read, z80_vdp_port_write}
-	};
-	genesis_context *gen = calloc(1, sizeof(genesis_context));
 	gen->header.set_speed_percent = set_speed_percent;
 	gen->header.start_context = start_genesis;
 	gen->header.resume_context = resume_genesis;
@@ -1209,31 +1349,28 @@ genesis_context *alloc_init_genesis(rom_info *rom, void *main_rom, void *lock_on
 	gen->header.inc_debug_mode = inc_debug_mode;
 	gen->header.inc_debug_pal = inc_debug_pal;
 	gen->header.type = SYSTEM_GENESIS;
-	set_region(gen, rom, force_region);
+}
 
-	gen->vdp = malloc(sizeof(vdp_context));
-	init_vdp_context(gen->vdp, gen->version_reg & 0x40);
-	gen->vdp->system = &gen->header;
-	gen->frame_end = vdp_cycles_to_frame_end(gen->vdp);
+static void init_timing(genesis_context *gen)
+{
+	sched_init(&gen->int_events);
+	gen->vdp_events_valid_until = 0;
+	update_vdp_events(gen);
 	char * config_cycles = tern_find_path(config, "clocks\0max_cycles\0", TVAL_PTR).ptrval;
 	gen->max_cycles = config_cycles ? atoi(config_cycles) : DEFAULT_SYNC_INTERVAL;
 	gen->int_latency_prev1 = MCLKS_PER_68K * 32;
 	gen->int_latency_prev2 = MCLKS_PER_68K * 16;
+}
 
+static uint32_t get_lowpass_cutoff(void)
+{
 	char * lowpass_cutoff_str = tern_find_path(config, "audio\0lowpass_cutoff\0", TVAL_PTR).ptrval;
-	uint32_t lowpass_cutoff = lowpass_cutoff_str ? atoi(lowpass_cutoff_str) : DEFAULT_LOWPASS_CUTOFF;
-	
-	gen->ym = malloc(sizeof(ym2612_context));
-	ym_init(gen->ym, render_sample_rate(), gen->master_clock, MCLKS_PER_YM, render_audio_buffer(), system_opts, lowpass_cutoff);
-
-	gen->psg = malloc(sizeof(psg_context));
-	psg_init(gen->psg, render_sample_rate(), gen->master_clock, MCLKS_PER_PSG, render_audio_buffer(), lowpass_cutoff);
+	return lowpass_cutoff_str ? atoi(lowpass_cutoff_str) : DEFAULT_LOWPASS_CUTOFF;
+}
 
-	gen->zram = calloc(1, Z80_RAM_BYTES);
-	z80_map[0].buffer = gen->zram = calloc(1, Z80_RAM_BYTES);
+static void attach_z80(genesis_context *gen, z80_options *z_opts, void *main_rom)
+{
 #ifndef NO_Z80
-	z80_options *z_opts = malloc(sizeof(z80_options));
-	init_z80_opts(z_opts, z80_map, 5, NULL, 0, MCLKS_PER_Z80, 0xFFFF);
 	gen->z80 = init_z80_context(z_opts);
 	gen->z80->next_int_pulse = z80_next_int_pulse;
 	z80_assert_reset(gen->z80, 0);
@@ -1244,10 +1381,10 @@ genesis_context *alloc_init_genesis(rom_info *rom, void *main_rom, void *lock_on
 	gen->z80->system = gen;
 	gen->z80->mem_pointers[0] = gen->zram;
 	gen->z80->mem_pointers[1] = gen->z80->mem_pointers[2] = (uint8_t *)main_rom;
+}
 
-	gen->cart = main_rom;
-	gen->lock_on = lock_on;
-	gen->work_ram = calloc(2, RAM_WORDS);
+static void init_ram(genesis_context *gen)
+{
 	if (!strcmp("random", tern_find_path_default(config, "system\0ram_init\0", (tern_val){.ptrval = "zero"}, TVAL_PTR).ptrval))
 	{
 		srand(time(NULL));
@@ -1276,8 +1413,10 @@ genesis_context *alloc_init_genesis(rom_info *rom, void *main_rom, void *lock_on
 			gen->vdp->vsram[i] = rand();
 		}
 	}
-	setup_io_devices(config, rom, &gen->io);
+}
 
+static void init_saves(genesis_context *gen, rom_info *rom)
+{
 	gen->mapper_type = rom->mapper_type;
 	gen->save_type = rom->save_type;
 	if (gen->save_type != SAVE_NONE) {
@@ -1294,25 +1433,23 @@ genesis_context *alloc_init_genesis(rom_info *rom, void *main_rom, void *lock_on
 	} else {
 		gen->save_storage = NULL;
 	}
-	
-	//This must happen before we generate memory access functions in init_m68k_opts
+}
+
+//This must happen before we generate memory access functions for the map
+static void map_work_ram(rom_info *rom, uint16_t *work_ram)
+{
 	for (int i = 0; i < rom->map_chunks; i++)
 	{
 		if (rom->map[i].start == 0xE00000) {
-			rom->map[i].buffer = gen->work_ram;
+			rom->map[i].buffer = work_ram;
 			break;
 		}
 	}
+}
 
-	m68k_options *opts = malloc(sizeof(m68k_options));
-	init_m68k_opts(opts, rom->map, rom->map_chunks, MCLKS_PER_68K);
-	//TODO: make this configurable
-	opts->gen.flags |= M68K_OPT_BROKEN_READ_MODIFY;
-	gen->m68k = init_68k_context(opts, NULL);
-	gen->m68k->system = gen;
-	opts->address_log = (system_opts & OPT_ADDRESS_LOG) ? fopen("address.log", "w") : NULL;
-	
-	//This must happen after the 68K context has been allocated
+//This must happen after the 68K context has been allocated
+static void init_mem_pointers(genesis_context *gen, rom_info *rom)
+{
 	for (int i = 0; i < rom->map_chunks; i++)
 	{
 		if (rom->map[i].flags & MMAP_PTR_IDX) {
@@ -1327,31 +1464,108 @@ genesis_context *alloc_init_genesis(rom_info *rom, void *main_rom, void *lock_on
 			gen->bank_regs[i] = i;
 		}
 	}
+}
+
+static const memmap_chunk z80_base_map[] = {
+	{ 0x0000, 0x4000,  0x1FFF, 0, 0, MMAP_READ | MMAP_WRITE | MMAP_CODE, NULL, NULL, NULL, NULL,              NULL },
+	{ 0x8000, 0x10000, 0x7FFF, 0, 0, 0,                                  NULL, NULL, NULL, z80_read_bank,     z80_write_bank},
+	{ 0x4000, 0x6000,  0x0003, 0, 0, 0,                                  NULL, NULL, NULL, z80_read_ym,       z80_write_ym},
+	{ 0x6000, 0x6100,  0xFFFF, 0, 0, 0,                                  NULL, NULL, NULL, NULL,              z80_write_bank_reg},
+	{ 0x7F00, 0x8000,  0x00FF, 0, 0, 0,                                  NULL, NULL, NULL, z80_vdp_port_read, z80_vdp_port_write}
+};
+
+genesis_context *alloc_init_genesis(rom_info *rom, void *main_rom, void *lock_on, uint32_t system_opts, uint8_t force_region)
+{
+	genesis_context *gen = calloc(1, sizeof(genesis_context));
+	init_header(gen);
+	set_region(gen, rom, force_region);
+	memcpy(gen->rom_hash, rom->hash, sizeof(gen->rom_hash));
+	gen->z80_enabled = !(system_opts & OPT_NO_Z80);
+
+	gen->vdp = malloc(sizeof(vdp_context));
+	init_vdp_context(gen->vdp, gen->version_reg & 0x40);
+	gen->vdp->system = &gen->header;
+	init_timing(gen);
+
+	uint32_t lowpass_cutoff = get_lowpass_cutoff();
+	
+	gen->ym = malloc(sizeof(ym2612_context));
+	ym_init(gen->ym, render_sample_rate(), gen->master_clock, MCLKS_PER_YM, render_audio_buffer(), system_opts, lowpass_cutoff);
+
+	gen->psg = malloc(sizeof(psg_context));
+	psg_init(gen->psg, render_sample_rate(), gen->master_clock, MCLKS_PER_PSG, render_audio_buffer(), lowpass_cutoff);
+
+	gen->zram = calloc(1, Z80_RAM_BYTES);
+	z80_options *z_opts = NULL;
+#ifndef NO_Z80
+	//each instance needs its own map since the Z80 RAM chunk points at its buffer
+	memmap_chunk *z80_map = malloc(sizeof(z80_base_map));
+	memcpy(z80_map, z80_base_map, sizeof(z80_base_map));
+	z80_map[0].buffer = gen->zram;
+	z_opts = malloc(sizeof(z80_options));
+	init_z80_opts(z_opts, z80_map, sizeof(z80_base_map)/sizeof(*z80_base_map), NULL, 0, MCLKS_PER_Z80, 0xFFFF);
+#endif
+	attach_z80(gen, z_opts, main_rom);
+
+	gen->cart = main_rom;
+	gen->lock_on = lock_on;
+	gen->work_ram = calloc(2, RAM_WORDS);
+	init_ram(gen);
+	setup_io_devices(config, rom, &gen->io);
+	init_saves(gen, rom);
+	map_work_ram(rom, gen->work_ram);
+
+	m68k_options *opts = malloc(sizeof(m68k_options));
+	init_m68k_opts(opts, rom->map, rom->map_chunks, MCLKS_PER_68K);
+	//TODO: make this configurable
+	opts->gen.flags |= M68K_OPT_BROKEN_READ_MODIFY;
+	if (!strcmp("on", tern_find_path_default(config, "system\0coalesce_cycle_checks\0", (tern_val){.ptrval = "on"}, TVAL_PTR).ptrval)) {
+		opts->gen.flags |= M68K_OPT_COALESCE_CYCLES;
+	}
+	if (!strcmp("on", tern_find_path_default(config, "system\0superblocks\0", (tern_val){.ptrval = "on"}, TVAL_PTR).ptrval)) {
+		opts->gen.flags |= M68K_OPT_TRACES;
+	}
+	opts->address_log = (system_opts & OPT_ADDRESS_LOG) ? trace_open("address.trace") : NULL;
+	if (opts->address_log) {
+		if (system_opts & OPT_LOG_REGS) {
+			opts->gen.flags |= M68K_OPT_LOG_REGS;
+			//coalesced cycle checks charge a whole run up front, which would skew the logged cycles
+			opts->gen.flags &= ~M68K_OPT_COALESCE_CYCLES;
+		}
+		if (system_opts & OPT_LOG_MEM) {
+			opts->gen.flags |= M68K_OPT_LOG_MEM;
+		}
+		m68k_log_enable(opts);
+	}
+	gen->m68k = init_68k_context(opts, NULL);
+	gen->m68k->system = gen;
+	init_mem_pointers(gen, rom);
+
+	//everything generated past this point was translated from the ROM and can be thrown away by reload_genesis
+	gen->m68k_code_base = opts->gen.code;
+#ifndef NO_Z80
+	gen->z80_code_base = z_opts->gen.code;
+#endif
+	gen->code_blocks = arena_block_count();
 
 	return gen;
 }
 
-genesis_context *alloc_config_genesis(void *rom, uint32_t rom_size, void *lock_on, uint32_t lock_on_size, uint32_t ym_opts, uint8_t force_region, rom_info *info_out)
+static memmap_chunk base_map[] = {
+	{0xE00000, 0x1000000, 0xFFFF,   0, 0, MMAP_READ | MMAP_WRITE | MMAP_CODE, NULL,
+	           NULL,          NULL,         NULL,            NULL},
+	{0xC00000, 0xE00000,  0x1FFFFF, 0, 0, 0,                                  NULL,
+	           (read_16_fun)vdp_port_read,  (write_16_fun)vdp_port_write,
+	           (read_8_fun)vdp_port_read_b, (write_8_fun)vdp_port_write_b},
+	{0xA00000, 0xA12000,  0x1FFFF,  0, 0, 0,                                  NULL,
+	           (read_16_fun)io_read_w,      (write_16_fun)io_write_w,
+	           (read_8_fun)io_read,         (write_8_fun)io_write}
+};
+static void configure_genesis_rom(void *rom, uint32_t rom_size, void *lock_on, uint32_t lock_on_size, rom_info *info_out)
 {
-	static memmap_chunk base_map[] = {
-		{0xE00000, 0x1000000, 0xFFFF,   0, 0, MMAP_READ | MMAP_WRITE | MMAP_CODE, NULL,
-		           NULL,          NULL,         NULL,            NULL},
-		{0xC00000, 0xE00000,  0x1FFFFF, 0, 0, 0,                                  NULL,
-		           (read_16_fun)vdp_port_read,  (write_16_fun)vdp_port_write,
-		           (read_8_fun)vdp_port_read_b, (write_8_fun)vdp_port_write_b},
-		{0xA00000, 0xA12000,  0x1FFFF,  0, 0, 0,                                  NULL,
-		           (read_16_fun)io_read_w,      (write_16_fun)io_write_w,
-		           (read_8_fun)io_read,         (write_8_fun)io_write}
-	};
-	static tern_node *rom_db;
-	if (!rom_db) {
-		rom_db = load_rom_db();
-	}
-	*info_out = configure_rom(rom_db, rom, rom_size, lock_on, lock_on_size, base_map, sizeof(base_map)/sizeof(base_map[0]));
-	rom = info_out->rom;
-	rom_size = info_out->rom_size;
+	*info_out = configure_rom(load_rom_db(), rom, rom_size, lock_on, lock_on_size, base_map, sizeof(base_map)/sizeof(base_map[0]));
 #ifndef BLASTEM_BIG_ENDIAN
-	byteswap_rom(rom_size, rom);
+	byteswap_rom(info_out->rom_size, info_out->rom);
 	if (lock_on) {
 		byteswap_rom(lock_on_size, lock_on);
 	}
@@ -1364,5 +1578,102 @@ genesis_context *alloc_config_genesis(void *rom, uint32_t rom_size, void *lock_o
 	if (!MCLKS_PER_68K) {
 		MCLKS_PER_68K = 7;
 	}
-	return alloc_init_genesis(info_out, rom, lock_on, ym_opts, force_region);
+}
+
+genesis_context *alloc_config_genesis(void *rom, uint32_t rom_size, void *lock_on, uint32_t lock_on_size, uint32_t ym_opts, uint8_t force_region, rom_info *info_out)
+{
+	configure_genesis_rom(rom, rom_size, lock_on, lock_on_size, info_out);
+	return alloc_init_genesis(info_out, info_out->rom, lock_on, ym_opts, force_region);
+}
+
+//Header fields owned by the frontend session rather than by the loaded ROM
+static void keep_session_state(system_header *dst, system_header const *src)
+{
+	dst->arena = src->arena;
+	dst->exit_after = src->exit_after;
+	dst->bench = src->bench;
+}
+
+genesis_context *reload_genesis(genesis_context *gen, void *rom, uint32_t rom_size, uint32_t system_opts, uint8_t force_region, rom_info *info_out)
+{
+	configure_genesis_rom(rom, rom_size, NULL, 0, info_out);
+	m68k_options *opts = gen->m68k->options;
+	cpu_options new_map = opts->gen;
+	new_map.memmap = info_out->map;
+	new_map.memmap_chunks = info_out->map_chunks;
+	if (ram_size(&new_map) != ram_size(&opts->gen)) {
+		//code flags and instruction size tables are sized for the old map, start over
+		system_header session = gen->header;
+		mark_all_free();
+		free_genesis(&gen->header);
+		gen = alloc_init_genesis(info_out, info_out->rom, NULL, system_opts, force_region);
+		keep_session_state(&gen->header, &session);
+		return gen;
+	}
+	release_file_buffer(gen->cart);
+	release_file_buffer(gen->lock_on);
+	unmap_save_file(gen->save_map);
+	free_save_buffer(gen->save_storage, gen->save_size);
+	free(gen->header.save_dir);
+	free(gen->header.save_filename);
+	//the memset below would orphan any IO stream threads, stop them before setup_io_devices starts new ones
+	cleanup_io_devices(&gen->io);
+
+	//only the translated code depends on the ROM, the runtime stubs and code buffers are kept
+	memmap_chunk const *old_map = opts->gen.memmap;
+	m68k_discard_translations(opts);
+	opts->gen.code = gen->m68k_code_base;
+	z80_options *z_opts = NULL;
+#ifndef NO_Z80
+	z_opts = gen->z80->options;
+	z80_discard_translations(z_opts);
+	z_opts->gen.code = gen->z80_code_base;
+#endif
+	mark_free_since(gen->code_blocks);
+	map_work_ram(info_out, gen->work_ram);
+	m68k_remap(opts, info_out->map, info_out->map_chunks);
+	free((void *)old_map);
+
+	genesis_context saved = *gen;
+	free(gen->m68k);
+	free(gen->z80);
+	//mapper state is allocated along with the memory map of the old ROM
+	free(gen->extra);
+	memset(gen, 0, sizeof(*gen));
+	init_header(gen);
+	keep_session_state(&gen->header, &saved.header);
+	set_region(gen, info_out, force_region);
+	memcpy(gen->rom_hash, info_out->hash, sizeof(gen->rom_hash));
+	gen->z80_enabled = !(system_opts & OPT_NO_Z80);
+
+	gen->vdp = saved.vdp;
+	vdp_reset(gen->vdp, gen->version_reg & 0x40);
+	gen->vdp->system = &gen->header;
+	init_timing(gen);
+
+	uint32_t lowpass_cutoff = get_lowpass_cutoff();
+	gen->ym = saved.ym;
+	ym_reinit(gen->ym, gen->master_clock, lowpass_cutoff);
+	gen->psg = saved.psg;
+	psg_reinit(gen->psg, gen->master_clock, lowpass_cutoff);
+
+	gen->zram = saved.zram;
+	memset(gen->zram, 0, Z80_RAM_BYTES);
+	attach_z80(gen, z_opts, info_out->rom);
+
+	gen->cart = info_out->rom;
+	gen->work_ram = saved.work_ram;
+	memset(gen->work_ram, 0, RAM_WORDS * 2);
+	init_ram(gen);
+	setup_io_devices(config, info_out, &gen->io);
+	init_saves(gen, info_out);
+
+	gen->m68k = init_68k_context(opts, NULL);
+	gen->m68k->system = gen;
+	init_mem_pointers(gen, info_out);
+
+	gen->m68k_code_base = saved.m68k_code_base;
+	gen->z80_code_base = saved.z80_code_base;
+	gen->code_blocks = saved.code_blocks;
+	return gen;
 }
@@ -17,6 +17,8 @@
 #include "romdb.h"
 #include "arena.h"
 #include "i2c.h"
+#include "sched.h"
+#include "save_file.h"
 
 typedef struct genesis_context genesis_context;
 
@@ -33,6 +35,7 @@ struct genesis_context {
 	uint8_t         *zram;
 	void            *extra;
 	uint8_t         *save_storage;
+	save_file       *save_map; //file mapped over save_storage, NULL when saves go through stdio
 	void            *mapper_temp;
 	eeprom_map      *eeprom_map;
 	uint32_t        num_eeprom;
@@ -41,27 +44,49 @@ struct genesis_context {
 	uint32_t        master_clock; //Current master clock value
 	uint32_t        normal_clock; //Normal master clock (used to restore master clock after turbo mode)
 	uint32_t        frame_end;
+	uint32_t        next_vint;
+	uint32_t        next_hint;
+	uint32_t        vdp_events_serial;
+	uint32_t        vdp_events_valid_until; //cached VDP event times must be recomputed once the VDP reaches this cycle
 	uint32_t        max_cycles;
 	uint32_t        int_latency_prev1;
 	uint32_t        int_latency_prev2;
+	uint32_t        last_frame_num;
+	uint32_t        last_sync_cycle;
+	uint32_t        refresh_counter;
+	uint32_t        zram_counter;
 	uint8_t         bank_regs[8];
 	uint16_t        mapper_start_index;
 	uint8_t         mapper_type;
 	uint8_t         save_type;
 	sega_io         io;
+	scheduler       int_events;
+	memmap_chunk const *dma_chunk; //last memory map chunk used as a DMA source
 	uint8_t         version_reg;
 	uint8_t         bus_busy;
 	uint8_t         reset_requested;
+	uint8_t         z80_enabled;
+	uint8_t         rom_hash[20];
 	eeprom_state    eeprom;
 	nor_state       nor;
+	code_info       m68k_code_base; //code position just past the generated runtime, translations start here
+	code_info       z80_code_base;
+	size_t          code_blocks; //code blocks in use when the runtime was generated
+};
+
+enum {
+	GEN_EVENT_VINT,
+	GEN_EVENT_HINT
 };
 
 #define RAM_WORDS 32 * 1024
 #define Z80_RAM_BYTES 8 * 1024
 
-uint16_t read_dma_value(uint32_t address);
+uint16_t read_dma_value(system_header *system, uint32_t address);
 m68k_context * sync_components(m68k_context *context, uint32_t address);
 genesis_context *alloc_config_genesis(void *rom, uint32_t rom_size, void *lock_on, uint32_t lock_on_size, uint32_t system_opts, uint8_t force_region, rom_info *info_out);
+//Switches an existing context to a new ROM without regenerating its runtime, may return a new context
+genesis_context *reload_genesis(genesis_context *gen, void *rom, uint32_t rom_size, uint32_t system_opts, uint8_t force_region, rom_info *info_out);
 void genesis_serialize(genesis_context *gen, serialize_buffer *buf, uint32_t m68k_pc);
 void genesis_deserialize(deserialize_buffer *buf, genesis_context *gen);
 
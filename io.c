@@ -11,6 +11,8 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <poll.h>
+#include <pthread.h>
 #endif
 #include <string.h>
 #include <stdlib.h>
@@ -898,12 +900,351 @@ char * io_name(int i)
 	}
 }
 
+#ifndef _WIN32
 static char * sockfile_name;
+static uint8_t sockfile_name_registered;
 static void cleanup_sockfile()
 {
-	unlink(sockfile_name);
+	if (sockfile_name) {
+		unlink(sockfile_name);
+	}
+}
+
+//Socket and pipe devices are serviced on a dedicated thread so that a slow or absent peer never stalls
+//emulation. Bytes are exchanged with the emulation thread through single producer/single consumer queues
+#define STREAM_QUEUE_SIZE 1024
+
+typedef struct {
+	uint8_t  data[STREAM_QUEUE_SIZE];
+	uint32_t read_pos;
+	uint32_t write_pos;
+} stream_queue;
+
+struct io_stream {
+	stream_queue    in;
+	stream_queue    out;
+	pthread_t       thread;
+	pthread_mutex_t lock;
+	pthread_cond_t  input_ready;
+	pthread_cond_t  output_drained;
+	char            *pipe_name;
+	char            *sock_name;
+	int             data_fd;
+	int             listen_fd;
+	int             wake_fds[2];
+	uint8_t         connected;
+	uint8_t         stop;
+};
+
+static uint32_t queue_used(stream_queue *queue)
+{
+	return __atomic_load_n(&queue->write_pos, __ATOMIC_ACQUIRE) - __atomic_load_n(&queue->read_pos, __ATOMIC_ACQUIRE);
+}
+
+static uint8_t queue_push(stream_queue *queue, uint8_t value)
+{
+	uint32_t write_pos = queue->write_pos;
+	if (write_pos - __atomic_load_n(&queue->read_pos, __ATOMIC_ACQUIRE) == STREAM_QUEUE_SIZE) {
+		return 0;
+	}
+	queue->data[write_pos % STREAM_QUEUE_SIZE] = value;
+	__atomic_store_n(&queue->write_pos, write_pos + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+static uint8_t queue_pop(stream_queue *queue, uint8_t *value)
+{
+	uint32_t read_pos = queue->read_pos;
+	if (read_pos == __atomic_load_n(&queue->write_pos, __ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+	*value = queue->data[read_pos % STREAM_QUEUE_SIZE];
+	__atomic_store_n(&queue->read_pos, read_pos + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+static void wake_stream_thread(io_stream *stream)
+{
+	uint8_t dummy = 0;
+	if (write(stream->wake_fds[1], &dummy, sizeof(dummy)) < 0 && errno != EAGAIN) {
+		warning("Failed to wake IO port thread: %d %s\n", errno, strerror(errno));
+	}
+}
+
+static uint8_t stream_stopping(io_stream *stream)
+{
+	return __atomic_load_n(&stream->stop, __ATOMIC_ACQUIRE);
+}
+
+//updates the connection state and wakes up a synchronous read or write waiting in service_socket
+static void stream_set_connected(io_stream *stream, uint8_t connected)
+{
+	pthread_mutex_lock(&stream->lock);
+	stream->connected = connected;
+	pthread_cond_signal(&stream->input_ready);
+	pthread_cond_signal(&stream->output_drained);
+	pthread_mutex_unlock(&stream->lock);
+}
+
+static uint8_t stream_connect(io_stream *stream)
+{
+	while (stream->data_fd == -1)
+	{
+		if (stream_stopping(stream)) {
+			return 0;
+		}
+		if (stream->pipe_name) {
+			//blocks until a new writer shows up, which is fine on this thread
+			//stop_stream_thread opens the FIFO itself to get us out of here
+			stream->data_fd = open(stream->pipe_name, O_RDONLY);
+		} else if (stream->listen_fd != -1) {
+			puts("Waiting for socket connection...");
+			struct pollfd fds[2] = {
+				{.fd = stream->listen_fd, .events = POLLIN},
+				{.fd = stream->wake_fds[0], .events = POLLIN}
+			};
+			if (poll(fds, 2, -1) < 0 || !(fds[0].revents & POLLIN)) {
+				//woken up or interrupted, check whether we are being stopped
+				uint8_t buf[64];
+				while (read(stream->wake_fds[0], buf, sizeof(buf)) > 0)
+				{
+				}
+				errno = EINTR;
+			} else {
+				stream->data_fd = accept(stream->listen_fd, NULL, NULL);
+			}
+		} else {
+			return 0;
+		}
+		if (stream->data_fd == -1 && errno != EINTR) {
+			warning("Failed to open connection for IO port: %d %s\n", errno, strerror(errno));
+			return 0;
+		}
+	}
+	if (stream_stopping(stream)) {
+		return 0;
+	}
+	stream_set_connected(stream, 1);
+	return 1;
+}
+
+static void stream_disconnect(io_stream *stream)
+{
+	if (stream->data_fd != STDIN_FILENO) {
+		close(stream->data_fd);
+	} else {
+		stream->pipe_name = NULL;
+	}
+	stream->data_fd = -1;
+	stream_set_connected(stream, 0);
 }
 
+static void *stream_thread(void *data)
+{
+	io_stream *stream = data;
+	while (stream_connect(stream))
+	{
+		if (stream_stopping(stream)) {
+			break;
+		}
+		uint32_t in_free = STREAM_QUEUE_SIZE - queue_used(&stream->in);
+		uint32_t out_used = queue_used(&stream->out);
+		//a full input queue is not polled, the emulation thread wakes us once it has made room
+		//with nothing to send the fd is left out entirely as POLLHUP would be reported regardless of events
+		struct pollfd fds[2] = {
+			{.fd = in_free || out_used ? stream->data_fd : -1, .events = (in_free ? POLLIN : 0) | (out_used ? POLLOUT : 0)},
+			{.fd = stream->wake_fds[0], .events = POLLIN}
+		};
+		if (poll(fds, 2, -1) < 0) {
+			if (errno != EINTR) {
+				warning("Failed to poll IO port: %d %s\n", errno, strerror(errno));
+				break;
+			}
+			continue;
+		}
+		if (fds[1].revents & POLLIN) {
+			uint8_t buf[64];
+			while (read(stream->wake_fds[0], buf, sizeof(buf)) > 0)
+			{
+			}
+			if (stream_stopping(stream)) {
+				break;
+			}
+		}
+		if (in_free && fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+			uint8_t buf[STREAM_QUEUE_SIZE];
+			ssize_t numread = read(stream->data_fd, buf, in_free);
+			if (numread > 0) {
+				for (ssize_t i = 0; i < numread; i++)
+				{
+					queue_push(&stream->in, buf[i]);
+				}
+				pthread_mutex_lock(&stream->lock);
+				pthread_cond_signal(&stream->input_ready);
+				pthread_mutex_unlock(&stream->lock);
+			} else if (numread == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+				if (numread) {
+					warning("Error reading from IO port: %d %s\n", errno, strerror(errno));
+				}
+				stream_disconnect(stream);
+				continue;
+			}
+		}
+		if (out_used && fds[0].revents & POLLOUT) {
+			uint8_t buf[STREAM_QUEUE_SIZE];
+			uint32_t read_pos = stream->out.read_pos;
+			for (uint32_t i = 0; i < out_used; i++)
+			{
+				buf[i] = stream->out.data[(read_pos + i) % STREAM_QUEUE_SIZE];
+			}
+			ssize_t written = send(stream->data_fd, buf, out_used, MSG_NOSIGNAL);
+			if (written > 0) {
+				__atomic_store_n(&stream->out.read_pos, read_pos + written, __ATOMIC_RELEASE);
+				pthread_mutex_lock(&stream->lock);
+				pthread_cond_signal(&stream->output_drained);
+				pthread_mutex_unlock(&stream->lock);
+			} else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				warning("Error writing to socket for IO port: %d %s\n", errno, strerror(errno));
+				stream_disconnect(stream);
+			}
+		}
+	}
+	stream_set_connected(stream, 0);
+	return NULL;
+}
+
+static void start_stream_thread(io_port *port, char *pipe_name, char *sock_name)
+{
+	io_stream *stream = calloc(1, sizeof(io_stream));
+	stream->data_fd = port->device.stream.data_fd;
+	stream->listen_fd = port->device.stream.listen_fd;
+	stream->pipe_name = pipe_name;
+	stream->sock_name = sock_name;
+	stream->connected = stream->data_fd != -1;
+	if (pipe(stream->wake_fds)) {
+		fatal_error("Failed to create wake pipe for IO port: %d %s\n", errno, strerror(errno));
+	}
+	fcntl(stream->wake_fds[0], F_SETFL, O_NONBLOCK);
+	fcntl(stream->wake_fds[1], F_SETFL, O_NONBLOCK);
+	if (stream->data_fd != -1) {
+		fcntl(stream->data_fd, F_SETFL, fcntl(stream->data_fd, F_GETFL) | O_NONBLOCK);
+	}
+	pthread_mutex_init(&stream->lock, NULL);
+	pthread_cond_init(&stream->input_ready, NULL);
+	pthread_cond_init(&stream->output_drained, NULL);
+	if (pthread_create(&stream->thread, NULL, stream_thread, stream)) {
+		fatal_error("Failed to start IO port thread: %d %s\n", errno, strerror(errno));
+	}
+	port->device.stream.async = stream;
+}
+
+static void stop_stream_thread(io_port *port)
+{
+	io_stream *stream = port->device.stream.async;
+	__atomic_store_n(&stream->stop, 1, __ATOMIC_RELEASE);
+	wake_stream_thread(stream);
+	//the thread may be blocked opening the FIFO, opening it for writing lets that open complete
+	//O_RDWR is used so this doesn't fail or block when the thread currently has no reader open
+	int fifo_fd = stream->pipe_name ? open(stream->pipe_name, O_RDWR | O_NONBLOCK) : -1;
+	pthread_join(stream->thread, NULL);
+	if (fifo_fd != -1) {
+		close(fifo_fd);
+	}
+	if (stream->data_fd != -1 && stream->data_fd != STDIN_FILENO) {
+		close(stream->data_fd);
+	}
+	if (stream->listen_fd != -1) {
+		close(stream->listen_fd);
+	}
+	if (stream->sock_name) {
+		//the socket file has to go away before the next bind to the same path
+		unlink(stream->sock_name);
+		if (sockfile_name == stream->sock_name) {
+			sockfile_name = NULL;
+		}
+	}
+	close(stream->wake_fds[0]);
+	close(stream->wake_fds[1]);
+	pthread_mutex_destroy(&stream->lock);
+	pthread_cond_destroy(&stream->input_ready);
+	pthread_cond_destroy(&stream->output_drained);
+	free(stream);
+	port->device.stream.async = NULL;
+}
+
+static uint8_t stream_read(io_stream *stream, uint8_t *value)
+{
+	uint8_t was_full = queue_used(&stream->in) == STREAM_QUEUE_SIZE;
+	if (!queue_pop(&stream->in, value)) {
+		return 0;
+	}
+	if (was_full) {
+		wake_stream_thread(stream);
+	}
+	return 1;
+}
+
+static void service_pipe(io_port * port)
+{
+	uint8_t value;
+	if (stream_read(port->device.stream.async, &value))
+	{
+		port->input[IO_TH0] = (value & 0xF) | 0x10;
+		port->input[IO_TH1] = (value >> 4) | 0x10;
+	}
+}
+
+static void service_socket(io_port *port)
+{
+	io_stream *stream = port->device.stream.async;
+	if (port->input[IO_STATE] == IO_READ_PENDING && !queue_used(&stream->in))
+	{
+		//the device explicitly asked for a synchronous read so this is the one case where we wait on the peer
+		//the wait ends early if the peer goes away, in which case the read simply returns stale data
+		pthread_mutex_lock(&stream->lock);
+		while (!queue_used(&stream->in) && stream->connected)
+		{
+			pthread_cond_wait(&stream->input_ready, &stream->lock);
+		}
+		pthread_mutex_unlock(&stream->lock);
+	}
+	uint8_t value, got_data = 0;
+	while (stream_read(stream, &value))
+	{
+		got_data = 1;
+	}
+	if (got_data)
+	{
+		port->input[IO_TH0] = value;
+		if (port->input[IO_STATE] == IO_READ_PENDING || port->input[IO_STATE] == IO_WRITTEN)
+		{
+			port->input[IO_STATE] = IO_READ;
+		}
+	}
+
+	if (port->input[IO_STATE] == IO_WRITE_PENDING)
+	{
+		uint8_t out_value = port->output & port->control;
+		uint8_t was_empty = !queue_used(&stream->out);
+		if (!queue_push(&stream->out, out_value)) {
+			//peer is a whole queue behind, wait for the thread to drain it
+			//the byte is dropped if the peer goes away in the meantime
+			wake_stream_thread(stream);
+			pthread_mutex_lock(&stream->lock);
+			while (!queue_push(&stream->out, out_value) && stream->connected)
+			{
+				pthread_cond_wait(&stream->output_drained, &stream->lock);
+			}
+			pthread_mutex_unlock(&stream->lock);
+		}
+		if (was_empty) {
+			wake_stream_thread(stream);
+		}
+		port->input[IO_STATE] = IO_WRITTEN;
+	}
+}
+#endif
+
 void setup_io_devices(tern_node * config, rom_info *rom, sega_io *io)
 {
 	current_io = io;
@@ -961,6 +1302,9 @@ void setup_io_devices(tern_node * config, rom_info *rom, sega_io *io)
 						}
 					}
 				}
+				if (ports[i].device_type == IO_SEGA_PARALLEL) {
+					start_stream_thread(ports + i, strcmp("stdin", pipe_name) ? pipe_name : NULL, NULL);
+				}
 			}
 		} else if (ports[i].device_type == IO_GENERIC) {
 			char *sock_name = tern_find_path(config, "io\0socket\0", TVAL_PTR).ptrval;
@@ -987,8 +1331,12 @@ void setup_io_devices(tern_node * config, rom_info *rom, sega_io *io)
 					warning("Failed to listen on socket for IO Port %s: %d %s\n", io_name(i), errno, strerror(errno));
 					goto cleanup_sockfile;
 				}
+				if (!sockfile_name_registered) {
+					atexit(cleanup_sockfile);
+					sockfile_name_registered = 1;
+				}
 				sockfile_name = sock_name;
-				atexit(cleanup_sockfile);
+				start_stream_thread(ports + i, NULL, sock_name);
 				continue;
 cleanup_sockfile:
 				unlink(sock_name);
@@ -1006,6 +1354,18 @@ cleanup_sock:
 	}
 }
 
+void cleanup_io_devices(sega_io *io)
+{
+#ifndef _WIN32
+	for (int i = 0; i < 3; i++)
+	{
+		if ((io->ports[i].device_type == IO_SEGA_PARALLEL || io->ports[i].device_type == IO_GENERIC) && io->ports[i].device.stream.async) {
+			stop_stream_thread(io->ports + i);
+		}
+	}
+#endif
+}
+
 void map_bindings(io_port *ports, keybinding *bindings, int numbindings)
 {
 	for (int i = 0; i < numbindings; i++)
@@ -1524,7 +1884,28 @@ void mouse_check_ready(io_port *port, uint32_t current_cycle)
 	}
 }
 
-uint32_t last_poll_cycle;
+//fixed input sequence for --benchmark so runs are repeatable without a human at the controls
+static const uint16_t script_buttons[] = {
+	BUTTON_START, 0, DPAD_RIGHT, BUTTON_A, BUTTON_C, DPAD_DOWN, BUTTON_START, BUTTON_B
+};
+#define SCRIPT_FRAMES_PER_STEP 30
+
+void io_script_input(sega_io *io, uint32_t frame)
+{
+	io_port *port = io->ports;
+	if (port->device_type != IO_GAMEPAD3 && port->device_type != IO_GAMEPAD6) {
+		return;
+	}
+	port->input[GAMEPAD_TH0] = port->input[GAMEPAD_TH1] = port->input[GAMEPAD_EXTRA] = 0;
+	uint16_t button = script_buttons[(frame / SCRIPT_FRAMES_PER_STEP) % (sizeof(script_buttons)/sizeof(*script_buttons))];
+	if (button) {
+		port->input[button >> 12] |= button & 0xFF;
+		if ((button >> 8 & 0xF) != GAMEPAD_NONE) {
+			port->input[button >> 8 & 0xF] |= button & 0xFF;
+		}
+	}
+}
+
 void io_adjust_cycles(io_port * port, uint32_t current_cycle, uint32_t deduction)
 {
 	/*uint8_t control = pad->control | 0x80;
@@ -1556,114 +1937,13 @@ void io_adjust_cycles(io_port * port, uint32_t current_cycle, uint32_t deduction
 			}
 		}
 	}
-	if (last_poll_cycle >= deduction) {
-		last_poll_cycle -= deduction;
+	if (port->last_poll_cycle >= deduction) {
+		port->last_poll_cycle -= deduction;
 	} else {
-		last_poll_cycle = 0;
-	}
-}
-
-#ifndef _WIN32
-static void wait_for_connection(io_port * port)
-{
-	if (port->device.stream.data_fd == -1)
-	{
-		puts("Waiting for socket connection...");
-		port->device.stream.data_fd = accept(port->device.stream.listen_fd, NULL, NULL);
-		fcntl(port->device.stream.data_fd, F_SETFL, O_NONBLOCK | O_RDWR);
+		port->last_poll_cycle = 0;
 	}
 }
 
-static void service_pipe(io_port * port)
-{
-	uint8_t value;
-	int numRead = read(port->device.stream.data_fd, &value, sizeof(value));
-	if (numRead > 0)
-	{
-		port->input[IO_TH0] = (value & 0xF) | 0x10;
-		port->input[IO_TH1] = (value >> 4) | 0x10;
-	} else if(numRead == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
-		warning("Error reading pipe for IO port: %d %s\n", errno, strerror(errno));
-	}
-}
-
-static void service_socket(io_port *port)
-{
-	uint8_t buf[32];
-	uint8_t blocking = 0;
-	int numRead = 0;
-	while (numRead <= 0)
-	{
-		numRead = recv(port->device.stream.data_fd, buf, sizeof(buf), 0);
-		if (numRead > 0)
-		{
-			port->input[IO_TH0] = buf[numRead-1];
-			if (port->input[IO_STATE] == IO_READ_PENDING)
-			{
-				port->input[IO_STATE] = IO_READ;
-				if (blocking)
-				{
-					//pending read satisfied, back to non-blocking mode
-					fcntl(port->device.stream.data_fd, F_SETFL, O_RDWR | O_NONBLOCK);
-				}
-			} else if (port->input[IO_STATE] == IO_WRITTEN) {
-				port->input[IO_STATE] = IO_READ;
-			}
-		} else if (numRead == 0) {
-			port->device.stream.data_fd = -1;
-			wait_for_connection(port);
-		} else if (errno != EAGAIN && errno != EWOULDBLOCK) {
-			warning("Error reading from socket for IO port: %d %s\n", errno, strerror(errno));
-			close(port->device.stream.data_fd);
-			wait_for_connection(port);
-		} else if (port->input[IO_STATE] == IO_READ_PENDING) {
-			//clear the nonblocking flag so the next read will block
-			if (!blocking)
-			{
-				fcntl(port->device.stream.data_fd, F_SETFL, O_RDWR);
-				blocking = 1;
-			}
-		} else {
-			//no new data, but that's ok
-			break;
-		}
-	}
-
-	if (port->input[IO_STATE] == IO_WRITE_PENDING)
-	{
-		uint8_t value = port->output & port->control;
-		int written = 0;
-		blocking = 0;
-		while (written <= 0)
-		{
-			send(port->device.stream.data_fd, &value, sizeof(value), 0);
-			if (written > 0)
-			{
-				port->input[IO_STATE] = IO_WRITTEN;
-				if (blocking)
-				{
-					//pending write satisfied, back to non-blocking mode
-					fcntl(port->device.stream.data_fd, F_SETFL, O_RDWR | O_NONBLOCK);
-				}
-			} else if (written == 0) {
-				port->device.stream.data_fd = -1;
-				wait_for_connection(port);
-			} else if (errno != EAGAIN && errno != EWOULDBLOCK) {
-				warning("Error writing to socket for IO port: %d %s\n", errno, strerror(errno));
-				close(port->device.stream.data_fd);
-				wait_for_connection(port);
-			} else {
-				//clear the nonblocking flag so the next write will block
-				if (!blocking)
-				{
-					fcntl(port->device.stream.data_fd, F_SETFL, O_RDWR);
-					blocking = 1;
-				}
-			}
-		}
-	}
-}
-#endif
 
 const int mouse_delays[] = {112*7, 120*7, 96*7, 132*7, 104*7, 96*7, 112*7, 96*7};
 
@@ -1810,7 +2090,6 @@ void io_data_write(io_port * port, uint8_t value, uint32_t current_cycle)
 		break;
 #ifndef _WIN32
 	case IO_GENERIC:
-		wait_for_connection(port);
 		port->input[IO_STATE] = IO_WRITE_PENDING;
 		service_socket(port);
 		break;
@@ -1863,9 +2142,9 @@ uint8_t io_data_read(io_port * port, uint32_t current_cycle)
 	uint8_t th = output & 0x40;
 	uint8_t input;
 	uint8_t device_driven;
-	if (current_cycle - last_poll_cycle > MIN_POLL_INTERVAL) {
+	if (current_cycle - port->last_poll_cycle > MIN_POLL_INTERVAL) {
 		process_events();
-		last_poll_cycle = current_cycle;
+		port->last_poll_cycle = current_cycle;
 	}
 	switch (port->device_type)
 	{
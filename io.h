@@ -27,6 +27,8 @@ enum {
 	IO_NONE
 };
 
+typedef struct io_stream io_stream;
+
 typedef struct {
 	union {
 		struct {
@@ -35,8 +37,9 @@ typedef struct {
 			uint16_t gamepad_num;
 		} pad;
 		struct {
-			int data_fd;
-			int listen_fd;
+			int       data_fd;
+			int       listen_fd;
+			io_stream *async;
 		} stream;
 		struct {
 			uint32_t ready_cycle;
@@ -62,6 +65,7 @@ typedef struct {
 	uint8_t  control;
 	uint8_t  input[3];
 	uint32_t slow_rise_start[8];
+	uint32_t last_poll_cycle;
 	uint8_t  serial_out;
 	uint8_t  serial_in;
 	uint8_t  serial_ctrl;
@@ -96,7 +100,9 @@ typedef struct genesis_context genesis_context;
 void set_keybindings(sega_io *io);
 void map_all_bindings(sega_io *io);
 void setup_io_devices(tern_node * config, rom_info *rom, sega_io *io);
+void cleanup_io_devices(sega_io *io);
 void io_adjust_cycles(io_port * pad, uint32_t current_cycle, uint32_t deduction);
+void io_script_input(sega_io *io, uint32_t frame);
 void io_control_write(io_port *port, uint8_t value, uint32_t current_cycle);
 void io_data_write(io_port * pad, uint8_t value, uint32_t current_cycle);
 uint8_t io_data_read(io_port * pad, uint32_t current_cycle);
@@ -0,0 +1,432 @@
+#include <stdint.h>
+#include "jag_color.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#include <immintrin.h>
+#define JAG_COLOR_HAS_AVX2
+#endif
+#endif
+#if defined(__ARM_NEON) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <arm_neon.h>
+#define JAG_COLOR_HAS_NEON
+#endif
+
+static uint8_t cry_red[9][16] = {
+	{0, 34, 68, 102, 135, 169, 203, 237, 255, 255, 255, 255, 255, 255, 255, 255},
+	{0, 34, 68, 102, 135, 169, 203, 230, 247, 255, 255, 255, 255, 255, 255, 255},
+	{0, 34, 68, 102, 135, 170, 183, 197, 214, 235, 255, 255, 255, 255, 255, 255},
+	{0, 34, 68, 102, 130, 141, 153, 164, 181, 204, 227, 249, 255, 255, 255, 255},
+	{0, 34, 68, 95,  104, 113, 122, 131, 148, 173, 198, 223, 248, 255, 255, 255},
+	{0, 34, 64, 71,  78,  85,  91,  98,  115, 143, 170, 197, 224, 252, 255, 255},
+	{0, 34, 43, 47,  52,  56,  61,  65,  82,  112, 141, 171, 200, 230, 255, 255},
+	{0, 19, 21, 23,  26,  28,  30,  32,  49,  81,  113, 145, 177, 208, 240, 255},
+	{0, 0,  0,  0,   0,   0,   0,   0,   17,  51,  85,  119, 153, 187, 221, 255}
+};
+
+static uint8_t cry_green[16][8] = {
+	{0,   0,   0,   0,   0,   0,   0,   0},
+	{17,  19,  21,  23,  26,  28,  30,  32},
+	{34,  38,  43,  47,  52,  56,  61,  65},
+	{51,  57,  64,  71,  78,  85,  91,  98},
+	{68,  77,  86,  95,  104, 113, 122, 131},
+	{85,  96,  107, 119, 130, 141, 153, 164},
+	{102, 115, 129, 142, 156, 170, 183, 197},
+	{119, 134, 150, 166, 182, 198, 214, 230},
+	{136, 154, 172, 190, 208, 226, 244, 255},
+	{153, 173, 193, 214, 234, 255, 255, 255},
+	{170, 192, 215, 238, 255, 255, 255, 255},
+	{187, 211, 236, 255, 255, 255, 255, 255},
+	{204, 231, 255, 255, 255, 255, 255, 255},
+	{221, 250, 255, 255, 255, 255, 255, 255},
+	{238, 255, 255, 255, 255, 255, 255, 255},
+	{255, 255, 255, 255, 255, 255, 255, 255},
+};
+
+//full intensity color for each value of the upper CRY byte in 0x00RRGGBB format,
+//the intensity byte scales this so the whole table fits in 1KB instead of 256KB
+static uint32_t cry_base[256];
+
+void jag_cry_components(uint16_t cry, uint8_t *r, uint8_t *g, uint8_t *b)
+{
+	uint32_t y = cry & 0xFF;
+	uint8_t c = cry >> 8 & 0xF;
+	uint8_t red = cry >> 12;
+	*r = cry_red[c < 7 ? 0 : c - 7][red] * y / 255;
+	*g = cry_green[c][red < 8 ? red : 15 - red] * y / 255;
+	*b = cry_red[c < 7 ? 0 : c - 7][15 - red] * y / 255;
+}
+
+void jag_rgb16_components(uint16_t rgb, uint8_t *r, uint8_t *g, uint8_t *b)
+{
+	*r = rgb >> 8 & 0xF8;
+	*g = rgb << 2 & 0xFC;
+	*b = rgb >> 3 & 0xF8;
+}
+
+//exact for all products of two bytes
+static inline uint32_t div255(uint32_t x)
+{
+	return (x + 1 + (x >> 8)) >> 8;
+}
+
+static inline uint32_t cry_scalar(uint16_t cry)
+{
+	uint32_t base = cry_base[cry >> 8];
+	uint32_t y = cry & 0xFF;
+	return 0xFF000000 | div255((base >> 16) * y) << 16 | div255((base >> 8 & 0xFF) * y) << 8 | div255((base & 0xFF) * y);
+}
+
+static inline uint32_t rgb16_scalar(uint16_t rgb)
+{
+	return 0xFF000000 | (rgb & 0xF800) << 8 | (rgb & 0x3F) << 10 | (rgb & 0x7C0) >> 3;
+}
+
+static void convert_cry_scalar(uint32_t *dst, uint16_t *src, uint32_t len)
+{
+	for (; len; len--)
+	{
+		*(dst++) = cry_scalar(*(src++));
+	}
+}
+
+static void convert_rgb16_scalar(uint32_t *dst, uint16_t *src, uint32_t len)
+{
+	for (; len; len--)
+	{
+		*(dst++) = rgb16_scalar(*(src++));
+	}
+}
+
+static void convert_variable_scalar(uint32_t *dst, uint16_t *src, uint32_t len)
+{
+	for (; len; len--, src++)
+	{
+		*(dst++) = *src & 1 ? rgb16_scalar(*src & 0xFFFE) : cry_scalar(*src);
+	}
+}
+
+#ifdef __SSE2__
+//4 CRY pixels, intensity is multiplied in 16-bit lanes with one lane per color component
+static inline __m128i cry_sse2(uint16_t *src)
+{
+	__m128i base = _mm_setr_epi32(cry_base[src[0] >> 8], cry_base[src[1] >> 8], cry_base[src[2] >> 8], cry_base[src[3] >> 8]);
+	__m128i y = _mm_and_si128(_mm_loadl_epi64((__m128i *)src), _mm_set1_epi16(0xFF));
+	y = _mm_unpacklo_epi16(y, y);
+	__m128i one = _mm_set1_epi16(1);
+	__m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(base, _mm_setzero_si128()), _mm_unpacklo_epi32(y, y));
+	__m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(base, _mm_setzero_si128()), _mm_unpackhi_epi32(y, y));
+	lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, one), _mm_srli_epi16(lo, 8)), 8);
+	hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, one), _mm_srli_epi16(hi, 8)), 8);
+	return _mm_or_si128(_mm_packus_epi16(lo, hi), _mm_set1_epi32(0xFF000000));
+}
+
+//8 RGB16 pixels, returns the first 4 in lo and the rest in hi
+static inline void rgb16_sse2(__m128i rgb, __m128i *lo, __m128i *hi)
+{
+	__m128i r = _mm_and_si128(_mm_srli_epi16(rgb, 8), _mm_set1_epi16(0xF8));
+	__m128i g = _mm_and_si128(_mm_slli_epi16(rgb, 10), _mm_set1_epi16(0xFC00));
+	__m128i b = _mm_and_si128(_mm_srli_epi16(rgb, 3), _mm_set1_epi16(0xF8));
+	__m128i gb = _mm_or_si128(g, b);
+	__m128i ar = _mm_or_si128(r, _mm_set1_epi16(0xFF00));
+	*lo = _mm_unpacklo_epi16(gb, ar);
+	*hi = _mm_unpackhi_epi16(gb, ar);
+}
+
+static void convert_cry_sse2(uint32_t *dst, uint16_t *src, uint32_t len)
+{
+	for (; len >= 4; len -= 4, src += 4, dst += 4)
+	{
+		_mm_storeu_si128((__m128i *)dst, cry_sse2(src));
+	}
+	convert_cry_scalar(dst, src, len);
+}
+
+static void convert_rgb16_sse2(uint32_t *dst, uint16_t *src, uint32_t len)
+{
+	for (; len >= 8; len -= 8, src += 8, dst += 8)
+	{
+		__m128i lo, hi;
+		rgb16_sse2(_mm_loadu_si128((__m128i *)src), &lo, &hi);
+		_mm_storeu_si128((__m128i *)dst, lo);
+		_mm_storeu_si128((__m128i *)(dst + 4), hi);
+	}
+	convert_rgb16_scalar(dst, src, len);
+}
+
+static void convert_variable_sse2(uint32_t *dst, uint16_t *src, uint32_t len)
+{
+	for (; len >= 8; len -= 8, src += 8, dst += 8)
+	{
+		__m128i words = _mm_loadu_si128((__m128i *)src);
+		__m128i lo, hi;
+		rgb16_sse2(_mm_and_si128(words, _mm_set1_epi16(0xFFFE)), &lo, &hi);
+		//pixels with the low bit set are RGB16, the rest are CRY
+		__m128i rgb_mask = _mm_cmpeq_epi16(_mm_and_si128(words, _mm_set1_epi16(1)), _mm_set1_epi16(1));
+		__m128i mask_lo = _mm_unpacklo_epi16(rgb_mask, rgb_mask);
+		__m128i mask_hi = _mm_unpackhi_epi16(rgb_mask, rgb_mask);
+		lo = _mm_or_si128(_mm_and_si128(mask_lo, lo), _mm_andnot_si128(mask_lo, cry_sse2(src)));
+		hi = _mm_or_si128(_mm_and_si128(mask_hi, hi), _mm_andnot_si128(mask_hi, cry_sse2(src + 4)));
+		_mm_storeu_si128((__m128i *)dst, lo);
+		_mm_storeu_si128((__m128i *)(dst + 4), hi);
+	}
+	convert_variable_scalar(dst, src, len);
+}
+#endif
+
+#ifdef JAG_COLOR_HAS_AVX2
+//8 CRY pixels, the base colors are gathered instead of being looked up one at a time
+__attribute__((target("avx2")))
+static inline __m256i cry_avx2(uint16_t *src)
+{
+	__m128i words = _mm_loadu_si128((__m128i *)src);
+	__m256i index = _mm256_srli_epi32(_mm256_cvtepu16_epi32(words), 8);
+	__m256i base = _mm256_i32gather_epi32((int const *)cry_base, index, 4);
+	__m128i y = _mm_and_si128(words, _mm_set1_epi16(0xFF));
+	__m128i y03 = _mm_unpacklo_epi16(y, y);
+	__m128i y47 = _mm_unpackhi_epi16(y, y);
+	//unpacks work within 128-bit lanes so the low half of each result covers pixels 0-3 and the high half 4-7
+	__m256i ylo = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi32(y03, y03)), _mm_unpacklo_epi32(y47, y47), 1);
+	__m256i yhi = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpackhi_epi32(y03, y03)), _mm_unpackhi_epi32(y47, y47), 1);
+	__m256i one = _mm256_set1_epi16(1);
+	__m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(base, _mm256_setzero_si256()), ylo);
+	__m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(base, _mm256_setzero_si256()), yhi);
+	lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(lo, one), _mm256_srli_epi16(lo, 8)), 8);
+	hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(hi, one), _mm256_srli_epi16(hi, 8)), 8);
+	return _mm256_or_si256(_mm256_packus_epi16(lo, hi), _mm256_set1_epi32(0xFF000000));
+}
+
+//16 RGB16 pixels, returns the first 8 in lo and the rest in hi
+__attribute__((target("avx2")))
+static inline void rgb16_avx2(__m256i rgb, __m256i *lo, __m256i *hi)
+{
+	__m256i r = _mm256_and_si256(_mm256_srli_epi16(rgb, 8), _mm256_set1_epi16(0xF8));
+	__m256i g = _mm256_and_si256(_mm256_slli_epi16(rgb, 10), _mm256_set1_epi16(0xFC00));
+	__m256i b = _mm256_and_si256(_mm256_srli_epi16(rgb, 3), _mm256_set1_epi16(0xF8));
+	__m256i gb = _mm256_or_si256(g, b);
+	__m256i ar = _mm256_or_si256(r, _mm256_set1_epi16(0xFF00));
+	__m256i first = _mm256_unpacklo_epi16(gb, ar);
+	__m256i second = _mm256_unpackhi_epi16(gb, ar);
+	*lo = _mm256_permute2x128_si256(first, second, 0x20);
+	*hi = _mm256_permute2x128_si256(first, second, 0x31);
+}
+
+__attribute__((target("avx2")))
+static void convert_cry_avx2(uint32_t *dst, uint16_t *src, uint32_t len)
+{
+	for (; len >= 8; len -= 8, src += 8, dst += 8)
+	{
+		_mm256_storeu_si256((__m256i *)dst, cry_avx2(src));
+	}
+	convert_cry_scalar(dst, src, len);
+}
+
+__attribute__((target("avx2")))
+static void convert_rgb16_avx2(uint32_t *dst, uint16_t *src, uint32_t len)
+{
+	for (; len >= 16; len -= 16, src += 16, dst += 16)
+	{
+		__m256i lo, hi;
+		rgb16_avx2(_mm256_loadu_si256((__m256i *)src), &lo, &hi);
+		_mm256_storeu_si256((__m256i *)dst, lo);
+		_mm256_storeu_si256((__m256i *)(dst + 8), hi);
+	}
+	convert_rgb16_scalar(dst, src, len);
+}
+
+__attribute__((target("avx2")))
+static void convert_variable_avx2(uint32_t *dst, uint16_t *src, uint32_t len)
+{
+	for (; len >= 16; len -= 16, src += 16, dst += 16)
+	{
+		__m256i words = _mm256_loadu_si256((__m256i *)src);
+		__m256i lo, hi;
+		rgb16_avx2(_mm256_and_si256(words, _mm256_set1_epi16(0xFFFE)), &lo, &hi);
+		//pixels with the low bit set are RGB16, the rest are CRY
+		__m256i rgb_mask = _mm256_cmpeq_epi16(_mm256_and_si256(words, _mm256_set1_epi16(1)), _mm256_set1_epi16(1));
+		__m256i mask_lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(rgb_mask));
+		__m256i mask_hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(rgb_mask, 1));
+		lo = _mm256_blendv_epi8(cry_avx2(src), lo, mask_lo);
+		hi = _mm256_blendv_epi8(cry_avx2(src + 8), hi, mask_hi);
+		_mm256_storeu_si256((__m256i *)dst, lo);
+		_mm256_storeu_si256((__m256i *)(dst + 8), hi);
+	}
+	convert_variable_scalar(dst, src, len);
+}
+#endif
+
+#ifdef JAG_COLOR_HAS_NEON
+static inline uint8x8_t div255_neon(uint16x8_t x)
+{
+	return vshrn_n_u16(vaddq_u16(vaddq_u16(x, vdupq_n_u16(1)), vshrq_n_u16(x, 8)), 8);
+}
+
+//8 CRY pixels as separate component vectors in blue, green, red, alpha order
+static inline uint8x8x4_t cry_neon(uint16_t *src)
+{
+	uint8_t r[8], g[8], b[8];
+	for (int i = 0; i < 8; i++)
+	{
+		uint32_t base = cry_base[src[i] >> 8];
+		r[i] = base >> 16;
+		g[i] = base >> 8;
+		b[i] = base;
+	}
+	uint8x8_t y = vmovn_u16(vld1q_u16(src));
+	uint8x8x4_t out;
+	out.val[0] = div255_neon(vmull_u8(vld1_u8(b), y));
+	out.val[1] = div255_neon(vmull_u8(vld1_u8(g), y));
+	out.val[2] = div255_neon(vmull_u8(vld1_u8(r), y));
+	out.val[3] = vdup_n_u8(0xFF);
+	return out;
+}
+
+static inline uint8x8x4_t rgb16_neon(uint16x8_t rgb)
+{
+	uint8x8x4_t out;
+	out.val[0] = vmovn_u16(vandq_u16(vshrq_n_u16(rgb, 3), vdupq_n_u16(0xF8)));
+	out.val[1] = vmovn_u16(vandq_u16(vshlq_n_u16(rgb, 2), vdupq_n_u16(0xFC)));
+	out.val[2] = vmovn_u16(vshrq_n_u16(rgb, 8));
+	out.val[2] = vand_u8(out.val[2], vdup_n_u8(0xF8));
+	out.val[3] = vdup_n_u8(0xFF);
+	return out;
+}
+
+static void convert_cry_neon(uint32_t *dst, uint16_t *src, uint32_t len)
+{
+	for (; len >= 8; len -= 8, src += 8, dst += 8)
+	{
+		vst4_u8((uint8_t *)dst, cry_neon(src));
+	}
+	convert_cry_scalar(dst, src, len);
+}
+
+static void convert_rgb16_neon(uint32_t *dst, uint16_t *src, uint32_t len)
+{
+	for (; len >= 8; len -= 8, src += 8, dst += 8)
+	{
+		vst4_u8((uint8_t *)dst, rgb16_neon(vld1q_u16(src)));
+	}
+	convert_rgb16_scalar(dst, src, len);
+}
+
+static void convert_variable_neon(uint32_t *dst, uint16_t *src, uint32_t len)
+{
+	for (; len >= 8; len -= 8, src += 8, dst += 8)
+	{
+		uint16x8_t words = vld1q_u16(src);
+		uint8x8x4_t out = cry_neon(src);
+		uint8x8x4_t rgb = rgb16_neon(vandq_u16(words, vdupq_n_u16(0xFFFE)));
+		//pixels with the low bit set are RGB16, the rest are CRY
+		uint8x8_t rgb_mask = vmovn_u16(vtstq_u16(words, vdupq_n_u16(1)));
+		for (int i = 0; i < 3; i++)
+		{
+			out.val[i] = vbsl_u8(rgb_mask, rgb.val[i], out.val[i]);
+		}
+		vst4_u8((uint8_t *)dst, out);
+	}
+	convert_variable_scalar(dst, src, len);
+}
+#endif
+
+typedef void (*convert_fun)(uint32_t *dst, uint16_t *src, uint32_t len);
+static convert_fun convert_cry = convert_cry_scalar;
+static convert_fun convert_rgb16 = convert_rgb16_scalar;
+static convert_fun convert_variable = convert_variable_scalar;
+
+uint8_t jag_color_supported(uint8_t impl)
+{
+	switch (impl)
+	{
+	case JAG_COLOR_SCALAR:
+		return 1;
+#ifdef __SSE2__
+	case JAG_COLOR_SSE2:
+		return 1;
+#endif
+#ifdef JAG_COLOR_HAS_AVX2
+	case JAG_COLOR_AVX2:
+		return __builtin_cpu_supports("avx2") != 0;
+#endif
+#ifdef JAG_COLOR_HAS_NEON
+	case JAG_COLOR_NEON:
+		return 1;
+#endif
+	}
+	return 0;
+}
+
+void jag_color_select(uint8_t impl)
+{
+	switch (impl)
+	{
+	case JAG_COLOR_SCALAR:
+		convert_cry = convert_cry_scalar;
+		convert_rgb16 = convert_rgb16_scalar;
+		convert_variable = convert_variable_scalar;
+		break;
+#ifdef __SSE2__
+	case JAG_COLOR_SSE2:
+		convert_cry = convert_cry_sse2;
+		convert_rgb16 = convert_rgb16_sse2;
+		convert_variable = convert_variable_sse2;
+		break;
+#endif
+#ifdef JAG_COLOR_HAS_AVX2
+	case JAG_COLOR_AVX2:
+		convert_cry = convert_cry_avx2;
+		convert_rgb16 = convert_rgb16_avx2;
+		convert_variable = convert_variable_avx2;
+		break;
+#endif
+#ifdef JAG_COLOR_HAS_NEON
+	case JAG_COLOR_NEON:
+		convert_cry = convert_cry_neon;
+		convert_rgb16 = convert_rgb16_neon;
+		convert_variable = convert_variable_neon;
+		break;
+#endif
+	}
+}
+
+void jag_color_init(void)
+{
+	for (int i = 0; i < 256; i++)
+	{
+		uint8_t r, g, b;
+		jag_cry_components(i << 8 | 0xFF, &r, &g, &b);
+		cry_base[i] = r << 16 | g << 8 | b;
+	}
+	for (uint8_t impl = JAG_COLOR_NEON; impl > JAG_COLOR_SCALAR; impl--)
+	{
+		if (jag_color_supported(impl)) {
+			jag_color_select(impl);
+			break;
+		}
+	}
+}
+
+void jag_convert_cry(uint32_t *dst, uint16_t *src, uint32_t len)
+{
+	convert_cry(dst, src, len);
+}
+
+void jag_convert_rgb16(uint32_t *dst, uint16_t *src, uint32_t len)
+{
+	convert_rgb16(dst, src, len);
+}
+
+void jag_convert_variable(uint32_t *dst, uint16_t *src, uint32_t len)
+{
+	convert_variable(dst, src, len);
+}
+
+void jag_convert_rgb24(uint32_t *dst, uint16_t *src, uint32_t len)
+{
+	//each pixel is stored as green, red, unused, blue
+	for (; len; len--, src += 2)
+	{
+		*(dst++) = 0xFF000000 | (src[0] & 0xFF) << 16 | (src[0] & 0xFF00) | (src[1] & 0xFF);
+	}
+}
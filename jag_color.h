@@ -0,0 +1,28 @@
+#ifndef JAG_COLOR_H_
+#define JAG_COLOR_H_
+
+#include <stdint.h>
+
+//The line conversion functions write pixels in 0xAARRGGBB format with alpha set to 0xFF
+//which matches render_map_color for 32-bit output
+
+void jag_color_init(void);
+void jag_cry_components(uint16_t cry, uint8_t *r, uint8_t *g, uint8_t *b);
+void jag_rgb16_components(uint16_t rgb, uint8_t *r, uint8_t *g, uint8_t *b);
+void jag_convert_cry(uint32_t *dst, uint16_t *src, uint32_t len);
+void jag_convert_rgb16(uint32_t *dst, uint16_t *src, uint32_t len);
+void jag_convert_variable(uint32_t *dst, uint16_t *src, uint32_t len);
+//each RGB24 pixel takes up two line buffer words
+void jag_convert_rgb24(uint32_t *dst, uint16_t *src, uint32_t len);
+
+//allows the unit test to check each implementation the CPU supports
+enum {
+	JAG_COLOR_SCALAR,
+	JAG_COLOR_SSE2,
+	JAG_COLOR_AVX2,
+	JAG_COLOR_NEON
+};
+uint8_t jag_color_supported(uint8_t impl);
+void jag_color_select(uint8_t impl);
+
+#endif //JAG_COLOR_H_
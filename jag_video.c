@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "jag_video.h"
+#include "jag_color.h"
 #include "jaguar.h"
 #include "render.h"
 
@@ -18,83 +19,45 @@ enum {
 char *vmode_names[] = {
 	"CRY",
 	"RGB24",
-	"RGB16",
 	"DIRECT16",
+	"RGB16",
 	"VARIABLE"
 };
 
-static uint8_t cry_red[9][16] = {
-	{0, 34, 68, 102, 135, 169, 203, 237, 255, 255, 255, 255, 255, 255, 255, 255},
-	{0, 34, 68, 102, 135, 169, 203, 230, 247, 255, 255, 255, 255, 255, 255, 255},
-	{0, 34, 68, 102, 135, 170, 183, 197, 214, 235, 255, 255, 255, 255, 255, 255},
-	{0, 34, 68, 102, 130, 141, 153, 164, 181, 204, 227, 249, 255, 255, 255, 255},
-	{0, 34, 68, 95,  104, 113, 122, 131, 148, 173, 198, 223, 248, 255, 255, 255},
-	{0, 34, 64, 71,  78,  85,  91,  98,  115, 143, 170, 197, 224, 252, 255, 255},
-	{0, 34, 43, 47,  52,  56,  61,  65,  82,  112, 141, 171, 200, 230, 255, 255},
-	{0, 19, 21, 23,  26,  28,  30,  32,  49,  81,  113, 145, 177, 208, 240, 255},
-	{0, 0,  0,  0,   0,   0,   0,   0,   17,  51,  85,  119, 153, 187, 221, 255}
-};
-
-static uint8_t cry_green[16][8] = {
-	{0,   0,   0,   0,   0,   0,   0,   0},
-	{17,  19,  21,  23,  26,  28,  30,  32},
-	{34,  38,  43,  47,  52,  56,  61,  65},
-	{51,  57,  64,  71,  78,  85,  91,  98},
-	{68,  77,  86,  95,  104, 113, 122, 131},
-	{85,  96,  107, 119, 130, 141, 153, 164},
-	{102, 115, 129, 142, 156, 170, 183, 197},
-	{119, 134, 150, 166, 182, 198, 214, 230},
-	{136, 154, 172, 190, 208, 226, 244, 255},
-	{153, 173, 193, 214, 234, 255, 255, 255},
-	{170, 192, 215, 238, 255, 255, 255, 255},
-	{187, 211, 236, 255, 255, 255, 255, 255},
-	{204, 231, 255, 255, 255, 255, 255, 255},
-	{221, 250, 255, 255, 255, 255, 255, 255},
-	{238, 255, 255, 255, 255, 255, 255, 255},
-	{255, 255, 255, 255, 255, 255, 255, 255},
-};
-
-static uint32_t table_cry[0x10000];
-static uint32_t table_rgb[0x10000];
-static uint32_t table_variable[0x10000];
+//lookup tables are only used when the renderer wants something other than 0xAARRGGBB
+static uint32_t *table_cry;
+static uint32_t *table_rgb;
+static uint32_t *table_variable;
 
 static uint32_t cry_to_rgb(uint16_t cry)
 {
-	uint32_t y = cry & 0xFF;
-	if (y) {
-		uint8_t c = cry >> 8 & 0xF;
-		uint8_t r = cry >> 12;
-		
-		uint32_t red = cry_red[c < 7 ? 0 : c - 7][r];
-		uint32_t green = cry_green[c][r < 8 ? r : 15 - r];
-		uint32_t blue = cry_red[c < 7 ? 0 : c - 7][15-r];
-		red = red * y / 255;
-		blue = blue * y / 255;
-		green = green * y / 255;
-		return render_map_color(red, green, blue);
-	} else {
-		return render_map_color(0, 0, 0);
-	}
+	uint8_t r, g, b;
+	jag_cry_components(cry, &r, &g, &b);
+	return render_map_color(r, g, b);
 }
 
 static uint32_t rgb16_to_rgb(uint16_t rgb)
 {
-	return render_map_color(
-		rgb >> 8 & 0xF8,
-		rgb << 2 & 0xFC,
-		rgb >> 4 & 0xF8
-	);
+	uint8_t r, g, b;
+	jag_rgb16_components(rgb, &r, &g, &b);
+	return render_map_color(r, g, b);
 }
 
 jag_video *jag_video_init(void)
 {
 	static uint8_t table_init_done = 0;
 	if (!table_init_done) {
-		for (int i = 0; i < 0x10000; i++)
-		{
-			table_cry[i] = cry_to_rgb(i);
-			table_rgb[i] = rgb16_to_rgb(i);
-			table_variable[i] = i & 1 ? rgb16_to_rgb(i & 0xFFFE) : cry_to_rgb(i);
+		jag_color_init();
+		if (render_map_color(0x12, 0x34, 0x56) != 0xFF123456) {
+			table_cry = malloc(0x10000 * sizeof(uint32_t));
+			table_rgb = malloc(0x10000 * sizeof(uint32_t));
+			table_variable = malloc(0x10000 * sizeof(uint32_t));
+			for (int i = 0; i < 0x10000; i++)
+			{
+				table_cry[i] = cry_to_rgb(i);
+				table_rgb[i] = rgb16_to_rgb(i);
+				table_variable[i] = i & 1 ? rgb16_to_rgb(i & 0xFFFE) : cry_to_rgb(i);
+			}
 		}
 		table_init_done = 1;
 	}
@@ -109,6 +72,21 @@ static void copy_16(uint32_t *dst, uint32_t len, uint16_t *linebuffer, uint32_t
 	}
 }
 
+static void copy_rgb24(uint32_t *dst, uint32_t len, uint16_t *linebuffer)
+{
+	if (len > LINEBUFFER_WORDS / 2) {
+		len = LINEBUFFER_WORDS / 2;
+	}
+	if (table_cry) {
+		for (; len; len--, dst++, linebuffer += 2)
+		{
+			*dst = render_map_color(linebuffer[0], linebuffer[0] >> 8, linebuffer[1]);
+		}
+	} else {
+		jag_convert_rgb24(dst, linebuffer, len);
+	}
+}
+
 static void copy_linebuffer(jag_video *context, uint16_t *linebuffer)
 {
 	if (!context->output) {
@@ -151,19 +129,32 @@ static void copy_linebuffer(jag_video *context, uint16_t *linebuffer)
 	switch (context->mode)
 	{
 	case VMODE_CRY:
-		copy_16(dst, len, linebuffer, table_cry);
+		if (table_cry) {
+			copy_16(dst, len, linebuffer, table_cry);
+		} else {
+			jag_convert_cry(dst, linebuffer, len);
+		}
 		break;
 	case VMODE_RGB24:
-		//TODO: Implement me
+		copy_rgb24(dst, len, linebuffer);
 		break;
 	case VMODE_DIRECT16:
-		//TODO: Implement this once I better understand what would happen on hardware with composite output
-		break;
+		//pixels skip the CRY/RGB conversion and go straight to the output pins,
+		//which carry the same layout as RGB16 on the RGB output we emulate
+		//fall through
 	case VMODE_RGB16:
-		copy_16(dst, len, linebuffer, table_rgb);
+		if (table_rgb) {
+			copy_16(dst, len, linebuffer, table_rgb);
+		} else {
+			jag_convert_rgb16(dst, linebuffer, len);
+		}
 		break;
 	case VMODE_VARIABLE:
-		copy_16(dst, len, linebuffer, table_variable);
+		if (table_variable) {
+			copy_16(dst, len, linebuffer, table_variable);
+		} else {
+			jag_convert_variable(dst, linebuffer, len);
+		}
 		break;
 	}
 }
@@ -189,14 +180,16 @@ enum {
 
 uint32_t jag_cycles_to_halfline(jag_video *context, uint32_t target)
 {
-	uint32_t cycles = context->regs[VID_HPERIOD] - (context->regs[VID_HCOUNT] & 0x3FF);
+	//a half-line covers HCOUNT values 0 through HPERIOD inclusive
+	uint32_t halfline = context->regs[VID_HPERIOD] + 1;
+	uint32_t cycles = halfline - (context->regs[VID_HCOUNT] & 0x3FF);
 	uint32_t num_lines;
 	if (context->regs[VID_VCOUNT] < target) {
 		num_lines = target - 1 - context->regs[VID_VCOUNT];
 	} else {
 		num_lines = target + context->regs[VID_VPERIOD] - context->regs[VID_VCOUNT];
 	}
-	cycles += num_lines * context->regs[VID_HPERIOD];
+	cycles += num_lines * halfline;
 	return cycles;
 }
 
@@ -208,6 +201,103 @@ uint32_t jag_next_vid_interrupt(jag_video *context)
 	return context->cycles + jag_cycles_to_halfline(context, context->regs[VID_VINT]);
 }
 
+static inline uint16_t *op_blit_indexed(jag_video *context, uint16_t *dst, uint64_t phrase, uint8_t bits, uint8_t bpp)
+{
+	uint16_t *clut = context->clut + context->op.pal_offset;
+	uint32_t mask = (1 << bpp) - 1;
+	if (context->op.transparent) {
+		for (; bits; bits -= bpp, dst++)
+		{
+			uint32_t val = phrase >> (bits - bpp) & mask;
+			if (val) {
+				*dst = clut[val];
+			}
+		}
+	} else {
+		for (; bits; bits -= bpp)
+		{
+			*(dst++) = clut[phrase >> (bits - bpp) & mask];
+		}
+	}
+	return dst;
+}
+
+static uint16_t *op_blit_16(jag_video *context, uint16_t *dst, uint64_t phrase, uint8_t bits)
+{
+	if (bits == 64 && !context->op.transparent) {
+		//full opaque phrase, no need to look at individual pixels
+		dst[0] = phrase >> 48;
+		dst[1] = phrase >> 32;
+		dst[2] = phrase >> 16;
+		dst[3] = phrase;
+		return dst + 4;
+	}
+	for (; bits; bits -= 16, dst++)
+	{
+		uint16_t val = phrase >> (bits - 16);
+		if (val || !context->op.transparent) {
+			*dst = val;
+		}
+	}
+	return dst;
+}
+
+static uint16_t *op_blit_phrase(jag_video *context, uint16_t *dst, uint64_t phrase, uint8_t bits)
+{
+	//separate calls for each depth so the shifts and masks are constants
+	switch (context->op.bpp)
+	{
+	case 1:
+		return op_blit_indexed(context, dst, phrase, bits, 1);
+	case 2:
+		return op_blit_indexed(context, dst, phrase, bits, 2);
+	case 4:
+		return op_blit_indexed(context, dst, phrase, bits, 4);
+	case 8:
+		return op_blit_indexed(context, dst, phrase, bits, 8);
+	default:
+		return op_blit_16(context, dst, phrase, bits);
+	}
+}
+
+//Fast path for OBJ_PROCESS that handles a whole line of an unscaled bitmap object at once
+//Produces the same line buffer contents, bus accesses and cycle count as stepping through OBJ_PROCESS
+static void op_process_line(jag_video *context)
+{
+	uint8_t bpp = context->op.bpp;
+	uint8_t bits = 64 - context->op.leftclip;
+	uint16_t *dst = context->write_line_buffer + context->op.lb_offset;
+	uint32_t cycles = 0;
+	//nothing can be written while the first phrase is being fetched
+	uint64_t phrase = jag_read_phrase(context->system, context->op.cur_address, &cycles);
+	context->op.cur_address += context->op.increment;
+	while (--context->op.line_phrases)
+	{
+		uint32_t read_cycles = 0;
+		uint64_t next = jag_read_phrase(context->system, context->op.cur_address, &read_cycles);
+		context->op.cur_address += context->op.increment;
+		//2 pixels are written per cycle, any left over once the next fetch completes take additional cycles
+		uint32_t pixels = bits / bpp;
+		cycles += read_cycles;
+		if (pixels > 2 * read_cycles) {
+			cycles += (pixels - 2 * read_cycles + 1) / 2;
+		}
+		dst = op_blit_phrase(context, dst, phrase, bits);
+		phrase = next;
+		bits = 64;
+	}
+	cycles += (bits / bpp + 1) / 2;
+	dst = op_blit_phrase(context, dst, phrase, bits);
+	
+	context->op.lb_offset = dst - context->write_line_buffer;
+	context->op.im_data = context->op.prefetch = phrase;
+	context->op.im_bits = 0;
+	context->op.has_prefetch = 0;
+	context->op.leftclip = 0;
+	context->op_cycles += cycles;
+	context->op.state = OBJ_HEIGHT_WB;
+}
+
 void op_run(jag_video *context)
 {
 	while (context->op.cycles < context->cycles)
@@ -420,6 +510,15 @@ void op_run(jag_video *context)
 			break;
 		}
 		case OBJ_PROCESS: {
+			if (
+				context->op.type == OBJ_BITMAP && context->op.bpp <= 16
+				&& !context->op.im_bits && !context->op.has_prefetch && context->op.line_phrases
+				&& !(context->op.leftclip & (context->op.bpp - 1))
+				&& context->op.lb_offset + (context->op.line_phrases * 64 - context->op.leftclip) / context->op.bpp <= LINEBUFFER_WORDS
+			) {
+				op_process_line(context);
+				break;
+			}
 			uint32_t proc_cycles = 0;
 			if (!context->op.has_prefetch && context->op.line_phrases) {
 				context->op.prefetch = jag_read_phrase(context->system, context->op.cur_address, &proc_cycles);
@@ -463,7 +562,9 @@ void op_run(jag_video *context)
 					val &= (1 << context->op.bpp) - 1;
 					if (val || !context->op.transparent)
 					{
-						val = context->clut[val + context->op.pal_offset];
+						if (context->op.bpp < 16) {
+							val = context->clut[val + context->op.pal_offset];
+						}
 						context->write_line_buffer[context->op.lb_offset] = val;
 					}
 					context->op.lb_offset++;
@@ -516,74 +617,116 @@ void op_run(jag_video *context)
 	}
 }
 
+//Processes a single pixel clock, only needed on cycles where HCOUNT/VCOUNT hit a value that triggers an event
+static void jag_video_step(jag_video *context)
+{
+	if (
+		(
+			context->regs[VID_HCOUNT] == context->regs[VID_HDISP_BEGIN1]
+			|| context->regs[VID_HCOUNT] == context->regs[VID_HDISP_BEGIN2]
+		)
+		&& context->regs[VID_VCOUNT] >= context->regs[VID_VDISP_BEGIN]
+		&& context->regs[VID_VCOUNT] < context->regs[VID_VDISP_END]
+	) {
+		//swap linebuffers, render linebuffer to framebuffer and kick off object processor
+		if (context->write_line_buffer == context->line_buffer_a) {
+			context->write_line_buffer = context->line_buffer_b;
+			copy_linebuffer(context, context->line_buffer_a);
+		} else {
+			context->write_line_buffer = context->line_buffer_a;
+			copy_linebuffer(context, context->line_buffer_b);
+		}
+		//clear new write line buffer with background color
+		for (int i = 0; i  < LINEBUFFER_WORDS; i++)
+		{
+			context->write_line_buffer[i] = context->regs[VID_BGCOLOR];
+		}
+		
+		//kick off object processor
+		context->op.state = OBJ_FETCH_DESC1;
+	} else if (context->regs[VID_HCOUNT] == context->regs[VID_HDISP_END]) {
+		//stob object processor
+		context->op.state = OBJ_IDLE;
+	}
+	
+	context->cycles++;
+	op_run(context);
+	
+	//advance counters
+	if (
+		!context->output 
+		&& context->regs[VID_VCOUNT] == context->regs[VID_VDISP_BEGIN]
+		&& context->regs[VID_HCOUNT] == context->regs[VID_HDISP_BEGIN1]
+	) {
+		context->output = render_get_framebuffer(FRAMEBUFFER_ODD, &context->output_pitch);
+	} else if (context->output && context->regs[VID_VCOUNT] >= context->regs[VID_VDISP_END]) {
+		int width = (context->regs[VID_HPERIOD] - context->regs[VID_HDISP_BEGIN1] 
+		+ context->regs[VID_HDISP_END] - 1024 + 2) / context->pclock_div;
+		render_framebuffer_updated(FRAMEBUFFER_ODD, width);
+		context->output = NULL;
+	}
+	
+	if ((context->regs[VID_HCOUNT] & 0x3FF) == context->regs[VID_HPERIOD]) {
+		//reset bottom 10 bits to zero, flip the 11th bit which represents which half of the line we're on
+		context->regs[VID_HCOUNT] = (context->regs[VID_HCOUNT] & 0x400) ^ 0x400;
+		//increment half-line counter
+		if (context->regs[VID_VCOUNT] == context->regs[VID_VPERIOD]) {
+			context->regs[VID_VCOUNT] = 0;
+		} else {
+			context->regs[VID_VCOUNT]++;
+			if (context->regs[VID_VCOUNT] == context->regs[VID_VINT]) {
+				context->cpu_int_pending |= BIT_CPU_VID_INT_ENABLED;
+			}
+		}
+	} else {
+		context->regs[VID_HCOUNT]++;
+	}
+}
+
+//Returns the number of pixel clocks that can be run before HCOUNT reaches a value that needs jag_video_step
+static uint32_t cycles_to_video_event(jag_video *context)
+{
+	if (context->output && context->regs[VID_VCOUNT] >= context->regs[VID_VDISP_END]) {
+		//framebuffer still needs to be released
+		return 0;
+	}
+	uint16_t hcount = context->regs[VID_HCOUNT];
+	//the object processor can branch on which half of the line we're in so stop before bit 10 can change
+	uint32_t cycles = 0x3FF - (hcount & 0x3FF);
+	if (context->regs[VID_HPERIOD] <= 0x3FF) {
+		//half-line wrap, only the low 10 bits are compared
+		uint32_t wrap = (context->regs[VID_HPERIOD] - hcount) & 0x3FF;
+		if (wrap < cycles) {
+			cycles = wrap;
+		}
+	}
+	static const uint8_t events[] = {VID_HDISP_BEGIN1, VID_HDISP_BEGIN2, VID_HDISP_END};
+	for (int i = 0; i < sizeof(events); i++)
+	{
+		uint32_t event_cycles = (uint16_t)(context->regs[events[i]] - hcount);
+		if (event_cycles < cycles) {
+			cycles = event_cycles;
+		}
+	}
+	return cycles;
+}
+
 void jag_video_run(jag_video *context, uint32_t target_cycle)
 {
 	if (context->regs[VID_VMODE] & BIT_TBGEN) {
 		while (context->cycles < target_cycle)
 		{
-			//TODO: Optimize this to not actually increment one step at a time
-			if (
-				(
-					context->regs[VID_HCOUNT] == context->regs[VID_HDISP_BEGIN1]
-					|| context->regs[VID_HCOUNT] == context->regs[VID_HDISP_BEGIN2]
-				)
-				&& context->regs[VID_VCOUNT] >= context->regs[VID_VDISP_BEGIN]
-				&& context->regs[VID_VCOUNT] < context->regs[VID_VDISP_END]
-			) {
-				//swap linebuffers, render linebuffer to framebuffer and kick off object processor
-				if (context->write_line_buffer == context->line_buffer_a) {
-					context->write_line_buffer = context->line_buffer_b;
-					copy_linebuffer(context, context->line_buffer_a);
-				} else {
-					context->write_line_buffer = context->line_buffer_a;
-					copy_linebuffer(context, context->line_buffer_b);
-				}
-				//clear new write line buffer with background color
-				for (int i = 0; i  < LINEBUFFER_WORDS; i++)
-				{
-					context->write_line_buffer[i] = context->regs[VID_BGCOLOR];
-				}
-				
-				//kick off object processor
-				context->op.state = OBJ_FETCH_DESC1;
-			} else if (context->regs[VID_HCOUNT] == context->regs[VID_HDISP_END]) {
-				//stob object processor
-				context->op.state = OBJ_IDLE;
+			jag_video_step(context);
+			//nothing but the object processor and HCOUNT changes until the next event so run the whole span at once
+			uint32_t span = cycles_to_video_event(context);
+			if (span > target_cycle - context->cycles) {
+				span = target_cycle - context->cycles;
 			}
-			
-			context->cycles++;
-			op_run(context);
-			
-			//advance counters
-			if (
-				!context->output 
-				&& context->regs[VID_VCOUNT] == context->regs[VID_VDISP_BEGIN]
-				&& context->regs[VID_HCOUNT] == context->regs[VID_HDISP_BEGIN1]
-			) {
-				context->output = render_get_framebuffer(FRAMEBUFFER_ODD, &context->output_pitch);
-			} else if (context->output && context->regs[VID_VCOUNT] >= context->regs[VID_VDISP_END]) {
-				int width = (context->regs[VID_HPERIOD] - context->regs[VID_HDISP_BEGIN1] 
-				+ context->regs[VID_HDISP_END] - 1024 + 2) / context->pclock_div;
-				render_framebuffer_updated(FRAMEBUFFER_ODD, width);
-				context->output = NULL;
+			if (span) {
+				context->cycles += span;
+				op_run(context);
+				context->regs[VID_HCOUNT] += span;
 			}
-			
-			if ((context->regs[VID_HCOUNT] & 0x3FF) == context->regs[VID_HPERIOD]) {
-				//reset bottom 10 bits to zero, flip the 11th bit which represents which half of the line we're on
-				context->regs[VID_HCOUNT] = (context->regs[VID_HCOUNT] & 0x400) ^ 0x400;
-				//increment half-line counter
-				if (context->regs[VID_VCOUNT] == context->regs[VID_VPERIOD]) {
-					context->regs[VID_VCOUNT] = 0;
-				} else {
-					context->regs[VID_VCOUNT]++;
-					if (context->regs[VID_VCOUNT] == context->regs[VID_VINT]) {
-						context->cpu_int_pending |= BIT_CPU_VID_INT_ENABLED;
-					}
-				}
-			} else {
-				context->regs[VID_HCOUNT]++;
-			}
-			
 		}
 	} else {
 		context->cycles = target_cycle;
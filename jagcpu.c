@@ -1,5 +1,6 @@
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "jagcpu.h"
 
 char *gpu_mnemonics[] = {
@@ -193,7 +194,7 @@ char * jag_cc_names[] = {
 	"f",
 	"f",
 	"f",
-	"f"
+	"f",
 	"t_alt",
 	"ne_alt",
 	"eq_alt",
@@ -216,9 +217,9 @@ char * jag_cc(uint16_t inst)
 	return jag_cc_names[ccnum];
 }
 
-uint8_t jag_is_alwyas_falsse(uint16_t cond)
+uint8_t jag_is_always_false(uint16_t cond)
 {
-	return (cond & 3) == 3 || (cond && 0xC) == 0xC;
+	return (cond & 3) == 3 || (cond & 0xC) == 0xC;
 }
 
 uint32_t jag_jr_dest(uint16_t inst, uint32_t address)
@@ -308,3 +309,861 @@ int jag_cpu_disasm(uint16_t **stream, uint32_t address, char *dst, uint8_t is_gp
 		}
 	}
 }
+
+uint8_t jag_inst_words(uint16_t inst)
+{
+	return jag_opcode(inst, 1) == JAG_MOVEI ? 3 : 1;
+}
+
+//mask of the current bank registers read by an instruction
+static uint32_t jag_source_regs(uint16_t inst, uint8_t is_gpu)
+{
+	uint16_t opcode = jag_opcode(inst, is_gpu);
+	uint32_t reg1 = 1 << jag_reg1(inst), reg2 = 1 << jag_reg2(inst);
+	switch (opcode)
+	{
+	case JAG_MOVEQ:
+	case JAG_MOVEI:
+	case JAG_MOVEFA:
+	case JAG_RESMAC:
+	case JAG_MOVE_PC:
+	case JAG_JR:
+	case JAG_NOP:
+	case JAG_MMULT:
+		return 0;
+	case JAG_MOVE:
+	case JAG_MOVETA:
+	case JAG_MTOI:
+	case JAG_NORMI:
+	case JAG_LOADB:
+	case JAG_LOADW:
+	case JAG_LOAD:
+	case JAG_JUMP:
+		return reg1;
+	case GPU_LOADP:
+		return is_gpu ? reg1 : reg2;
+	case GPU_SAT24:
+		return is_gpu ? reg2 : 0;
+	case JAG_LOAD_R14_REL:
+		return 1 << 14;
+	case JAG_LOAD_R15_REL:
+		return 1 << 15;
+	case JAG_LOAD_R14_INDEXED:
+		return 1 << 14 | reg1;
+	case JAG_LOAD_R15_INDEXED:
+		return 1 << 15 | reg1;
+	case JAG_STORE_R14_REL:
+		return 1 << 14 | reg2;
+	case JAG_STORE_R15_REL:
+		return 1 << 15 | reg2;
+	case JAG_STORE_R14_INDEXED:
+		return 1 << 14 | reg1 | reg2;
+	case JAG_STORE_R15_INDEXED:
+		return 1 << 15 | reg1 | reg2;
+	default:
+		if (
+			is_quick_1_32_opcode(opcode, is_gpu) || is_quick_0_31_opcode(opcode)
+			|| is_single_source(opcode, is_gpu) || opcode == JAG_CMPQ
+		) {
+			return reg2;
+		}
+		return reg1 | reg2;
+	}
+}
+
+//register an instruction leaves in the pipeline for the next instruction
+//MOVE and friends use a shorter path and have their result available immediately
+int8_t jag_result_reg(uint16_t inst, uint8_t is_gpu)
+{
+	switch (jag_opcode(inst, is_gpu))
+	{
+	case JAG_BTST:
+	case JAG_IMULTN:
+	case JAG_IMACN:
+	case JAG_CMP:
+	case JAG_CMPQ:
+	case JAG_MOVE:
+	case JAG_MOVEQ:
+	case JAG_MOVETA:
+	case JAG_MOVEFA:
+	case JAG_MOVE_PC:
+	case JAG_STOREB:
+	case JAG_STOREW:
+	case JAG_STORE:
+	case JAG_STORE_R14_REL:
+	case JAG_STORE_R15_REL:
+	case JAG_STORE_R14_INDEXED:
+	case JAG_STORE_R15_INDEXED:
+	case JAG_JUMP:
+	case JAG_JR:
+	case JAG_NOP:
+		return JAGCPU_NOREG;
+	case GPU_STOREP:
+		return is_gpu ? JAGCPU_NOREG : jag_reg2(inst);
+	case GPU_SAT24:
+		return is_gpu ? jag_reg2(inst) : JAGCPU_NOREG;
+	default:
+		return jag_reg2(inst);
+	}
+}
+
+uint8_t jag_sets_flags(uint16_t inst, uint8_t is_gpu)
+{
+	switch (jag_opcode(inst, is_gpu))
+	{
+	case JAG_ADDQT:
+	case JAG_SUBQT:
+	case JAG_RESMAC:
+	case JAG_IMACN:
+	case JAG_DIV:
+	case JAG_MOVE:
+	case JAG_MOVEQ:
+	case JAG_MOVETA:
+	case JAG_MOVEFA:
+	case JAG_MOVEI:
+	case JAG_LOADB:
+	case JAG_LOADW:
+	case JAG_LOAD:
+	case JAG_LOAD_R14_REL:
+	case JAG_LOAD_R15_REL:
+	case JAG_STOREB:
+	case JAG_STOREW:
+	case JAG_STORE:
+	case JAG_STORE_R14_REL:
+	case JAG_STORE_R15_REL:
+	case JAG_MOVE_PC:
+	case JAG_JUMP:
+	case JAG_JR:
+	case JAG_NOP:
+	case JAG_LOAD_R14_INDEXED:
+	case JAG_LOAD_R15_INDEXED:
+	case JAG_STORE_R14_INDEXED:
+	case JAG_STORE_R15_INDEXED:
+	case GPU_UNPACK:
+		return 0;
+	case GPU_LOADP:
+	case GPU_STOREP:
+	case GPU_PACK:
+		return !is_gpu;
+	case GPU_SAT24:
+		return is_gpu;
+	default:
+		return 1;
+	}
+}
+
+//Pipeline hazard model: an instruction that reads the register the previous instruction
+//is still writing back waits a cycle on the scoreboard, as does a conditional jump that
+//tests flags set by the previous instruction
+uint32_t jag_stall_cycles(uint16_t inst, uint8_t is_gpu, int8_t resultreg, uint8_t flags_pending)
+{
+	if (resultreg != JAGCPU_NOREG && (jag_source_regs(inst, is_gpu) & (1 << resultreg))) {
+		return 1;
+	}
+	if (flags_pending) {
+		uint16_t opcode = jag_opcode(inst, is_gpu);
+		if ((opcode == JAG_JR || opcode == JAG_JUMP) && (jag_reg2(inst) & 0xF)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void jag_update_banks(jag_cpu *context)
+{
+	//interrupt handlers always run with bank 0
+	if ((context->flags & JAG_FLAG_REGPAGE) && !(context->flags & JAG_FLAG_IMASK)) {
+		context->main = context->regs + 32;
+		context->alt = context->regs;
+	} else {
+		context->main = context->regs;
+		context->alt = context->regs + 32;
+	}
+}
+
+jag_cpu *init_jag_cpu(jag_cpu_options *opts, uint32_t *local, void *system)
+{
+	jag_cpu *context = calloc(1, sizeof(jag_cpu));
+	context->opts = opts;
+	context->local = local;
+	context->system = system;
+	context->is_gpu = opts->is_gpu;
+	context->resultreg = JAGCPU_NOREG;
+	context->pc = opts->local_start;
+	jag_update_banks(context);
+	return context;
+}
+
+static uint8_t jag_is_local(jag_cpu *context, uint32_t address)
+{
+	return address - context->opts->local_start < context->opts->local_bytes;
+}
+
+static uint8_t jag_is_ctrl(jag_cpu *context, uint32_t address)
+{
+	return address - context->opts->ctrl_start < (context->is_gpu ? DSP_MACHI : JAG_NUM_CTRL) * 4;
+}
+
+uint16_t jag_cpu_fetch(jag_cpu *context, uint32_t address)
+{
+	address &= 0xFFFFFE;
+	if (jag_is_local(context, address)) {
+		uint32_t offset = address - context->opts->local_start;
+		return context->local[offset >> 2] >> (offset & 2 ? 0 : 16);
+	}
+	return context->opts->read_16(address, context->system);
+}
+
+uint32_t jag_cpu_read_ctrl(jag_cpu *context, uint32_t reg)
+{
+	switch (reg)
+	{
+	case JAG_FLAGS:
+		return context->flags | context->flag_z | context->flag_c << 1 | context->flag_n << 2;
+	case JAG_MTXC:
+		return context->matrix_control;
+	case JAG_MTXA:
+		return context->matrix_address;
+	case JAG_END:
+		return context->data_org;
+	case JAG_PC:
+		return context->pc;
+	case JAG_CTRL:
+		return context->ctrl | (context->int_pending & 0x1F) << 6 | (context->int_pending & 0x20) << 11;
+	case JAG_HIDATA:
+		return context->is_gpu ? context->gpu.hidata : context->dsp.modulo;
+	case JAG_DIVCTRL:
+		return context->remainder;
+	case DSP_MACHI:
+		return (int32_t)(context->accumulator >> 32) & 0xFF;
+	}
+	return 0xFFFFFFFF;
+}
+
+//returns non-zero so translated code goes back to the dispatcher,
+//these writes can stop the CPU, switch register banks or unmask interrupts
+uint32_t jag_cpu_write_ctrl(jag_cpu *context, uint32_t reg, uint32_t value)
+{
+	switch (reg)
+	{
+	case JAG_FLAGS: {
+		context->flag_z = value & 1;
+		context->flag_c = value >> 1 & 1;
+		context->flag_n = value >> 2 & 1;
+		context->int_pending &= ~((value >> 9 & 0x1F) | (value >> 12 & 0x20));
+		uint32_t keep = 0x1F0 | JAG_FLAG_REGPAGE | DSP_FLAG_DMAEN;
+		if (!context->is_gpu) {
+			keep |= 0x10000;
+		}
+		//IMASK can only be cleared by a write
+		context->flags = (value & keep) | (context->flags & value & JAG_FLAG_IMASK);
+		jag_update_banks(context);
+		break;
+	}
+	case JAG_MTXC:
+		context->matrix_control = value & 0x1F;
+		break;
+	case JAG_MTXA:
+		context->matrix_address = value & 0xFFFFFC;
+		break;
+	case JAG_END:
+		context->data_org = value;
+		break;
+	case JAG_PC:
+		context->pc = value & 0xFFFFFE;
+		break;
+	case JAG_CTRL:
+		if (value & JAG_CTRL_FORCEINT) {
+			jag_cpu_interrupt(context, 0);
+		}
+		if ((value & JAG_CTRL_CPUINT) && context->opts->cpu_int) {
+			context->opts->cpu_int(context->system, context->is_gpu);
+		}
+		context->ctrl = value & ~(JAG_CTRL_CPUINT | JAG_CTRL_FORCEINT | 0x107C0);
+		break;
+	case JAG_HIDATA:
+		if (context->is_gpu) {
+			context->gpu.hidata = value;
+		} else {
+			context->dsp.modulo = value;
+		}
+		break;
+	case JAG_DIVCTRL:
+		context->divctrl = value & 1;
+		break;
+	}
+	return 1;
+}
+
+void jag_cpu_interrupt(jag_cpu *context, uint8_t num)
+{
+	context->int_pending |= 1 << num;
+}
+
+void jag_cpu_local_written(jag_cpu *context, uint32_t offset)
+{
+	uint8_t *code_flags = context->opts->code_flags;
+	if (code_flags && code_flags[offset >> 2]) {
+		context->code_dirty = 1;
+	}
+}
+
+static uint32_t jag_local_write(jag_cpu *context, uint32_t offset)
+{
+	jag_cpu_local_written(context, offset);
+	return context->code_dirty;
+}
+
+uint32_t jag_cpu_read_32(jag_cpu *context, uint32_t address)
+{
+	address &= 0xFFFFFC;
+	if (jag_is_local(context, address)) {
+		return context->local[(address - context->opts->local_start) >> 2];
+	}
+	if (jag_is_ctrl(context, address)) {
+		return jag_cpu_read_ctrl(context, (address - context->opts->ctrl_start) >> 2);
+	}
+	context->cycles += context->opts->gen.bus_cycles;
+	uint32_t value = context->opts->read_16(address, context->system) << 16;
+	return value | context->opts->read_16(address + 2, context->system);
+}
+
+uint32_t jag_cpu_read_16(jag_cpu *context, uint32_t address)
+{
+	address &= 0xFFFFFE;
+	if (jag_is_local(context, address) || jag_is_ctrl(context, address)) {
+		return jag_cpu_read_32(context, address) >> (address & 2 ? 0 : 16) & 0xFFFF;
+	}
+	context->cycles += context->opts->gen.bus_cycles;
+	return context->opts->read_16(address, context->system);
+}
+
+uint32_t jag_cpu_read_8(jag_cpu *context, uint32_t address)
+{
+	return jag_cpu_read_16(context, address) >> (address & 1 ? 0 : 8) & 0xFF;
+}
+
+uint32_t jag_cpu_loadp(jag_cpu *context, uint32_t address)
+{
+	context->gpu.hidata = jag_cpu_read_32(context, address);
+	return jag_cpu_read_32(context, address + 4);
+}
+
+//write helpers return non-zero when translated code needs to stop after the store
+uint32_t jag_cpu_write_32(jag_cpu *context, uint32_t address, uint32_t value)
+{
+	address &= 0xFFFFFC;
+	if (jag_is_local(context, address)) {
+		uint32_t offset = address - context->opts->local_start;
+		context->local[offset >> 2] = value;
+		return jag_local_write(context, offset);
+	}
+	if (jag_is_ctrl(context, address)) {
+		return jag_cpu_write_ctrl(context, (address - context->opts->ctrl_start) >> 2, value);
+	}
+	context->cycles += context->opts->gen.bus_cycles;
+	context->opts->write_16(address, context->system, value >> 16);
+	context->opts->write_16(address + 2, context->system, value);
+	return 0;
+}
+
+static uint32_t jag_write_partial(jag_cpu *context, uint32_t address, uint32_t value, uint32_t mask)
+{
+	uint32_t shift = (3 - (address & 3)) * 8;
+	uint32_t old = jag_cpu_read_32(context, address);
+	return jag_cpu_write_32(context, address, (old & ~(mask << shift)) | (value & mask) << shift);
+}
+
+uint32_t jag_cpu_write_16(jag_cpu *context, uint32_t address, uint32_t value)
+{
+	address &= 0xFFFFFE;
+	if (jag_is_local(context, address) || jag_is_ctrl(context, address)) {
+		return jag_write_partial(context, address, value, 0xFFFF);
+	}
+	context->cycles += context->opts->gen.bus_cycles;
+	context->opts->write_16(address, context->system, value);
+	return 0;
+}
+
+uint32_t jag_cpu_write_8(jag_cpu *context, uint32_t address, uint32_t value)
+{
+	address &= 0xFFFFFF;
+	if (jag_is_local(context, address) || jag_is_ctrl(context, address)) {
+		return jag_write_partial(context, address, value, 0xFF);
+	}
+	context->cycles += context->opts->gen.bus_cycles;
+	context->opts->write_8(address, context->system, value);
+	return 0;
+}
+
+uint32_t jag_cpu_storep(jag_cpu *context, uint32_t address, uint32_t value)
+{
+	uint32_t ret = jag_cpu_write_32(context, address, context->gpu.hidata);
+	return ret | jag_cpu_write_32(context, address + 4, value);
+}
+
+static void jag_set_zn(jag_cpu *context, uint32_t value)
+{
+	context->flag_z = !value;
+	context->flag_n = value >> 31;
+}
+
+static uint32_t jag_saturate(jag_cpu *context, int32_t value, int32_t min, int32_t max)
+{
+	if (value < min) {
+		value = min;
+	} else if (value > max) {
+		value = max;
+	}
+	jag_set_zn(context, value);
+	return value;
+}
+
+//Executes the instructions that only operate on registers
+void jag_cpu_exec_alu(jag_cpu *context, uint16_t inst)
+{
+	uint8_t is_gpu = context->is_gpu;
+	uint32_t *regs = context->main;
+	uint16_t opcode = jag_opcode(inst, is_gpu);
+	uint8_t dst = jag_reg2(inst);
+	uint32_t src = regs[jag_reg1(inst)];
+	uint32_t quick = jag_quick(inst);
+	uint32_t d = regs[dst];
+	uint64_t tmp;
+	uint32_t res;
+	switch (opcode)
+	{
+	case JAG_ADD:
+		tmp = (uint64_t)d + src;
+		goto add_sub_flags;
+	case JAG_ADDC:
+		tmp = (uint64_t)d + src + context->flag_c;
+		goto add_sub_flags;
+	case JAG_ADDQ:
+		tmp = (uint64_t)d + quick;
+		goto add_sub_flags;
+	case JAG_ADDQT:
+		regs[dst] = d + quick;
+		break;
+	case JAG_SUB:
+		tmp = (uint64_t)d - src;
+		goto add_sub_flags;
+	case JAG_SUBC:
+		tmp = (uint64_t)d - src - context->flag_c;
+		goto add_sub_flags;
+	case JAG_SUBQ:
+		tmp = (uint64_t)d - quick;
+		goto add_sub_flags;
+	case JAG_SUBQT:
+		regs[dst] = d - quick;
+		break;
+	case JAG_NEG:
+		tmp = 0 - (uint64_t)d;
+	add_sub_flags:
+		regs[dst] = tmp;
+		jag_set_zn(context, tmp);
+		context->flag_c = tmp >> 32 & 1;
+		break;
+	case JAG_AND:
+		regs[dst] = d & src;
+		jag_set_zn(context, regs[dst]);
+		break;
+	case JAG_OR:
+		regs[dst] = d | src;
+		jag_set_zn(context, regs[dst]);
+		break;
+	case JAG_XOR:
+		regs[dst] = d ^ src;
+		jag_set_zn(context, regs[dst]);
+		break;
+	case JAG_NOT:
+		regs[dst] = ~d;
+		jag_set_zn(context, regs[dst]);
+		break;
+	case JAG_BTST:
+		context->flag_z = !(d >> jag_reg1(inst) & 1);
+		break;
+	case JAG_BSET:
+		regs[dst] = d | 1 << jag_reg1(inst);
+		jag_set_zn(context, regs[dst]);
+		break;
+	case JAG_BCLR:
+		regs[dst] = d & ~(1 << jag_reg1(inst));
+		jag_set_zn(context, regs[dst]);
+		break;
+	case JAG_MULT:
+		regs[dst] = (d & 0xFFFF) * (src & 0xFFFF);
+		jag_set_zn(context, regs[dst]);
+		break;
+	case JAG_IMULT:
+		regs[dst] = (int16_t)d * (int16_t)src;
+		jag_set_zn(context, regs[dst]);
+		break;
+	case JAG_IMULTN:
+		res = (int16_t)d * (int16_t)src;
+		context->accumulator = (int32_t)res;
+		jag_set_zn(context, res);
+		break;
+	case JAG_RESMAC:
+		regs[dst] = context->accumulator;
+		break;
+	case JAG_IMACN:
+		context->accumulator += (int16_t)d * (int16_t)src;
+		break;
+	case JAG_DIV:
+		//the divide unit takes 16 cycles
+		context->cycles += 15;
+		if (!src) {
+			regs[dst] = 0xFFFFFFFF;
+		} else if (context->divctrl & 1) {
+			regs[dst] = ((uint64_t)d << 16) / src;
+			context->remainder = ((uint64_t)d << 16) % src;
+		} else {
+			regs[dst] = d / src;
+			context->remainder = d % src;
+		}
+		break;
+	case JAG_ABS:
+		context->flag_c = d >> 31;
+		regs[dst] = context->flag_c ? -d : d;
+		context->flag_z = !d;
+		context->flag_n = 0;
+		break;
+	case JAG_SH:
+		if (src & 0x80000000) {
+			src = -src;
+			context->flag_c = d >> 31;
+			res = src >= 32 ? 0 : d << src;
+		} else {
+			context->flag_c = d & 1;
+			res = src >= 32 ? 0 : d >> src;
+		}
+		regs[dst] = res;
+		jag_set_zn(context, res);
+		break;
+	case JAG_SHLQ:
+		//the assembler stores 32 - shift in the immediate field
+		context->flag_c = d >> 31;
+		regs[dst] = d << (32 - quick);
+		jag_set_zn(context, regs[dst]);
+		break;
+	case JAG_SHRQ:
+		context->flag_c = d & 1;
+		regs[dst] = quick == 32 ? 0 : d >> quick;
+		jag_set_zn(context, regs[dst]);
+		break;
+	case JAG_SHA:
+		if (src & 0x80000000) {
+			src = -src;
+			context->flag_c = d >> 31;
+			res = src >= 32 ? 0 : d << src;
+		} else {
+			context->flag_c = d & 1;
+			res = (int32_t)d >> (src >= 32 ? 31 : src);
+		}
+		regs[dst] = res;
+		jag_set_zn(context, res);
+		break;
+	case JAG_SHARQ:
+		context->flag_c = d & 1;
+		regs[dst] = (int32_t)d >> (quick == 32 ? 31 : quick);
+		jag_set_zn(context, regs[dst]);
+		break;
+	case JAG_ROR:
+		quick = src;
+	case JAG_RORQ:
+		quick &= 31;
+		context->flag_c = d >> 31;
+		regs[dst] = quick ? d >> quick | d << (32 - quick) : d;
+		jag_set_zn(context, regs[dst]);
+		break;
+	case JAG_CMP:
+		tmp = (uint64_t)d - src;
+		goto cmp_flags;
+	case JAG_CMPQ:
+		res = jag_reg1(inst);
+		if (res & 0x10) {
+			res |= 0xFFFFFFE0;
+		}
+		tmp = (uint64_t)d - res;
+	cmp_flags:
+		jag_set_zn(context, tmp);
+		context->flag_c = tmp >> 32 & 1;
+		break;
+	case GPU_SAT8:
+		if (is_gpu) {
+			regs[dst] = jag_saturate(context, d, 0, 0xFF);
+		} else {
+			//DSP_SUBQMOD
+			tmp = (uint64_t)d - quick;
+			goto modulo;
+		}
+		break;
+	case GPU_SAT16:
+		if (is_gpu) {
+			regs[dst] = jag_saturate(context, d, 0, 0xFFFF);
+		} else {
+			//DSP_SAT16S
+			regs[dst] = jag_saturate(context, d, -0x8000, 0x7FFF);
+		}
+		break;
+	case JAG_MOVE:
+		regs[dst] = src;
+		break;
+	case JAG_MOVEQ:
+		regs[dst] = jag_reg1(inst);
+		break;
+	case JAG_MOVETA:
+		context->alt[dst] = src;
+		break;
+	case JAG_MOVEFA:
+		regs[dst] = context->alt[jag_reg1(inst)];
+		break;
+	case DSP_SAT32S: {
+		int64_t high = context->accumulator >> 32;
+		regs[dst] = high < -1 ? 0x80000000 : high > 0 ? 0x7FFFFFFF : d;
+		jag_set_zn(context, regs[dst]);
+		break;
+	}
+	case DSP_MIRROR:
+		res = 0;
+		for (int i = 0; i < 32; i++)
+		{
+			res = res << 1 | (d >> i & 1);
+		}
+		regs[dst] = res;
+		jag_set_zn(context, res);
+		break;
+	case JAG_MMULT: {
+		uint32_t count = context->matrix_control & 0xF;
+		uint32_t step = context->matrix_control & 0x10 ? count * 2 : 2;
+		uint32_t address = context->matrix_address;
+		int64_t sum = 0;
+		for (uint32_t i = 0; i < count; i++, address += step)
+		{
+			uint32_t pair = context->alt[(jag_reg1(inst) + i / 2) & 31];
+			sum += (int16_t)(i & 1 ? pair : pair >> 16) * (int16_t)jag_cpu_read_16(context, address);
+		}
+		context->cycles += count;
+		regs[dst] = sum;
+		jag_set_zn(context, regs[dst]);
+		break;
+	}
+	case JAG_MTOI:
+		regs[dst] = ((int32_t)src >> 8 & 0xFF800000) | (src & 0x7FFFFF);
+		jag_set_zn(context, regs[dst]);
+		break;
+	case JAG_NORMI:
+		res = 0;
+		if (src) {
+			while (!(src & 0xFFC00000))
+			{
+				src <<= 1;
+				res--;
+			}
+			while (src & 0xFF800000)
+			{
+				src >>= 1;
+				res++;
+			}
+		}
+		regs[dst] = res;
+		jag_set_zn(context, res);
+		break;
+	case GPU_SAT24:
+		if (is_gpu) {
+			regs[dst] = jag_saturate(context, d, 0, 0xFFFFFF);
+		}
+		break;
+	case GPU_PACK:
+		if (is_gpu) {
+			regs[dst] = (d >> 10 & 0xF000) | (d >> 5 & 0xF00) | (d & 0xFF);
+			break;
+		}
+		//DSP_ADDQMOD
+		tmp = (uint64_t)d + quick;
+	modulo:
+		res = (tmp & ~context->dsp.modulo) | (d & context->dsp.modulo);
+		regs[dst] = res;
+		jag_set_zn(context, res);
+		context->flag_c = tmp >> 32 & 1;
+		break;
+	case GPU_UNPACK:
+		regs[dst] = (d & 0xF000) << 10 | (d & 0xF00) << 5 | (d & 0xFF);
+		break;
+	}
+}
+
+static uint8_t jag_cond_true(jag_cpu *context, uint16_t cond)
+{
+	if ((cond & 1) && context->flag_z) {
+		return 0;
+	}
+	if ((cond & 2) && !context->flag_z) {
+		return 0;
+	}
+	uint8_t flag = cond & 0x10 ? context->flag_n : context->flag_c;
+	if ((cond & 4) && flag) {
+		return 0;
+	}
+	if ((cond & 8) && !flag) {
+		return 0;
+	}
+	return 1;
+}
+
+static void jag_execute_inst(jag_cpu *context, uint16_t inst, uint32_t address, uint8_t delay_slot)
+{
+	uint8_t is_gpu = context->is_gpu;
+	uint16_t opcode = jag_opcode(inst, is_gpu);
+	uint32_t *regs = context->main;
+	uint8_t dst = jag_reg2(inst), src = jag_reg1(inst);
+	context->cycles++;
+	switch (opcode)
+	{
+	case JAG_MOVEI:
+		regs[dst] = jag_cpu_fetch(context, context->pc) | jag_cpu_fetch(context, context->pc + 2) << 16;
+		context->pc += 4;
+		break;
+	case JAG_LOADB:
+		regs[dst] = jag_cpu_read_8(context, regs[src]);
+		break;
+	case JAG_LOADW:
+		regs[dst] = jag_cpu_read_16(context, regs[src]);
+		break;
+	case JAG_LOAD:
+		regs[dst] = jag_cpu_read_32(context, regs[src]);
+		break;
+	case JAG_LOAD_R14_REL:
+	case JAG_LOAD_R15_REL:
+		regs[dst] = jag_cpu_read_32(context, regs[opcode == JAG_LOAD_R14_REL ? 14 : 15] + jag_quick(inst) * 4);
+		break;
+	case JAG_LOAD_R14_INDEXED:
+	case JAG_LOAD_R15_INDEXED:
+		regs[dst] = jag_cpu_read_32(context, regs[opcode == JAG_LOAD_R14_INDEXED ? 14 : 15] + regs[src]);
+		break;
+	case JAG_STOREB:
+		jag_cpu_write_8(context, regs[src], regs[dst]);
+		break;
+	case JAG_STOREW:
+		jag_cpu_write_16(context, regs[src], regs[dst]);
+		break;
+	case JAG_STORE:
+		jag_cpu_write_32(context, regs[src], regs[dst]);
+		break;
+	case JAG_STORE_R14_REL:
+	case JAG_STORE_R15_REL:
+		jag_cpu_write_32(context, regs[opcode == JAG_STORE_R14_REL ? 14 : 15] + jag_quick(inst) * 4, regs[dst]);
+		break;
+	case JAG_STORE_R14_INDEXED:
+	case JAG_STORE_R15_INDEXED:
+		jag_cpu_write_32(context, regs[opcode == JAG_STORE_R14_INDEXED ? 14 : 15] + regs[src], regs[dst]);
+		break;
+	case GPU_LOADP:
+		if (is_gpu) {
+			regs[dst] = jag_cpu_loadp(context, regs[src]);
+		} else {
+			jag_cpu_exec_alu(context, inst);
+		}
+		break;
+	case GPU_STOREP:
+		if (is_gpu) {
+			jag_cpu_storep(context, regs[src], regs[dst]);
+		} else {
+			jag_cpu_exec_alu(context, inst);
+		}
+		break;
+	case JAG_MOVE_PC:
+		regs[dst] = address;
+		break;
+	case JAG_JUMP:
+	case JAG_JR: {
+		if (delay_slot) {
+			//jumps in a delay slot are ignored
+			break;
+		}
+		uint32_t target = opcode == JAG_JR ? jag_jr_dest(inst, address) : regs[src] & 0xFFFFFE;
+		uint8_t taken = jag_cond_true(context, dst);
+		uint32_t delay = context->pc;
+		uint16_t delay_inst = jag_cpu_fetch(context, delay);
+		if (taken) {
+			//pipeline refill
+			context->cycles += 2;
+			context->branch_pc = target;
+		} else {
+			context->branch_pc = delay + jag_inst_words(delay_inst) * 2;
+		}
+		//the instruction after a jump always executes before the jump takes effect
+		context->pc = delay + 2;
+		jag_execute_inst(context, delay_inst, delay, 1);
+		context->pc = context->branch_pc;
+		return;
+	}
+	default:
+		jag_cpu_exec_alu(context, inst);
+	}
+	context->resultreg = jag_result_reg(inst, is_gpu);
+	context->flags_pending = jag_sets_flags(inst, is_gpu);
+}
+
+static void jag_check_interrupts(jag_cpu *context)
+{
+	if (context->flags & JAG_FLAG_IMASK) {
+		return;
+	}
+	uint8_t active = context->int_pending & ((context->flags >> 4 & 0x1F) | (context->flags >> 11 & 0x20));
+	if (!active) {
+		return;
+	}
+	uint8_t num = JAG_CPU_INTS - 1;
+	while (!(active & 1 << num))
+	{
+		num--;
+	}
+	context->flags |= JAG_FLAG_IMASK;
+	jag_update_banks(context);
+	context->main[31] -= 4;
+	jag_cpu_write_32(context, context->main[31], context->pc - 2);
+	context->pc = context->opts->local_start + num * 0x10;
+}
+
+//Handles work done between instructions, interrupts and pipeline stalls
+void jag_cpu_begin_inst(jag_cpu *context)
+{
+	jag_check_interrupts(context);
+	if (context->resultreg != JAGCPU_NOREG || context->flags_pending) {
+		uint16_t inst = jag_cpu_fetch(context, context->pc);
+		context->cycles += jag_stall_cycles(inst, context->is_gpu, context->resultreg, context->flags_pending);
+		context->resultreg = JAGCPU_NOREG;
+		context->flags_pending = 0;
+	}
+}
+
+void jag_cpu_execute(jag_cpu *context)
+{
+	uint32_t address = context->pc;
+	uint16_t inst = jag_cpu_fetch(context, address);
+	context->pc = address + 2;
+	jag_execute_inst(context, inst, address, 0);
+}
+
+void jag_cpu_interp(jag_cpu *context, uint32_t target_cycle)
+{
+	context->target_cycle = target_cycle;
+	while (context->cycles < target_cycle && (context->ctrl & JAG_CTRL_GO))
+	{
+		jag_cpu_begin_inst(context);
+		jag_cpu_execute(context);
+	}
+	if (context->cycles < target_cycle) {
+		context->cycles = target_cycle;
+	}
+}
+
+void jag_cpu_adjust_cycles(jag_cpu *context, uint32_t deduction)
+{
+	context->cycles -= deduction;
+	if (context->target_cycle >= deduction) {
+		context->target_cycle -= deduction;
+	}
+}
@@ -1,5 +1,7 @@
 #ifndef JAGCPU_H_
 #define JAGCPU_H_
+#include <stdint.h>
+#include "backend.h"
 
 enum {
 	JAG_ADD,
@@ -75,49 +77,155 @@ enum {
 };
 
 #define JAGCPU_NOREG -1
+//Interpret all code rather than translating it
+#define JAG_OPT_INTERPRET 1
 
+#define GPU_LOCAL_START 0xF03000
+#define GPU_LOCAL_BYTES 0x1000
+#define GPU_CTRL_START  0xF02100
+#define DSP_LOCAL_START 0xF1B000
+#define DSP_LOCAL_BYTES 0x2000
+#define DSP_CTRL_START  0xF1A100
+
+//control registers, in the order they appear in the address map
+enum {
+	JAG_FLAGS,
+	JAG_MTXC,
+	JAG_MTXA,
+	JAG_END,
+	JAG_PC,
+	JAG_CTRL,
+	JAG_HIDATA,
+	DSP_MOD = JAG_HIDATA,
+	JAG_DIVCTRL, //reads return the division remainder
+	DSP_MACHI,
+	JAG_NUM_CTRL
+};
+
+#define JAG_FLAG_IMASK   0x00008
+#define JAG_FLAG_REGPAGE 0x04000
+#define DSP_FLAG_DMAEN   0x08000
+
+#define JAG_CTRL_GO       0x1
+#define JAG_CTRL_CPUINT   0x2
+#define JAG_CTRL_FORCEINT 0x4
+
+#define JAG_CPU_INTS 6
+
+typedef struct jag_cpu jag_cpu;
+typedef uint16_t (*jag_read_16_fun)(uint32_t address, void *system);
+typedef void (*jag_write_16_fun)(uint32_t address, void *system, uint16_t value);
+typedef void (*jag_write_8_fun)(uint32_t address, void *system, uint8_t value);
+typedef void (*jag_cpu_int_fun)(void *system, uint8_t is_gpu);
+typedef void (*jag_run_fun)(jag_cpu *context, code_ptr native);
 
 typedef struct {
-	cpu_options gen;
-	int8_t      regs[32];
-	int8_t      result;
-	int8_t      resultreg;
-	int8_t      bankptr;
-	uint8_t     is_gpu;
+	cpu_options      gen;
+	//native address of each translated instruction in local RAM
+	code_ptr         *native;
+	//non-zero for each local RAM longword that has been translated
+	uint8_t          *code_flags;
+	code_ptr         code_start;
+	code_ptr         code_end;
+	//chunks allocated once the first one filled up, reused in order after a flush
+	code_ptr         *chunks;
+	uint32_t         num_chunks;
+	uint32_t         chunk_storage;
+	uint32_t         cur_chunk;
+	code_ptr         exit;
+	jag_run_fun      run;
+	jag_read_16_fun  read_16;
+	jag_write_16_fun write_16;
+	jag_write_8_fun  write_8;
+	//called when the CPU sets CPUINT to interrupt the 68K
+	jag_cpu_int_fun  cpu_int;
+	uint32_t         local_start;
+	uint32_t         local_bytes;
+	uint32_t         ctrl_start;
+	int8_t           bankptr;
+	uint8_t          is_gpu;
 } jag_cpu_options;
 
 typedef struct {
-	uint32_t read_high;
+	uint32_t hidata;
 } jag_gpu;
 
 typedef struct {
-	uint8_t  mac_high;
-	uint8_t  modulo;
+	uint32_t modulo;
 } jag_dsp;
 
-typedef struct {
-	uint32_t cycles;
-	uint32_t regs[64];
-	uint32_t *main;
-	uint32_t *alt;
-	uint32_t pc;
-	uint32_t result;
-	uint32_t flags;
-	uint32_t flags_pending;
-	uint32_t remainder;
+struct jag_cpu {
+	jag_cpu_options *opts;
+	void            *system;
+	uint32_t        *local;
+	//register bank selected by REGPAGE/IMASK and the other one, for MOVETA/MOVEFA
+	uint32_t        *main;
+	uint32_t        *alt;
+	uint32_t        cycles;
+	uint32_t        target_cycle;
+	uint32_t        pc;
+	//where execution continues once the delay slot of a jump has executed
+	uint32_t        branch_pc;
+	uint8_t         flag_z;
+	uint8_t         flag_c;
+	uint8_t         flag_n;
+	uint8_t         int_pending;
+	//register written by the previous instruction that is still in the pipeline
+	int8_t          resultreg;
+	uint8_t         flags_pending;
+	uint8_t         code_dirty;
+	uint8_t         is_gpu;
+	uint32_t        regs[64];
+	int64_t         accumulator;
+	uint32_t        flags;
+	uint32_t        matrix_control;
+	uint32_t        matrix_address;
+	uint32_t        data_org;
+	uint32_t        ctrl;
+	uint32_t        divctrl;
+	uint32_t        remainder;
 	union {
 		jag_gpu gpu;
 		jag_dsp dsp;
 	};
-	int8_t   writeback;
-	int8_t   resultreg;
-	uint8_t  is_gpu;
-} jag_cpu;
+};
 
 uint16_t jag_opcode(uint16_t inst, uint8_t is_gpu);
 char * jag_cc(uint16_t inst);
+uint16_t jag_reg1(uint16_t inst);
 uint16_t jag_reg2(uint16_t inst);
+uint32_t jag_quick(uint16_t inst);
 uint32_t jag_jr_dest(uint16_t inst, uint32_t address);
 int jag_cpu_disasm(uint16_t **stream, uint32_t address, char *dst, uint8_t is_gpu, uint8_t labels);
+uint8_t jag_is_always_false(uint16_t cond);
+uint8_t jag_inst_words(uint16_t inst);
+int8_t jag_result_reg(uint16_t inst, uint8_t is_gpu);
+uint8_t jag_sets_flags(uint16_t inst, uint8_t is_gpu);
+uint32_t jag_stall_cycles(uint16_t inst, uint8_t is_gpu, int8_t resultreg, uint8_t flags_pending);
+
+jag_cpu *init_jag_cpu(jag_cpu_options *opts, uint32_t *local, void *system);
+uint16_t jag_cpu_fetch(jag_cpu *context, uint32_t address);
+uint32_t jag_cpu_read_8(jag_cpu *context, uint32_t address);
+uint32_t jag_cpu_read_16(jag_cpu *context, uint32_t address);
+uint32_t jag_cpu_read_32(jag_cpu *context, uint32_t address);
+uint32_t jag_cpu_loadp(jag_cpu *context, uint32_t address);
+uint32_t jag_cpu_write_8(jag_cpu *context, uint32_t address, uint32_t value);
+uint32_t jag_cpu_write_16(jag_cpu *context, uint32_t address, uint32_t value);
+uint32_t jag_cpu_write_32(jag_cpu *context, uint32_t address, uint32_t value);
+uint32_t jag_cpu_storep(jag_cpu *context, uint32_t address, uint32_t value);
+uint32_t jag_cpu_read_ctrl(jag_cpu *context, uint32_t reg);
+uint32_t jag_cpu_write_ctrl(jag_cpu *context, uint32_t reg, uint32_t value);
+void jag_cpu_local_written(jag_cpu *context, uint32_t address);
+void jag_cpu_interrupt(jag_cpu *context, uint8_t num);
+void jag_cpu_exec_alu(jag_cpu *context, uint16_t inst);
+void jag_cpu_begin_inst(jag_cpu *context);
+void jag_cpu_execute(jag_cpu *context);
+void jag_cpu_interp(jag_cpu *context, uint32_t target_cycle);
+void jag_cpu_adjust_cycles(jag_cpu *context, uint32_t deduction);
+
+//implemented by the host specific translator
+void init_jag_cpu_opts(jag_cpu_options *opts, uint8_t is_gpu, uint32_t flags);
+void jag_cpu_run(jag_cpu *context, uint32_t target_cycle);
+void jag_cpu_flush_code(jag_cpu *context);
 
 #endif
@@ -1,190 +1,802 @@
+/*
+ Copyright 2017 Michael Pavone
+ This file is part of BlastEm.
+ BlastEm is free software distributed under the terms of the GNU General Public License version 3 or greater. See COPYING for full license text.
+*/
 #include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include "backend.h"
 #include "jagcpu.h"
 #include "gen_x86.h"
+#include "mem.h"
+#include "util.h"
 
-void jag_check_resultwrite(jag_cpu_options *opts, uint8_t src, uint8_t dst)
+//translation stops after this many instructions so runs of data aren't translated as code
+#define JAG_MAX_BLOCK 256
+//enough space for the largest instruction, a jump along with its delay slot
+#define JAG_MAX_NATIVE_SIZE 512
+
+//Translated code hands back the PC in the low 24 bits along with the pipeline state
+//the next instruction needs for its hazard check
+#define EXIT_RESULT_VALID  0x20000000
+#define EXIT_FLAGS_PENDING 0x40000000
+
+static uint32_t exit_state(uint32_t address, int8_t resultreg, uint8_t flags_pending)
+{
+	uint32_t state = address & 0xFFFFFF;
+	if (resultreg != JAGCPU_NOREG) {
+		state |= EXIT_RESULT_VALID | resultreg << 24;
+	}
+	if (flags_pending) {
+		state |= EXIT_FLAGS_PENDING;
+	}
+	return state;
+}
+
+static uint8_t jag_fits_local(jag_cpu_options *opts, uint32_t address, uint32_t bytes)
+{
+	uint32_t offset = address - opts->local_start;
+	return offset < opts->local_bytes && opts->local_bytes - offset >= bytes;
+}
+
+//same as check_alloc_code, but keeps track of the chunks so jag_cpu_flush_code can hand them out again
+static void jag_check_alloc_code(jag_cpu_options *opts, uint32_t inst_size)
 {
 	code_info *code = &opts->gen.code;
-	cmp_ir(code, JAGCPU_NOREG, opts->resultreg, SZ_B);
-	code_ptr no_result = code->cur + 1;
-	jcc(code, CC_Z, no_result + 1);
-	//save result to current bank
-	movzx_rr(code, opts->resultreg, opts->scratch1, SZ_B, SZ_D);
-	mov_rrindex(code, opts->result, opts->bankptr, opts->scratch1, 4, SZ_D);
-	
-	code_ptr writeback_penatly;
-	if (dst == src) {
-		//unclear if src and dst read can share a port if it's the same register
-		//assume that is the case for now
-		writeback_penalty = NULL;
-	} else {
-		cmp_ir(code, JAGCPU_NOREG, opts->writeback, SZ_B);
-		code_ptr no_writeback_penalty = code->cur + 1;
-		jcc(code, CC_Z, no_writeback_penalty + 1);
-		cmp_ir(code, src, opts->writeback, SZ_B);
-		code_ptr no_writeback_penalty2 = code->cur + 1;
-		jcc(code, CC_Z, no_writeback_penalty2 + 1);
-		cmp_ir(code, dst, opts->writeback, SZ_B);
-		writeback_penalty = code->cur + 1;
-		jcc(code, CC_NZ, writeback_penalty + 1);
-		*no_writeback_penalty = code->cur - (no_writeback_penalty + 1);
-		*no_writeback_penalty2 = code->cur - (no_writeback_penalty2 + 1);
-	}
-	cmp_ir(code, src, opts->resultreg, SZ_B);
-	code_ptr no_result_penalty;
-	if (dst == src) {
-		no_result_penalty = code->cur+1;
-		jcc(code, CC_NZ, no_result_penalty+1);
+	if (code->cur + inst_size <= code->last) {
+		return;
+	}
+	code_ptr next_code;
+	size_t size = CODE_ALLOC_SIZE;
+	if (opts->cur_chunk < opts->num_chunks) {
+		next_code = opts->chunks[opts->cur_chunk++];
 	} else {
-		code_ptr result_penalty = code->cur + 1;
-		jcc(code, CC_Z, result_penalty+1);
-		cmp_ir(code, dst, opts->resultreg, SZ_B);
-		no_result_penalty = code->cur+1;
-		jcc(code, CC_NZ, no_result_penalty+1);
-		*result_penalty = code->cur - (result_penalty + 1);
-	}
-	code_ptr penalty = code->cur;
-	cycles(code, 1);
-	*no_result_penalty = code->cur - (no_result_penalty + 1);
-	code_ptr end = code->cur + 1;
-	jmp(end + 1);
-	//No result to save, but there could still be a writeback, source read conflict
-	code_ptr end2 = NULL;
-	
-	cmp_ir(code, JAGCPU_NOREG, opts->writeback, SZ_B);
-	code_ptr no_resultreg_move = code->cur + 1;
-	jcc(code, CC_Z, no_resultreg_move+1);
-	
-	if (src != dst) {
-		//unclear if src and dst read can share a port if it's the same register
-		//assume that is the case for now
-		cmp_ir(code, src, opts->writeback, SZ_B);
-		end2 = code->cur + 1;
-		jcc(code, CC_Z, end2+1);
-		cmp_ir(code, src, opts->writeback, SZ_B);
-		jcc(code, CC_NZ, penalty)
-	}
-	*end = code->cur - (end + 1);
-	if (end2) {
-		*end2 = code->cur - (end2 + 1);
-	}
-	*no_result = code->cur - (no_result + 1);
-	mov_rr(code, opts->resultreg, opts->writeback, SZ_B);
-	*no_resultreg_move = code->cur - (no_resultreg_move + 1);
-}
-
-void jag_check_resultwrite_noread(jag_cpu_options *opts)
+		next_code = alloc_code(&size);
+		if (!next_code) {
+			fatal_error("Failed to allocate memory for generated code\n");
+		}
+		if (opts->num_chunks == opts->chunk_storage) {
+			opts->chunk_storage = opts->chunk_storage ? opts->chunk_storage * 2 : 4;
+			opts->chunks = realloc(opts->chunks, opts->chunk_storage * sizeof(code_ptr));
+		}
+		opts->chunks[opts->num_chunks++] = next_code;
+		opts->cur_chunk = opts->num_chunks;
+	}
+	if (next_code != code->last + RESERVE_WORDS) {
+		jmp_nocheck(code, next_code);
+		code->cur = next_code;
+	}
+	code->last = next_code + size/sizeof(code_word) - RESERVE_WORDS;
+}
+
+//an instruction can be translated if it, and the delay slot of a jump, is in local RAM
+static uint8_t jag_translatable(jag_cpu *context, uint32_t address)
+{
+	jag_cpu_options *opts = context->opts;
+	if (!jag_fits_local(opts, address, 2)) {
+		return 0;
+	}
+	uint16_t inst = jag_cpu_fetch(context, address);
+	uint16_t opcode = jag_opcode(inst, opts->is_gpu);
+	uint32_t bytes = jag_inst_words(inst) * 2;
+	if (opcode == JAG_JR || opcode == JAG_JUMP) {
+		if (!jag_fits_local(opts, address + 2, 2)) {
+			return 0;
+		}
+		bytes += jag_inst_words(jag_cpu_fetch(context, address + 2)) * 2;
+	}
+	return jag_fits_local(opts, address, bytes);
+}
+
+static void jag_save_cycles(jag_cpu_options *opts)
+{
+	mov_rrdisp(&opts->gen.code, opts->gen.cycles, opts->gen.context_reg, offsetof(jag_cpu, cycles), SZ_D);
+}
+
+static void jag_load_cycles(jag_cpu_options *opts)
+{
+	mov_rdispr(&opts->gen.code, opts->gen.context_reg, offsetof(jag_cpu, cycles), opts->gen.cycles, SZ_D);
+}
+
+//the C helpers can read the PC control register, so it needs to match the interpreter
+static void jag_save_pc(jag_cpu_options *opts, uint32_t next)
+{
+	mov_irdisp(&opts->gen.code, next, opts->gen.context_reg, offsetof(jag_cpu, pc), SZ_D);
+}
+
+static void jag_exit(jag_cpu_options *opts, uint32_t state)
+{
+	mov_ir(&opts->gen.code, state, opts->gen.scratch1, SZ_D);
+	jmp(&opts->gen.code, opts->exit);
+}
+
+static void jag_set_flags(jag_cpu_options *opts, uint8_t carry)
 {
 	code_info *code = &opts->gen.code;
-	cmp_ir(code, JAGCPU_NOREG, opts->resultreg, SZ_B);
-	code_ptr no_result = code->cur + 1;
-	jcc(code, CC_Z, no_result + 1);
-	//save result to current bank
-	movzx_rr(code, opts->resultreg, opts->scratch1, SZ_B, SZ_D);
-	mov_rrindex(code, opts->result, opts->bankptr, opts->scratch1, 4, SZ_D);
-	*no_result = code->cur - (no_result + 1);
-	mov_rr(code, opts->resultreg, opts->writeback, SZ_B);
+	setcc_rdisp(code, CC_Z, opts->gen.context_reg, offsetof(jag_cpu, flag_z));
+	setcc_rdisp(code, CC_S, opts->gen.context_reg, offsetof(jag_cpu, flag_n));
+	if (carry) {
+		setcc_rdisp(code, CC_C, opts->gen.context_reg, offsetof(jag_cpu, flag_c));
+	}
+}
+
+static void jag_carry_from_bit(jag_cpu_options *opts, uint8_t bit)
+{
+	bt_ir(&opts->gen.code, bit, opts->gen.scratch1, SZ_D);
+	setcc_rdisp(&opts->gen.code, CC_C, opts->gen.context_reg, offsetof(jag_cpu, flag_c));
+}
+
+static void jag_load_reg(jag_cpu_options *opts, uint8_t reg, uint8_t native)
+{
+	mov_rdispr(&opts->gen.code, opts->bankptr, reg * sizeof(uint32_t), native, SZ_D);
+}
+
+static void jag_store_reg(jag_cpu_options *opts, uint8_t native, uint8_t reg)
+{
+	mov_rrdisp(&opts->gen.code, native, opts->bankptr, reg * sizeof(uint32_t), SZ_D);
 }
 
-void jag_check_resultwrite_singleread(jag_cpu options *opts, uint8_t reg)
+//leaves the effective address of a load or store in scratch1
+static void jag_calc_address(jag_cpu_options *opts, uint16_t opcode, uint16_t inst)
 {
 	code_info *code = &opts->gen.code;
-	cmp_ir(code, JAGCPU_NOREG, opts->resultreg, SZ_B);
-	code_ptr no_result = code->cur + 1;
-	jcc(code, CC_Z, no_result + 1);
-	//save result to current bank
-	movzx_rr(code, opts->resultreg, opts->scratch1, SZ_B, SZ_D);
-	mov_rrindex(code, opts->result, opts->bankptr, opts->scratch1, 4, SZ_D);
-	
-	//check for a scoreboard delay
-	cmp_ir(code, reg, opts->resultreg, SZ_B);
-	code_ptr no_delay = code-.cur + 1;
-	jcc(code, CC_NZ, no_delay + 1);
-	ccylces(code, 1);
-	*no_delay = code->cur - (no_delay = 1);
-	*no_result = code->cur - (no_result + 1);
-	mov_rr(code, opts->resultreg, opts->writeback, SZ_B);
-}
-
-void translate_jag_quickimmed(jag_cpu_options *opts, uint32_t address, uint16_t opcode, uint32_t value, uint16_t dest)
-{
-	jag_check_resultwrite_singleread(opts, dest);
 	switch (opcode)
 	{
-	case ADDQ:
+	case JAG_LOAD_R14_REL:
+	case JAG_LOAD_R15_REL:
+	case JAG_STORE_R14_REL:
+	case JAG_STORE_R15_REL:
+		jag_load_reg(opts, opcode == JAG_LOAD_R14_REL || opcode == JAG_STORE_R14_REL ? 14 : 15, opts->gen.scratch1);
+		add_ir(code, jag_quick(inst) * 4, opts->gen.scratch1, SZ_D);
 		break;
-	case ADDQT:
+	case JAG_LOAD_R14_INDEXED:
+	case JAG_LOAD_R15_INDEXED:
+	case JAG_STORE_R14_INDEXED:
+	case JAG_STORE_R15_INDEXED:
+		jag_load_reg(opts, opcode == JAG_LOAD_R14_INDEXED || opcode == JAG_STORE_R14_INDEXED ? 14 : 15, opts->gen.scratch1);
+		add_rdispr(code, opts->bankptr, jag_reg1(inst) * sizeof(uint32_t), opts->gen.scratch1, SZ_D);
 		break;
+	default:
+		jag_load_reg(opts, jag_reg1(inst), opts->gen.scratch1);
 	}
 }
 
+//32-bit loads from local RAM are done inline, everything else goes through the C helpers
+static void translate_jag_load(jag_cpu_options *opts, uint16_t opcode, uint16_t inst, uint32_t next)
+{
+	code_info *code = &opts->gen.code;
+	jag_calc_address(opts, opcode, inst);
+	code_ptr done = NULL;
+	code_ptr helper;
+	switch (opcode)
+	{
+	case JAG_LOADB:
+		helper = (code_ptr)jag_cpu_read_8;
+		break;
+	case JAG_LOADW:
+		helper = (code_ptr)jag_cpu_read_16;
+		break;
+	case GPU_LOADP:
+		helper = (code_ptr)jag_cpu_loadp;
+		break;
+	default: {
+		helper = (code_ptr)jag_cpu_read_32;
+		mov_rr(code, opts->gen.scratch1, opts->gen.scratch2, SZ_D);
+		and_ir(code, 0xFFFFFC, opts->gen.scratch2, SZ_D);
+		sub_ir(code, opts->local_start, opts->gen.scratch2, SZ_D);
+		cmp_ir(code, opts->local_bytes, opts->gen.scratch2, SZ_D);
+		code_ptr not_local = code->cur + 1;
+		jcc(code, CC_NC, not_local + 1);
+		mov_rdispr(code, opts->gen.context_reg, offsetof(jag_cpu, local), RCX, SZ_PTR);
+		mov_rindexr(code, RCX, opts->gen.scratch2, 1, opts->gen.scratch1, SZ_D);
+		done = code->cur + 1;
+		jmp(code, done + 1);
+		*not_local = code->cur - (not_local + 1);
+	}
+	}
+	jag_save_cycles(opts);
+	jag_save_pc(opts, next);
+	call_args(code, helper, 2, opts->gen.context_reg, opts->gen.scratch1);
+	jag_load_cycles(opts);
+	if (done) {
+		*done = code->cur - (done + 1);
+	}
+	jag_store_reg(opts, RAX, jag_reg2(inst));
+}
 
-uint16_t *translate_jag_inst(uint16_t *stream, jag_cpu_options *opts, uint32_t address)
+//stores can hit control registers or translated code, both need a trip back to the dispatcher
+static void translate_jag_store(jag_cpu_options *opts, uint16_t opcode, uint16_t inst, uint32_t next, uint8_t delay_slot)
 {
-	uint16_t inst = *stream
-	++stream;
-	uint16_t opcode = jag_opcode(inst, opts->is_gpu);
-	check_cycles_int(&opts->gen, address);
 	code_info *code = &opts->gen.code;
+	jag_calc_address(opts, opcode, inst);
+	jag_load_reg(opts, jag_reg2(inst), opts->gen.scratch2);
+	code_ptr helper;
 	switch (opcode)
 	{
-	case JAG_MOVEI: {
-		uint32_t value = *stream;
-		++stream;
-		value |= *stream << 16;
-		++stream;
-		
-		jag_check_resultwrite_noread(opts);
-		mov_ir(code, value, opts->result, SZ_D);
-		mov_ir(code, jag_reg2(inst), opts->resultreg, SZ_B);
-		break;
-		}
-	case JAG_MOVE: {
-		uint8_t src = jag_reg1(inst), dst = jag_reg2(inst);
-		jag_check_resultwrite_singleread(opts, src);
-		//move has a shorter pipeline than normal instructions
-		if (src != dst) {
-			mov_rdispr(code, opts->bankptr, src * 4, opts->gen.scratch1, SZ_D);
-			mov_rrdisp(code, opts->gen.scratch1, opts->bankptr, dst * 4, SZ_D);
-		}
-		mov_ir(code, dst, opts->writeback, SZ_B);
-		mov_ir(code, JAGCPU_NOREG, opts->resultreg, SZ_B);
-		break;
-		}
-	case JAG_MOVEQ: {
-		uint8_t dst = jag_reg2(inst);
-		jag_check_resultwrite_noread(opts);
-		//moveq has a shorter pipeline than normal instructions
-		mov_irdisp(code, jag_quick(inst), opts->bankptr, dst * 4, SZ_D);
-		mov_ir(code, dst, opts->writeback, SZ_B);
-		mov_ir(code, JAGCPU_NOREG, opts->resultreg, SZ_B);
-		}
-		break;
-	case JAG_JR: {
-		jag_check_resultwrite_noread(opts);
-		//TODO: Pipeline stalls on flag readiness
-		uint16_t cond = jag_reg2(inst);
-		if (jag_is_always_false(cond)) {
+	case JAG_STOREB:
+		helper = (code_ptr)jag_cpu_write_8;
+		break;
+	case JAG_STOREW:
+		helper = (code_ptr)jag_cpu_write_16;
+		break;
+	case GPU_STOREP:
+		helper = (code_ptr)jag_cpu_storep;
+		break;
+	default:
+		helper = (code_ptr)jag_cpu_write_32;
+	}
+	jag_save_cycles(opts);
+	jag_save_pc(opts, next);
+	call_args(code, helper, 3, opts->gen.context_reg, opts->gen.scratch1, opts->gen.scratch2);
+	jag_load_cycles(opts);
+	cmp_ir(code, 0, RAX, SZ_D);
+	code_ptr no_exit = code->cur + 1;
+	jcc(code, CC_Z, no_exit + 1);
+	//a write to the PC register changes where execution continues, except in a delay slot
+	mov_rdispr(code, opts->gen.context_reg, delay_slot ? offsetof(jag_cpu, branch_pc) : offsetof(jag_cpu, pc), opts->gen.scratch1, SZ_D);
+	jmp(code, opts->exit);
+	*no_exit = code->cur - (no_exit + 1);
+}
+
+static void translate_jag_alu_helper(jag_cpu_options *opts, uint16_t inst, uint32_t next)
+{
+	code_info *code = &opts->gen.code;
+	jag_save_cycles(opts);
+	jag_save_pc(opts, next);
+	mov_ir(code, inst, opts->gen.scratch1, SZ_D);
+	call_args(code, (code_ptr)jag_cpu_exec_alu, 2, opts->gen.context_reg, opts->gen.scratch1);
+	jag_load_cycles(opts);
+}
+
+static void translate_jag_inst(jag_cpu *context, uint16_t inst, uint32_t address, uint8_t delay_slot)
+{
+	jag_cpu_options *opts = context->opts;
+	code_info *code = &opts->gen.code;
+	uint8_t is_gpu = opts->is_gpu;
+	uint16_t opcode = jag_opcode(inst, is_gpu);
+	uint8_t src = jag_reg1(inst), dst = jag_reg2(inst);
+	uint32_t quick = jag_quick(inst);
+	uint8_t scratch1 = opts->gen.scratch1, scratch2 = opts->gen.scratch2;
+	uint32_t next = address + jag_inst_words(inst) * 2;
+	jag_check_alloc_code(opts, JAG_MAX_NATIVE_SIZE);
+	cycles(&opts->gen, 1);
+	switch (opcode)
+	{
+	case JAG_ADD:
+	case JAG_SUB:
+	case JAG_AND:
+	case JAG_OR:
+	case JAG_XOR:
+	case JAG_CMP:
+		jag_load_reg(opts, dst, scratch1);
+		switch (opcode)
+		{
+		case JAG_ADD: add_rdispr(code, opts->bankptr, src * sizeof(uint32_t), scratch1, SZ_D); break;
+		case JAG_SUB: sub_rdispr(code, opts->bankptr, src * sizeof(uint32_t), scratch1, SZ_D); break;
+		case JAG_AND: and_rdispr(code, opts->bankptr, src * sizeof(uint32_t), scratch1, SZ_D); break;
+		case JAG_OR: or_rdispr(code, opts->bankptr, src * sizeof(uint32_t), scratch1, SZ_D); break;
+		case JAG_XOR: xor_rdispr(code, opts->bankptr, src * sizeof(uint32_t), scratch1, SZ_D); break;
+		case JAG_CMP: cmp_rdispr(code, opts->bankptr, src * sizeof(uint32_t), scratch1, SZ_D); break;
+		}
+		if (opcode != JAG_CMP) {
+			jag_store_reg(opts, scratch1, dst);
+		}
+		jag_set_flags(opts, opcode == JAG_ADD || opcode == JAG_SUB || opcode == JAG_CMP);
+		break;
+	case JAG_ADDC:
+	case JAG_SUBC:
+		movzx_rdispr(code, opts->gen.context_reg, offsetof(jag_cpu, flag_c), scratch2, SZ_B, SZ_D);
+		jag_load_reg(opts, dst, scratch1);
+		bt_ir(code, 0, scratch2, SZ_D);
+		if (opcode == JAG_ADDC) {
+			adc_rdispr(code, opts->bankptr, src * sizeof(uint32_t), scratch1, SZ_D);
+		} else {
+			sbb_rdispr(code, opts->bankptr, src * sizeof(uint32_t), scratch1, SZ_D);
+		}
+		jag_store_reg(opts, scratch1, dst);
+		jag_set_flags(opts, 1);
+		break;
+	case JAG_ADDQ:
+	case JAG_SUBQ:
+		jag_load_reg(opts, dst, scratch1);
+		if (opcode == JAG_ADDQ) {
+			add_ir(code, quick, scratch1, SZ_D);
 		} else {
-			int32_t offset = jag_quick(inst);
-			if (offset & 0x10) {
-				offset = -16 + (offset & 0xF);
+			sub_ir(code, quick, scratch1, SZ_D);
+		}
+		jag_store_reg(opts, scratch1, dst);
+		jag_set_flags(opts, 1);
+		break;
+	case JAG_ADDQT:
+		add_irdisp(code, quick, opts->bankptr, dst * sizeof(uint32_t), SZ_D);
+		break;
+	case JAG_SUBQT:
+		sub_irdisp(code, quick, opts->bankptr, dst * sizeof(uint32_t), SZ_D);
+		break;
+	case JAG_NEG:
+		jag_load_reg(opts, dst, scratch1);
+		neg_r(code, scratch1, SZ_D);
+		jag_store_reg(opts, scratch1, dst);
+		jag_set_flags(opts, 1);
+		break;
+	case JAG_NOT:
+		jag_load_reg(opts, dst, scratch1);
+		not_r(code, scratch1, SZ_D);
+		test_rr(code, scratch1, scratch1, SZ_D);
+		jag_store_reg(opts, scratch1, dst);
+		jag_set_flags(opts, 0);
+		break;
+	case JAG_BTST:
+		test_irdisp(code, 1 << src, opts->bankptr, dst * sizeof(uint32_t), SZ_D);
+		setcc_rdisp(code, CC_Z, opts->gen.context_reg, offsetof(jag_cpu, flag_z));
+		break;
+	case JAG_BSET:
+		or_irdisp(code, 1 << src, opts->bankptr, dst * sizeof(uint32_t), SZ_D);
+		jag_set_flags(opts, 0);
+		break;
+	case JAG_BCLR:
+		and_irdisp(code, ~(1 << src), opts->bankptr, dst * sizeof(uint32_t), SZ_D);
+		jag_set_flags(opts, 0);
+		break;
+	case JAG_MULT:
+	case JAG_IMULT:
+#ifdef X86_64
+	case JAG_IMULTN:
+	case JAG_IMACN:
+#endif
+		if (opcode == JAG_MULT) {
+			movzx_rdispr(code, opts->bankptr, dst * sizeof(uint32_t), scratch1, SZ_W, SZ_D);
+			movzx_rdispr(code, opts->bankptr, src * sizeof(uint32_t), scratch2, SZ_W, SZ_D);
+		} else {
+			movsx_rdispr(code, opts->bankptr, dst * sizeof(uint32_t), scratch1, SZ_W, SZ_D);
+			movsx_rdispr(code, opts->bankptr, src * sizeof(uint32_t), scratch2, SZ_W, SZ_D);
+		}
+		imul_rr(code, scratch2, scratch1, SZ_D);
+#ifdef X86_64
+		if (opcode == JAG_IMACN) {
+			movsx_rr(code, scratch1, scratch1, SZ_D, SZ_Q);
+			add_rrdisp(code, scratch1, opts->gen.context_reg, offsetof(jag_cpu, accumulator), SZ_Q);
+			break;
+		}
+#endif
+		test_rr(code, scratch1, scratch1, SZ_D);
+		jag_set_flags(opts, 0);
+#ifdef X86_64
+		if (opcode == JAG_IMULTN) {
+			movsx_rr(code, scratch1, scratch1, SZ_D, SZ_Q);
+			mov_rrdisp(code, scratch1, opts->gen.context_reg, offsetof(jag_cpu, accumulator), SZ_Q);
+			break;
+		}
+#endif
+		jag_store_reg(opts, scratch1, dst);
+		break;
+	case JAG_RESMAC:
+		mov_rdispr(code, opts->gen.context_reg, offsetof(jag_cpu, accumulator), scratch1, SZ_D);
+		jag_store_reg(opts, scratch1, dst);
+		break;
+	case JAG_SHLQ:
+	case JAG_SHRQ:
+	case JAG_SHARQ:
+	case JAG_RORQ:
+	case JAG_ROR:
+		jag_load_reg(opts, dst, scratch1);
+		switch (opcode)
+		{
+		case JAG_SHLQ:
+			//the assembler stores 32 - shift in the immediate field
+			jag_carry_from_bit(opts, 31);
+			if (quick != 32) {
+				shl_ir(code, 32 - quick, scratch1, SZ_D);
+			}
+			break;
+		case JAG_SHRQ:
+			jag_carry_from_bit(opts, 0);
+			if (quick == 32) {
+				xor_rr(code, scratch1, scratch1, SZ_D);
+			} else {
+				shr_ir(code, quick, scratch1, SZ_D);
 			}
+			break;
+		case JAG_SHARQ:
+			jag_carry_from_bit(opts, 0);
+			sar_ir(code, quick == 32 ? 31 : quick, scratch1, SZ_D);
+			break;
+		case JAG_RORQ:
+			jag_carry_from_bit(opts, 31);
+			if (quick != 32) {
+				ror_ir(code, quick, scratch1, SZ_D);
+			}
+			break;
+		case JAG_ROR:
+			jag_load_reg(opts, src, RCX);
+			jag_carry_from_bit(opts, 31);
+			ror_clr(code, scratch1, SZ_D);
+			break;
+		}
+		test_rr(code, scratch1, scratch1, SZ_D);
+		jag_store_reg(opts, scratch1, dst);
+		jag_set_flags(opts, 0);
+		break;
+	case JAG_CMPQ: {
+		int32_t value = src;
+		if (value & 0x10) {
+			value |= 0xFFFFFFE0;
+		}
+		cmp_irdisp(code, value, opts->bankptr, dst * sizeof(uint32_t), SZ_D);
+		jag_set_flags(opts, 1);
+		break;
+	}
+	case JAG_MOVE:
+		jag_load_reg(opts, src, scratch1);
+		jag_store_reg(opts, scratch1, dst);
+		break;
+	case JAG_MOVEQ:
+		mov_irdisp(code, src, opts->bankptr, dst * sizeof(uint32_t), SZ_D);
+		break;
+	case JAG_MOVEI: {
+		uint32_t value = jag_cpu_fetch(context, address + 2) | jag_cpu_fetch(context, address + 4) << 16;
+		mov_irdisp(code, value, opts->bankptr, dst * sizeof(uint32_t), SZ_D);
+		break;
+	}
+	case JAG_MOVETA:
+		jag_load_reg(opts, src, scratch1);
+		mov_rdispr(code, opts->gen.context_reg, offsetof(jag_cpu, alt), scratch2, SZ_PTR);
+		mov_rrdisp(code, scratch1, scratch2, dst * sizeof(uint32_t), SZ_D);
+		break;
+	case JAG_MOVEFA:
+		mov_rdispr(code, opts->gen.context_reg, offsetof(jag_cpu, alt), scratch2, SZ_PTR);
+		mov_rdispr(code, scratch2, src * sizeof(uint32_t), scratch1, SZ_D);
+		jag_store_reg(opts, scratch1, dst);
+		break;
+	case JAG_MOVE_PC:
+		mov_irdisp(code, address, opts->bankptr, dst * sizeof(uint32_t), SZ_D);
+		break;
+	case JAG_LOADB:
+	case JAG_LOADW:
+	case JAG_LOAD:
+	case JAG_LOAD_R14_REL:
+	case JAG_LOAD_R15_REL:
+	case JAG_LOAD_R14_INDEXED:
+	case JAG_LOAD_R15_INDEXED:
+		translate_jag_load(opts, opcode, inst, next);
+		break;
+	case JAG_STOREB:
+	case JAG_STOREW:
+	case JAG_STORE:
+	case JAG_STORE_R14_REL:
+	case JAG_STORE_R15_REL:
+	case JAG_STORE_R14_INDEXED:
+	case JAG_STORE_R15_INDEXED:
+		translate_jag_store(opts, opcode, inst, next, delay_slot);
+		break;
+	case GPU_LOADP:
+		if (is_gpu) {
+			translate_jag_load(opts, opcode, inst, next);
+		} else {
+			translate_jag_alu_helper(opts, inst, next);
 		}
-		
+		break;
+	case GPU_STOREP:
+		if (is_gpu) {
+			translate_jag_store(opts, opcode, inst, next, delay_slot);
+		} else {
+			translate_jag_alu_helper(opts, inst, next);
 		}
 		break;
+	case JAG_JUMP:
+	case JAG_JR:
+		//jumps in a delay slot are ignored, others are handled by translate_jag_jump
+	case JAG_NOP:
+		break;
 	default:
-		if (is_quick_1_32_opcode(opcode, opts->is_gpu)) {
-			translate_jag_quickimmed(opts, address, jag_quick(inst), jag_reg2(inst));
-		} else if (is_quick_0_31_opcode(opcode)) {
-			translate_jag_quickimmed(opts, address, jag_reg1(inst), jag_reg2(inst));
-		} else if (is_single_source(opcode, opts->is_gpu)) {
-			translate_jag_single_source(opts, address, jag_reg2(isnt));
+		//divides, saturation and other less common operations use the interpreter implementation
+		translate_jag_alu_helper(opts, inst, next);
+	}
+}
+
+//Continues execution at a translated instruction after a jump, the cycle check and pipeline
+//stall normally emitted before an instruction are done here as they depend on the path taken
+static void jag_link(jag_cpu *context, uint32_t target, int8_t resultreg, uint8_t flags_pending)
+{
+	jag_cpu_options *opts = context->opts;
+	uint32_t state = exit_state(target, resultreg, flags_pending);
+	if (jag_fits_local(opts, target, 2)) {
+		code_ptr native = opts->native[(target - opts->local_start) >> 1];
+		if (native) {
+			check_cycles_int(&opts->gen, state);
+			uint32_t stall = jag_stall_cycles(jag_cpu_fetch(context, target), opts->is_gpu, resultreg, flags_pending);
+			if (stall) {
+				cycles(&opts->gen, stall);
+			}
+			jmp(&opts->gen.code, native);
+			return;
+		}
+	}
+	jag_exit(opts, state);
+}
+
+//returns non-zero if the block continues with the instruction after the delay slot
+static uint8_t translate_jag_jump(jag_cpu *context, uint16_t inst, uint32_t address, int8_t *resultreg, uint8_t *flags_pending)
+{
+	jag_cpu_options *opts = context->opts;
+	code_info *code = &opts->gen.code;
+	uint16_t opcode = jag_opcode(inst, opts->is_gpu);
+	uint16_t cond = jag_reg2(inst);
+	uint32_t delay = address + 2;
+	uint16_t delay_inst = jag_cpu_fetch(context, delay);
+	uint32_t fallthrough = delay + jag_inst_words(delay_inst) * 2;
+	uint32_t target = jag_jr_dest(inst, address);
+	uint8_t always = !(cond & 0xF);
+	uint8_t never = jag_is_always_false(cond);
+
+	jag_check_alloc_code(opts, JAG_MAX_NATIVE_SIZE);
+	cycles(&opts->gen, 1);
+	if (never) {
+		mov_irdisp(code, fallthrough, opts->gen.context_reg, offsetof(jag_cpu, branch_pc), SZ_D);
+	} else {
+		if (opcode == JAG_JUMP) {
+			jag_load_reg(opts, jag_reg1(inst), opts->gen.scratch1);
+			and_ir(code, 0xFFFFFE, opts->gen.scratch1, SZ_D);
+		}
+		code_ptr not_taken[4];
+		uint32_t num_not_taken = 0;
+		uint32_t flag_off = cond & 0x10 ? offsetof(jag_cpu, flag_n) : offsetof(jag_cpu, flag_c);
+		if (cond & 1) {
+			cmp_irdisp(code, 0, opts->gen.context_reg, offsetof(jag_cpu, flag_z), SZ_B);
+			not_taken[num_not_taken++] = code->cur + 1;
+			jcc(code, CC_NZ, code->cur + 2);
+		}
+		if (cond & 2) {
+			cmp_irdisp(code, 0, opts->gen.context_reg, offsetof(jag_cpu, flag_z), SZ_B);
+			not_taken[num_not_taken++] = code->cur + 1;
+			jcc(code, CC_Z, code->cur + 2);
+		}
+		if (cond & 4) {
+			cmp_irdisp(code, 0, opts->gen.context_reg, flag_off, SZ_B);
+			not_taken[num_not_taken++] = code->cur + 1;
+			jcc(code, CC_NZ, code->cur + 2);
+		}
+		if (cond & 8) {
+			cmp_irdisp(code, 0, opts->gen.context_reg, flag_off, SZ_B);
+			not_taken[num_not_taken++] = code->cur + 1;
+			jcc(code, CC_Z, code->cur + 2);
+		}
+		//pipeline refill
+		cycles(&opts->gen, 2);
+		if (opcode == JAG_JUMP) {
+			mov_rrdisp(code, opts->gen.scratch1, opts->gen.context_reg, offsetof(jag_cpu, branch_pc), SZ_D);
 		} else {
-			translate_jag_normal(opts, address, jag_reg1(inst), jag_reg2(inst));
+			mov_irdisp(code, target, opts->gen.context_reg, offsetof(jag_cpu, branch_pc), SZ_D);
 		}
+		if (num_not_taken) {
+			code_ptr taken_done = code->cur + 1;
+			jmp(code, code->cur + 2);
+			for (uint32_t i = 0; i < num_not_taken; i++)
+			{
+				*not_taken[i] = code->cur - (not_taken[i] + 1);
+			}
+			mov_irdisp(code, fallthrough, opts->gen.context_reg, offsetof(jag_cpu, branch_pc), SZ_D);
+			*taken_done = code->cur - (taken_done + 1);
+		}
+	}
+	//the instruction after a jump always executes before the jump takes effect
+	translate_jag_inst(context, delay_inst, delay, 1);
+	*resultreg = jag_result_reg(delay_inst, opts->is_gpu);
+	*flags_pending = jag_sets_flags(delay_inst, opts->is_gpu);
+	if (never) {
+		return 1;
 	}
-	return stream;
-}
\ No newline at end of file
+	jag_check_alloc_code(opts, JAG_MAX_NATIVE_SIZE);
+	code_ptr fall = NULL;
+	if (!always) {
+		cmp_irdisp(code, fallthrough, opts->gen.context_reg, offsetof(jag_cpu, branch_pc), SZ_D);
+		fall = code->cur + 1;
+		jcc(code, CC_Z, code->cur + 2);
+	}
+	if (opcode == JAG_JR) {
+		jag_link(context, target, *resultreg, *flags_pending);
+	} else {
+		mov_rdispr(code, opts->gen.context_reg, offsetof(jag_cpu, branch_pc), opts->gen.scratch1, SZ_D);
+		uint32_t state = exit_state(0, *resultreg, *flags_pending);
+		if (state) {
+			or_ir(code, state, opts->gen.scratch1, SZ_D);
+		}
+		jmp(code, opts->exit);
+	}
+	if (fall) {
+		*fall = code->cur - (fall + 1);
+		return 1;
+	}
+	return 0;
+}
+
+static void jag_mark_code(jag_cpu_options *opts, uint32_t address, uint32_t bytes)
+{
+	for (uint32_t offset = address - opts->local_start; bytes; offset += 2, bytes -= 2)
+	{
+		opts->code_flags[offset >> 2] = 1;
+	}
+}
+
+static code_ptr translate_jag_block(jag_cpu *context, uint32_t address)
+{
+	jag_cpu_options *opts = context->opts;
+	code_info *code = &opts->gen.code;
+	if (!jag_translatable(context, address)) {
+		return NULL;
+	}
+	code_ptr start = NULL;
+	//pipeline state left by the previous instruction, the dispatcher handles it for the first one
+	int8_t resultreg = JAGCPU_NOREG;
+	uint8_t flags_pending = 0;
+	code->stack_off = 0;
+	for (uint32_t count = 0;; count++)
+	{
+		jag_check_alloc_code(opts, JAG_MAX_NATIVE_SIZE);
+		if (count == JAG_MAX_BLOCK || !jag_translatable(context, address)) {
+			jag_exit(opts, exit_state(address, resultreg, flags_pending));
+			break;
+		}
+		code_ptr *native = opts->native + ((address - opts->local_start) >> 1);
+		uint16_t inst = jag_cpu_fetch(context, address);
+		if (count) {
+			if (*native) {
+				jag_link(context, address, resultreg, flags_pending);
+				break;
+			}
+			check_cycles_int(&opts->gen, exit_state(address, resultreg, flags_pending));
+			uint32_t stall = jag_stall_cycles(inst, opts->is_gpu, resultreg, flags_pending);
+			if (stall) {
+				cycles(&opts->gen, stall);
+			}
+		}
+		*native = code->cur;
+		if (!start) {
+			start = code->cur;
+		}
+		uint16_t opcode = jag_opcode(inst, opts->is_gpu);
+		uint32_t bytes = jag_inst_words(inst) * 2;
+		if (opcode == JAG_JR || opcode == JAG_JUMP) {
+			uint16_t delay_inst = jag_cpu_fetch(context, address + 2);
+			bytes += jag_inst_words(delay_inst) * 2;
+			jag_mark_code(opts, address, bytes);
+			if (!translate_jag_jump(context, inst, address, &resultreg, &flags_pending)) {
+				break;
+			}
+		} else {
+			jag_mark_code(opts, address, bytes);
+			translate_jag_inst(context, inst, address, 0);
+			resultreg = jag_result_reg(inst, opts->is_gpu);
+			flags_pending = jag_sets_flags(inst, opts->is_gpu);
+		}
+		address += bytes;
+	}
+	return start;
+}
+
+void jag_cpu_flush_code(jag_cpu *context)
+{
+	jag_cpu_options *opts = context->opts;
+	memset(opts->native, 0, opts->local_bytes / 2 * sizeof(code_ptr));
+	memset(opts->code_flags, 0, opts->local_bytes / 4);
+	opts->gen.code.cur = opts->code_start;
+	opts->gen.code.last = opts->code_end;
+	opts->cur_chunk = 0;
+	context->code_dirty = 0;
+}
+
+void init_jag_cpu_opts(jag_cpu_options *opts, uint8_t is_gpu, uint32_t flags)
+{
+	memset(opts, 0, sizeof(*opts));
+	opts->is_gpu = is_gpu;
+	opts->gen.flags = flags;
+	opts->local_start = is_gpu ? GPU_LOCAL_START : DSP_LOCAL_START;
+	opts->local_bytes = is_gpu ? GPU_LOCAL_BYTES : DSP_LOCAL_BYTES;
+	opts->ctrl_start = is_gpu ? GPU_CTRL_START : DSP_CTRL_START;
+	opts->gen.address_size = SZ_D;
+	opts->gen.address_mask = 0xFFFFFF;
+	opts->gen.max_address = 0x1000000;
+	//assume external accesses cost about as much as a DRAM phrase access by the OP
+	opts->gen.bus_cycles = 2;
+	opts->gen.clock_divider = 1;
+#ifdef X86_64
+	opts->gen.context_reg = R15;
+	opts->bankptr = RBX;
+	opts->gen.cycles = R13;
+	opts->gen.limit = R14;
+#else
+	opts->gen.context_reg = RSI;
+	opts->bankptr = RBX;
+	opts->gen.cycles = RDI;
+	opts->gen.limit = RBP;
+#endif
+	opts->gen.scratch1 = RAX;
+	opts->gen.scratch2 = RDX;
+	if (flags & JAG_OPT_INTERPRET) {
+		return;
+	}
+	opts->native = calloc(opts->local_bytes / 2, sizeof(code_ptr));
+	opts->code_flags = calloc(opts->local_bytes / 4, 1);
+
+	init_code_info(&opts->gen.code);
+	code_info *code = &opts->gen.code;
+	//translated code runs with the stack aligned after the callee save registers
+#ifdef X86_64
+	uint32_t align = 8;
+#else
+	uint32_t align = 12;
+#endif
+	opts->run = (jag_run_fun)code->cur;
+	save_callee_save_regs(code);
+	sub_ir(code, align, RSP, SZ_PTR);
+#ifdef X86_64
+	mov_rr(code, RDI, opts->gen.context_reg, SZ_PTR);
+	mov_rr(code, RSI, opts->gen.scratch1, SZ_PTR);
+#else
+	mov_rdispr(code, RSP, align + 5 * sizeof(int32_t), opts->gen.context_reg, SZ_PTR);
+	mov_rdispr(code, RSP, align + 6 * sizeof(int32_t), opts->gen.scratch1, SZ_PTR);
+#endif
+	mov_rdispr(code, opts->gen.context_reg, offsetof(jag_cpu, main), opts->bankptr, SZ_PTR);
+	mov_rdispr(code, opts->gen.context_reg, offsetof(jag_cpu, cycles), opts->gen.cycles, SZ_D);
+	mov_rdispr(code, opts->gen.context_reg, offsetof(jag_cpu, target_cycle), opts->gen.limit, SZ_D);
+	jmp_r(code, opts->gen.scratch1);
+
+	//reached by call from check_cycles_int with the exit state in scratch1
+	opts->gen.handle_cycle_limit_int = code->cur;
+	add_ir(code, 16, RSP, SZ_PTR);
+	opts->exit = code->cur;
+	mov_rrdisp(code, opts->gen.cycles, opts->gen.context_reg, offsetof(jag_cpu, cycles), SZ_D);
+	mov_rrdisp(code, opts->gen.scratch1, opts->gen.context_reg, offsetof(jag_cpu, pc), SZ_D);
+	add_ir(code, align, RSP, SZ_PTR);
+	restore_callee_save_regs(code);
+	retn(code);
+	code->stack_off = 0;
+	opts->code_start = code->cur;
+	opts->code_end = code->last;
+}
+
+static code_ptr jag_get_native(jag_cpu *context, uint32_t address)
+{
+	jag_cpu_options *opts = context->opts;
+	if (!jag_fits_local(opts, address, 2)) {
+		return NULL;
+	}
+	code_ptr native = opts->native[(address - opts->local_start) >> 1];
+	if (!native) {
+		native = translate_jag_block(context, address);
+	}
+	return native;
+}
+
+void jag_cpu_run(jag_cpu *context, uint32_t target_cycle)
+{
+	jag_cpu_options *opts = context->opts;
+	if (opts->gen.flags & JAG_OPT_INTERPRET) {
+		jag_cpu_interp(context, target_cycle);
+		return;
+	}
+	context->target_cycle = target_cycle;
+	while (context->cycles < target_cycle && (context->ctrl & JAG_CTRL_GO))
+	{
+		jag_cpu_begin_inst(context);
+		if (context->code_dirty) {
+			jag_cpu_flush_code(context);
+		}
+		code_ptr native = jag_get_native(context, context->pc);
+		if (!native) {
+			//code outside of local RAM is interpreted
+			jag_cpu_execute(context);
+			continue;
+		}
+		opts->run(context, native);
+		uint32_t state = context->pc;
+		context->pc = state & 0xFFFFFF;
+		context->resultreg = state & EXIT_RESULT_VALID ? state >> 24 & 0x1F : JAGCPU_NOREG;
+		context->flags_pending = (state & EXIT_FLAGS_PENDING) != 0;
+	}
+	if (context->cycles < target_cycle) {
+		context->cycles = target_cycle;
+	}
+}
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 #include "m68k_core.h"
 #include "68kinst.h"
 #include "jaguar.h"
@@ -68,7 +69,7 @@ void jag_update_m68k_int(jaguar_context *system)
 	//TODO: Support other interrupt sources
 	if (!system->cpu_int_control || (m68k->status & 0x7)) {
 		m68k->int_cycle = CYCLE_NEVER;
-	} else if(system->cpu_int_control & system->video->cpu_int_pending) {
+	} else if(system->cpu_int_control & (system->video->cpu_int_pending | system->risc_int_pending)) {
 		m68k->int_cycle = m68k->current_cycle;
 		//supposedly all interrupts on the jaguar are "level 0" autovector interrupts
 		//which I assume means they're abusing the "spurious interrupt" vector
@@ -92,6 +93,26 @@ void jag_update_m68k_int(jaguar_context *system)
 	}
 }
 
+//GPU and DSP registers are 32-bits wide, so the high word is latched until the low word is written
+static void jag_risc_reg_write(jaguar_context *system, jag_cpu *cpu, uint32_t offset, uint16_t value)
+{
+	if (!(offset & 2)) {
+		system->write_latch = value;
+		system->write_pending = 1;
+		return;
+	}
+	uint32_t reg = offset >> 2;
+	uint32_t high = system->write_pending ? system->write_latch : jag_cpu_read_ctrl(cpu, reg) >> 16;
+	system->write_pending = 0;
+	jag_cpu_write_ctrl(cpu, reg, high << 16 | value);
+}
+
+static uint16_t jag_risc_reg_read(jag_cpu *cpu, uint32_t offset)
+{
+	uint32_t value = jag_cpu_read_ctrl(cpu, offset >> 2);
+	return offset & 2 ? value : value >> 16;
+}
+
 void rom0_write_16(uint32_t address, jaguar_context *system, uint16_t value)
 {
 	//TODO: Use write_latch and write_pending to turn two 16-bit writes into a 32-bit one
@@ -147,9 +168,9 @@ void rom0_write_16(uint32_t address, jaguar_context *system, uint16_t value)
 				case 0xE0:
 					system->cpu_int_control = value & 0x1F;
 					system->video->cpu_int_pending &= ~(value >> 8);
-					printf("INT1 write: %X @ %d - int_pending: %X, int_control: %X\n", value, system->m68k->current_cycle, system->video->cpu_int_pending, system->cpu_int_control);
+					system->risc_int_pending &= ~(value >> 8);
+					printf("INT1 write: %X @ %d - int_pending: %X, int_control: %X\n", value, system->m68k->current_cycle, system->video->cpu_int_pending | system->risc_int_pending, system->cpu_int_control);
 					jag_update_m68k_int(system);
-					//TODO: apply mask to int pending fields on other components once they are implemented
 					break;
 				case 0xE2:
 					//no real handling of bus conflicts presently, so this doesn't really need to do anything yet
@@ -186,19 +207,10 @@ void rom0_write_16(uint32_t address, jaguar_context *system, uint16_t value)
 		} else {
 			//GPU/Blitter registers
 			if (address < 0x102200) {
-				fprintf(stderr, "Unhandled write to GPU registers %X: %X\n", address, value);
-				if (address == 0x102116 && (value & 1)) {
-					FILE *f = fopen("gpu.bin", "wb");
-					uint8_t buf[4];
-					for (int i = 0; i < GPU_RAM_BYTES/sizeof(uint32_t); i++)
-					{
-						buf[0] = system->gpu_local[i] >> 24;
-						buf[1] = system->gpu_local[i] >> 16;
-						buf[2] = system->gpu_local[i] >> 8;
-						buf[3] = system->gpu_local[i];
-						fwrite(buf, 1, sizeof(buf), f);
-					}
-					fclose(f);
+				if (address < 0x102100 + DSP_MACHI * 4) {
+					jag_risc_reg_write(system, system->gpu, address - 0x102100, value);
+				} else {
+					fprintf(stderr, "Unhandled write to GPU registers %X: %X\n", address, value);
 				}
 			} else {
 				fprintf(stderr, "Unhandled write to Blitter registers %X: %X\n", address, value);
@@ -207,7 +219,7 @@ void rom0_write_16(uint32_t address, jaguar_context *system, uint16_t value)
 	} else if (address < 0x11A100) {
 		if (address < 0x110000) {
 			//GPU Local RAM
-				uint32_t offset = address >> 2 & (GPU_RAM_BYTES / sizeof(uint32_t) - 1);
+			uint32_t offset = address >> 2 & (GPU_RAM_BYTES / sizeof(uint32_t) - 1);
 			uint32_t value32 = value;
 			if (address & 2) {
 				system->gpu_local[offset] &= 0xFFFF0000;
@@ -216,6 +228,7 @@ void rom0_write_16(uint32_t address, jaguar_context *system, uint16_t value)
 				value32 = value32 << 16;
 			}
 			system->gpu_local[offset] |= value32;
+			jag_cpu_local_written(system->gpu, offset * sizeof(uint32_t));
 		} else if (address < 0x114000) {
 			//timer clock registers
 			fprintf(stderr, "Unhandled write to timer/clock registers - %X:%X\n", address, value);
@@ -225,7 +238,11 @@ void rom0_write_16(uint32_t address, jaguar_context *system, uint16_t value)
 		}
 	} else if (address < 0x11B000) {
 		//DSP/DAC/I2S Registers
-		fprintf(stderr, "Unhandled write to DSP/DAC/I2S registers - %X:%X\n", address, value);
+		if (address < 0x11A100 + JAG_NUM_CTRL * 4) {
+			jag_risc_reg_write(system, system->dsp, address - 0x11A100, value);
+		} else {
+			fprintf(stderr, "Unhandled write to DSP/DAC/I2S registers - %X:%X\n", address, value);
+		}
 	} else if (address < 0x11D000) {
 		//DSP local RAM
 		uint32_t offset = address >> 2 & (DSP_RAM_BYTES / sizeof(uint32_t) - 1);
@@ -236,7 +253,8 @@ void rom0_write_16(uint32_t address, jaguar_context *system, uint16_t value)
 			system->dsp_local[offset] &= 0x0000FFFF;
 			value32 = value32 << 16;
 		}
-		system->gpu_local[offset] |= value32;
+		system->dsp_local[offset] |= value32;
+		jag_cpu_local_written(system->dsp, offset * sizeof(uint32_t));
 	} else {
 		//Wave table ROM
 		fprintf(stderr, "Invalid write to wave table ROM - %X:%X\n", address, value);
@@ -258,8 +276,7 @@ uint16_t rom0_read_16(uint32_t address, jaguar_context *system)
 				{
 				case 0xE0:
 					puts("INT1 read");
-					//TODO: Bitwise or with cpu_int_pending fields from other components once implemented
-					return system->video->cpu_int_pending;
+					return system->video->cpu_int_pending | system->risc_int_pending;
 					break;
 				default:
 					fprintf(stderr, "Unhandled read from video mode/memory control registers - %X\n", address);
@@ -289,7 +306,9 @@ uint16_t rom0_read_16(uint32_t address, jaguar_context *system)
 			}
 		} else {
 			//GPU/Blitter registers
-			if (address < 0x102200) {
+			if (address < 0x102100 + DSP_MACHI * 4) {
+				return jag_risc_reg_read(system->gpu, address - 0x102100);
+			} else if (address < 0x102200) {
 				fprintf(stderr, "Unhandled read from GPU registers %X\n", address);
 			} else {
 				fprintf(stderr, "Unhandled read from Blitter registers %X\n", address);
@@ -313,6 +332,9 @@ uint16_t rom0_read_16(uint32_t address, jaguar_context *system)
 		}
 	} else if (address < 0x11B000) {
 		//DSP/DAC/I2S Registers
+		if (address < 0x11A100 + JAG_NUM_CTRL * 4) {
+			return jag_risc_reg_read(system->dsp, address - 0x11A100);
+		}
 		fprintf(stderr, "Unhandled read from DSP/DAC/I2S registers - %X\n", address);
 	} else if (address < 0x11D000) {
 		//DSP local RAM
@@ -435,14 +457,85 @@ uint32_t jag_write_phrase(jaguar_context *system, uint32_t address, uint64_t val
 	return cycles;
 }
 
+//returns NULL for addresses that need to go through rom0_read_16/rom0_write_16
+static uint16_t *jag_risc_mem_pointer(jaguar_context *system, uint32_t address, uint8_t *is_cart)
+{
+	*is_cart = 0;
+	if (!system->memcon_written) {
+		return NULL;
+	}
+	if (system->memcon1 & 1) {
+		if (address < 0x800000) {
+			return system->dram + (address >> 1 & (DRAM_WORDS - 1));
+		} else if (address < 0xE00000) {
+			*is_cart = 1;
+			return system->cart + (address >> 1 & ((system->cart_size >> 1) - 1));
+		}
+	} else if (address > 0x800000) {
+		return system->dram + (address >> 1 & (DRAM_WORDS - 1));
+	} else if (address > 0x200000) {
+		*is_cart = 1;
+		return system->cart + (address >> 1 & ((system->cart_size >> 1) - 1));
+	}
+	return NULL;
+}
+
+static uint16_t jag_risc_read_16(uint32_t address, void *vsystem)
+{
+	jaguar_context *system = vsystem;
+	uint8_t is_cart;
+	uint16_t *ptr = jag_risc_mem_pointer(system, address, &is_cart);
+	if (ptr) {
+		return *ptr;
+	}
+	return rom0_read_16(address & 0x1FFFFF, system);
+}
+
+static void jag_risc_write_16(uint32_t address, void *vsystem, uint16_t value)
+{
+	jaguar_context *system = vsystem;
+	uint8_t is_cart;
+	uint16_t *ptr = jag_risc_mem_pointer(system, address, &is_cart);
+	if (ptr) {
+		if (!is_cart) {
+			*ptr = value;
+		}
+		return;
+	}
+	rom0_write_16(address & 0x1FFFFF, system, value);
+}
+
+static void jag_risc_write_8(uint32_t address, void *vsystem, uint8_t value)
+{
+	uint16_t value16 = jag_risc_read_16(address & ~1, vsystem);
+	if (address & 1) {
+		value16 = (value16 & 0xFF00) | value;
+	} else {
+		value16 = (value16 & 0xFF) | value << 8;
+	}
+	jag_risc_write_16(address & ~1, vsystem, value16);
+}
+
+static void jag_risc_cpu_int(void *vsystem, uint8_t is_gpu)
+{
+	jaguar_context *system = vsystem;
+	//the DSP actually goes through the interrupt controller in Jerry, which is assumed to pass it through
+	system->risc_int_pending |= is_gpu ? BIT_CPU_GPU_INT_ENABLED : BIT_CPU_DSP_INT_ENABLED;
+	jag_update_m68k_int(system);
+}
+
 m68k_context * sync_components(m68k_context * context, uint32_t address)
 {
 	jaguar_context *system = context->system;
 	jag_video_run(system->video, context->current_cycle);
+	jag_cpu_run(system->gpu, context->current_cycle);
+	jag_cpu_run(system->dsp, context->current_cycle);
 	jag_update_m68k_int(system);
 	if (context->current_cycle > 0x10000000) {
 		context->current_cycle -= 0x10000000;
 		system->video->cycles -= 0x10000000;
+		jag_cpu_adjust_cycles(system->gpu, 0x10000000);
+		jag_cpu_adjust_cycles(system->dsp, 0x10000000);
 	}
 	if (context->int_ack) {
 		context->int_ack = 0;
@@ -525,6 +618,21 @@ jaguar_context *init_jaguar(uint16_t *bios, uint32_t bios_size, uint16_t *cart,
 	system->m68k->system = system;
 	system->video = jag_video_init();
 	system->video->system = system;
+	
+	uint32_t risc_flags = 0;
+	if (!strcmp("interpreter", tern_find_path_default(config, "jaguar\0risc_core\0", (tern_val){.ptrval = "jit"}, TVAL_PTR).ptrval)) {
+		risc_flags |= JAG_OPT_INTERPRET;
+	}
+	jag_cpu_options *gpu_opts = malloc(sizeof(jag_cpu_options));
+	jag_cpu_options *dsp_opts = malloc(sizeof(jag_cpu_options));
+	init_jag_cpu_opts(gpu_opts, 1, risc_flags);
+	init_jag_cpu_opts(dsp_opts, 0, risc_flags);
+	gpu_opts->read_16 = dsp_opts->read_16 = jag_risc_read_16;
+	gpu_opts->write_16 = dsp_opts->write_16 = jag_risc_write_16;
+	gpu_opts->write_8 = dsp_opts->write_8 = jag_risc_write_8;
+	gpu_opts->cpu_int = dsp_opts->cpu_int = jag_risc_cpu_int;
+	system->gpu = init_jag_cpu(gpu_opts, system->gpu_local, system);
+	system->dsp = init_jag_cpu(dsp_opts, system->dsp_local, system);
 	return system;
 }
 
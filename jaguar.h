@@ -6,10 +6,13 @@
 #define DSP_RAM_BYTES 8192
 
 #include "jag_video.h"
+#include "jagcpu.h"
 typedef struct m68k_context m68k_context;
 typedef struct {
 	m68k_context *m68k;
 	jag_video    *video;
+	jag_cpu      *gpu;
+	jag_cpu      *dsp;
 	uint16_t     *bios;
 	uint16_t     *cart;
 	uint32_t     bios_size;
@@ -21,6 +24,8 @@ typedef struct {
 	uint16_t     cpu_int_control;
 	uint16_t     write_latch;
 	uint8_t      write_pending;
+	//INT1 pending bits raised by the GPU and DSP setting CPUINT
+	uint8_t      risc_int_pending;
 	
 	uint16_t     dram[DRAM_WORDS];
 	uint32_t     gpu_local[GPU_RAM_BYTES / sizeof(uint32_t)];
@@ -30,6 +35,8 @@ typedef struct {
 } jaguar_context;
 
 #define BIT_CPU_VID_INT_ENABLED 0x01
+#define BIT_CPU_GPU_INT_ENABLED 0x02
+#define BIT_CPU_DSP_INT_ENABLED 0x10
 
 uint64_t jag_read_phrase(jaguar_context *system, uint32_t address, uint32_t *cycles);
 uint32_t jag_write_phrase(jaguar_context *system, uint32_t address, uint64_t value);
@@ -44,6 +44,9 @@ static retro_video_refresh_t video_cb = NULL;
 static retro_audio_sample_batch_t  audio_batch_cb = NULL;
 static retro_log_printf_t    log_cb   = NULL;
 
+/* whether the frontend accepts NULL from video_cb to repeat the previous frame */
+static bool can_dupe = false;
+
 static bool uint_env(unsigned env, unsigned value) { return env_cb(env, &value); }
 
 static uint32_t overscan_top[NUM_VID_STD] = {2, 21};
@@ -57,7 +60,6 @@ static char *vid_std_names[NUM_VID_STD] = {"ntsc", "pal"};
 extern uint16_t *cart;
 extern tern_node * config;
 extern const memmap_chunk base_map[3];
-extern char * save_filename;
 extern uint8_t version_reg;
 #define MCLKS_NTSC 53693175
 #define MCLKS_PAL  53203395
@@ -81,15 +83,7 @@ void init_run_cpu(genesis_context * gen, rom_info *rom, FILE * address_log, char
 static system_media rcart, rlock_on;
 system_header *current_system;
 
-/* extracted from main() */
-static vdp_context v_context;
-static genesis_context gen;
-static ym2612_context y_context;
-static psg_context p_context;
-static z80_context z_context;
-static z80_options z_opts;
-
-unsigned int *texbuffer[2];
+pixel_t *texbuffer[2];
 
 void render_close_audio()
 {
@@ -101,9 +95,19 @@ int render_num_joysticks()
    return NUM_JOYPADS;
 }
 
+#ifdef RENDER_RGB565
+#define RENDER_PIXEL_FORMAT RETRO_PIXEL_FORMAT_RGB565
+#else
+#define RENDER_PIXEL_FORMAT RETRO_PIXEL_FORMAT_XRGB8888
+#endif
+
 uint32_t render_map_color(uint8_t r, uint8_t g, uint8_t b)
 {
+#ifdef RENDER_RGB565
+   return (r >> 3) << 11 | (g >> 2) << 5 | b >> 3;
+#else
    return 255 << 24 | r << 16 | g << 8 | b;
+#endif
 }
 
 void render_alloc_surfaces()
@@ -113,8 +117,8 @@ void render_alloc_surfaces()
    context->evenbuf = ((char *)context->oddbuf) + 512 * 256 * 4;
 */
 //context->fb= calloc(1, 512 * 256 * 4 * 2);
-   texbuffer[0]= calloc(1, 512 * 512 * 4 );
-   texbuffer[1]= calloc(1, 512 * 512 * 4 );
+   texbuffer[0]= calloc(1, 512 * 512 * sizeof(pixel_t));
+   texbuffer[1]= calloc(1, 512 * 512 * sizeof(pixel_t));
 }
 
 void render_init(int width, int height, char * title/*, uint32_t fps*/,uint8_t fullscreen)
@@ -124,16 +128,56 @@ void render_init(int width, int height, char * title/*, uint32_t fps*/,uint8_t f
    handle_joy_added(1);
 }
 
+/* frontend provided framebuffer the VDP renders into directly, valid for the current retro_run only */
+static struct retro_framebuffer frontend_fb;
+static uint8_t frontend_fb_valid;
+static vdp_context *render_vdp;
+static void *vdp_target;
+static void *completed_fb;
+
+static void acquire_frontend_framebuffer(void)
+{
+   frontend_fb_valid = 0;
+   if (!render_vdp)
+      return;
+   /* interlaced output is woven together from two fields so it still goes through the copy below */
+   if (!(render_vdp->regs[REG_MODE_4] & BIT_INTERLACE))
+   {
+      /* the VDP writes full lines including the border and parks offscreen lines at INVALID_LINE */
+      frontend_fb.width        = LINEBUF_SIZE;
+      frontend_fb.height       = INVALID_LINE + 1;
+      frontend_fb.access_flags = RETRO_MEMORY_ACCESS_WRITE;
+      frontend_fb_valid = env_cb(RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER, &frontend_fb)
+         && frontend_fb.data
+         && frontend_fb.format == RENDER_PIXEL_FORMAT
+         && frontend_fb.pitch >= LINEBUF_SIZE * sizeof(pixel_t);
+   }
+   if (frontend_fb_valid ? vdp_target != frontend_fb.data : (vdp_target != texbuffer[0] && vdp_target != texbuffer[1]))
+      vdp_reacquire_framebuffer(render_vdp);
+}
+
 void render_context(vdp_context * context)
 {
-   static uint32_t screen[320 * 480];
+   static pixel_t screen[320 * 480];
    unsigned width  = context->regs[REG_MODE_4] & BIT_H40 ? 320.0f : 256.0f;
    unsigned height = 224;
    unsigned skip   = width;
-   uint32_t *src = (uint32_t*)context->fb;//framebuf;
-   uint32_t *dst = screen;
+   pixel_t *src = context->fb;//framebuf;
+   pixel_t *dst = screen;
    int i;
 
+   if (context->frame_unchanged && can_dupe)
+   {
+      video_cb(NULL, width, height, 0);
+      return;
+   }
+
+   if (frontend_fb_valid && completed_fb == frontend_fb.data && !(context->regs[REG_MODE_4] & BIT_INTERLACE))
+   {
+      video_cb(frontend_fb.data, width, height, frontend_fb.pitch);
+      return;
+   }
+
    if (context->regs[REG_MODE_4] & BIT_INTERLACE)
    {
       skip   *= 2;
@@ -145,12 +189,12 @@ void render_context(vdp_context * context)
 
    for (i = 0; i < 224; ++i)
    {
-      memcpy(dst, src, width*sizeof(uint32_t));
+      memcpy(dst, src, width*sizeof(pixel_t));
       src += width;
       dst += skip;
    }
 
-   video_cb(screen, width, height, width*sizeof(uint32_t));
+   video_cb(screen, width, height, width*sizeof(pixel_t));
 /*
    if (context->regs[REG_MODE_4] & BIT_INTERLACE)
       context->framebuf = context->framebuf == context->oddbuf ? context->evenbuf : context->oddbuf;*/
@@ -185,10 +229,11 @@ void render_update_caption(char *title)
 }
 void render_framebuffer_updated(uint8_t which, int width)
 {
+   completed_fb = vdp_target;
 }
-uint32_t *locked_pixels;
+pixel_t *locked_pixels;
 uint32_t locked_pitch;
-uint32_t *render_get_framebuffer(uint8_t which, int *pitch)
+pixel_t *render_get_framebuffer(uint8_t which, int *pitch)
 {
 //printf("TTTTOOTTTOO\n");
 
@@ -204,8 +249,16 @@ uint32_t *render_get_framebuffer(uint8_t which, int *pitch)
 			return NULL;
 		}
 */
-      *pitch=320*4;
+      if (frontend_fb_valid && which != FRAMEBUFFER_EVEN)
+      {
+         *pitch = frontend_fb.pitch;
+         vdp_target = locked_pixels = frontend_fb.data;
+         locked_pitch = *pitch;
+         return frontend_fb.data;
+      }
+      *pitch=320*sizeof(pixel_t);
       pixels=texbuffer[which];
+      vdp_target = pixels;
 
 		static uint8_t last;
 		if (which <= FRAMEBUFFER_EVEN) {
@@ -355,6 +408,7 @@ static void flush_audio(void)
 
 int wait_render_frame(vdp_context * context, int frame_limit)
 {
+   render_vdp = context;
    poll_cb();
    handle_events();
 
@@ -461,12 +515,11 @@ static int parse_rom(const uint8_t *data, size_t size)
 
       while (remaining > 0 && remaining < size)
       {
-         uint8_t  block[SMD_BLOCK_SIZE];
-         uint8_t *low  = block;
-         uint8_t *high = block+(SMD_BLOCK_SIZE/2);
-         uint8_t *end  = block+SMD_BLOCK_SIZE;
+         /* deinterleave straight out of the frontend's buffer */
+         const uint8_t *low  = data;
+         const uint8_t *high = data+(SMD_BLOCK_SIZE/2);
+         const uint8_t *end  = data+SMD_BLOCK_SIZE;
 
-         memcpy(block, data, SMD_BLOCK_SIZE);
          data += SMD_BLOCK_SIZE;
 
          for (; high < end; high++, low++)
@@ -648,6 +701,7 @@ void gdb_debug_enter(m68k_context * context, uint32_t pc)
 
 RETRO_API void retro_run(void)
 {
+   acquire_frontend_framebuffer();
    co_switch(cpu_thread);
 }
 
@@ -662,7 +716,6 @@ RETRO_API void retro_init(void)
    main_thread = co_active();
    cpu_thread  = co_create(65536 * sizeof(void*), cpu_thread_wrapper);
 
-   save_filename = (char*)"/xxxx_blastem__/a";
    set_exe_str((char*)"./blastem");
    config = init_config();
 }
@@ -684,7 +737,9 @@ RETRO_API bool retro_load_game(const struct retro_game_info *game)
 
    co_switch(cpu_thread);
 
-   uint_env(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, RETRO_PIXEL_FORMAT_XRGB8888);
+   uint_env(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, RENDER_PIXEL_FORMAT);
+   if (!env_cb(RETRO_ENVIRONMENT_GET_CAN_DUPE, &can_dupe))
+      can_dupe = false;
 
    co_switch(cpu_thread);
 
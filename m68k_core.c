@@ -189,6 +189,11 @@ static void push_const(m68k_options *opts, int32_t value)
 void jump_m68k_abs(m68k_options * opts, uint32_t address)
 {
 	code_info *code = &opts->gen.code;
+	if (opts->trace_follow) {
+		//the superblock being built continues with the code at the destination
+		opts->trace_follow = 0;
+		return;
+	}
 	code_ptr dest_addr = get_native_address(opts, address);
 	if (!dest_addr) {
 		opts->gen.deferred = defer_address(opts->gen.deferred, address, code->cur + 1);
@@ -316,6 +321,11 @@ static void translate_m68k_rts(m68k_options * opts, m68kinst * inst)
 	addi_areg(opts, 4, 7);
 	call(code, opts->read_32);
 	cycles(&opts->gen, 2*BUS);
+	if (opts->trace_return) {
+		m68k_trace_return(opts, opts->trace_return);
+		opts->trace_return = 0;
+		return;
+	}
 	call(code, opts->native_addr);
 	jmp_r(code, opts->gen.scratch1);
 }
@@ -787,6 +797,56 @@ uint16_t m68k_get_ir(m68k_context *context)
 	return 0xFFFF;
 }
 
+#define M68K_RUN_BUCKETS 256
+
+static void m68k_force_checked_runs(m68k_options *opts, uint32_t address)
+{
+	if (!opts->runs) {
+		return;
+	}
+	for (uint32_t i = 0; i < M68K_RUN_BUCKETS; i++)
+	{
+		for (m68k_run *run = opts->runs[i]; run; run = run->next)
+		{
+			if (address > run->address && address < run->end) {
+				//the fast path has no way to stop in the middle so always use a fresh checked copy
+				m68k_run_force_checked(run);
+				run->checked = NULL;
+			}
+		}
+	}
+}
+
+#define M68K_TRACE_BUCKETS 256
+#define M68K_TRACE_THRESHOLD 32
+
+static void m68k_break_traces(m68k_options *opts, uint32_t address)
+{
+	if (!opts->traces) {
+		return;
+	}
+	for (uint32_t i = 0; i < M68K_TRACE_BUCKETS; i++)
+	{
+		for (m68k_trace *trace = opts->traces[i]; trace; trace = trace->next)
+		{
+			if (!trace->native) {
+				continue;
+			}
+			//the first instruction is checked at the original entry point so it can stay
+			for (uint32_t j = 1; j < trace->num_insts; j++)
+			{
+				if (trace->insts[j] == address) {
+					//the next superblock built for this entry will stop short of the breakpoint
+					trace->native = NULL;
+					trace->count = M68K_TRACE_THRESHOLD;
+					m68k_trace_reset(opts, trace);
+					break;
+				}
+			}
+		}
+	}
+}
+
 static m68k_debug_handler find_breakpoint(m68k_context *context, uint32_t address)
 {
 	for (uint32_t i = 0; i < context->num_breakpoints; i++)
@@ -813,6 +873,8 @@ void insert_breakpoint(m68k_context * context, uint32_t address, m68k_debug_hand
 			.address = address
 		};
 		m68k_breakpoint_patch(context, address, bp_handler, NULL);
+		m68k_force_checked_runs(context->options, address);
+		m68k_break_traces(context->options, address);
 	}
 }
 
@@ -945,7 +1007,7 @@ static impl_info m68k_impls[] = {
 	RAW_IMPL(M68K_TAS, translate_m68k_tas),
 };
 
-static void translate_m68k(m68k_context *context, m68kinst * inst)
+static void translate_m68k(m68k_context *context, m68kinst * inst, uint8_t check_int)
 {
 	m68k_options * opts = context->options;
 	if (inst->address & 1) {
@@ -953,12 +1015,18 @@ static void translate_m68k(m68k_context *context, m68kinst * inst)
 		return;
 	}
 	code_ptr start = opts->gen.code.cur;
-	check_cycles_int(&opts->gen, inst->address);
+	if (check_int) {
+		check_cycles_int(&opts->gen, inst->address);
+	}
 	
 	m68k_debug_handler bp;
-	if ((bp = find_breakpoint(context, inst->address))) {
+	//breakpoints replace the cycle limit check so there's nothing to patch without one
+	if (check_int && (bp = find_breakpoint(context, inst->address))) {
 		m68k_breakpoint_patch(context, inst->address, bp, start);
 	}
+	if (opts->gen.flags & M68K_OPT_LOG_REGS) {
+		m68k_log_exec_call(opts, inst->address);
+	}
 	
 	//log_address(&opts->gen, inst->address, "M68K: %X @ %d\n");
 	if (
@@ -1002,7 +1070,260 @@ static void translate_m68k(m68k_context *context, m68kinst * inst)
 	}
 }
 
-void translate_m68k_stream(uint32_t address, m68k_context * context)
+static uint8_t is_static_rom(m68k_options *opts, uint32_t address)
+{
+	memmap_chunk const *chunk = find_map_chunk(address, &opts->gen, 0, NULL);
+	return chunk && chunk->buffer && (chunk->flags & (MMAP_READ|MMAP_WRITE|MMAP_CODE|MMAP_PTR_IDX)) == MMAP_READ;
+}
+
+static uint8_t run_operand_ok(uint8_t addr_mode)
+{
+	return addr_mode == MODE_REG || addr_mode == MODE_AREG || addr_mode == MODE_IMMEDIATE
+		|| addr_mode == MODE_IMMEDIATE_WORD || addr_mode == MODE_UNUSED;
+}
+
+//Determines whether an instruction can be part of a run that shares one cycle limit check
+//It needs to have a fixed cycle count and nothing it does can be observed outside the CPU
+static uint8_t m68k_can_coalesce(m68k_context *context, m68kinst *inst)
+{
+	m68k_options *opts = context->options;
+	if (
+		!(opts->gen.flags & M68K_OPT_COALESCE_CYCLES) || (inst->address & 1)
+		|| !run_operand_ok(inst->src.addr_mode) || !run_operand_ok(inst->dst.addr_mode)
+		|| find_breakpoint(context, inst->address)
+		//code that can change can't be handled since instructions in the middle of a run are not mapped
+		|| !is_static_rom(opts, inst->address)
+	) {
+		return 0;
+	}
+	switch (inst->op)
+	{
+	case M68K_ASL:
+	case M68K_ASR:
+	case M68K_LSL:
+	case M68K_LSR:
+	case M68K_ROL:
+	case M68K_ROR:
+	case M68K_ROXL:
+	case M68K_ROXR:
+		//shifts by a register count take a variable number of cycles
+		return inst->src.addr_mode == MODE_IMMEDIATE;
+	case M68K_ADD:
+	case M68K_ADDX:
+	case M68K_AND:
+	case M68K_CLR:
+	case M68K_CMP:
+	case M68K_EOR:
+	case M68K_EXG:
+	case M68K_EXT:
+	case M68K_MOVE:
+	case M68K_NEG:
+	case M68K_NEGX:
+	case M68K_NOP:
+	case M68K_NOT:
+	case M68K_OR:
+	case M68K_SUB:
+	case M68K_SUBX:
+	case M68K_SWAP:
+	case M68K_TST:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static uint8_t m68k_can_coalesce_at(m68k_context *context, uint32_t address)
+{
+	m68k_options *opts = context->options;
+	if (get_native_address(opts, address)) {
+		return 0;
+	}
+	uint16_t *encoded = get_native_pointer(address, (void **)context->mem_pointers, &opts->gen);
+	if (!encoded) {
+		return 0;
+	}
+	m68kinst inst;
+	m68k_decode(encoded, &inst, address);
+	return m68k_can_coalesce(context, &inst);
+}
+
+static m68k_run **m68k_run_bucket(m68k_options *opts, uint32_t address)
+{
+	if (!opts->runs) {
+		opts->runs = calloc(M68K_RUN_BUCKETS, sizeof(m68k_run *));
+	}
+	return opts->runs + (address >> 1) % M68K_RUN_BUCKETS;
+}
+
+static m68k_run *m68k_start_run(m68k_context *context, uint32_t address)
+{
+	m68k_options *opts = context->options;
+	m68k_run **bucket = m68k_run_bucket(opts, address);
+	m68k_run *run = calloc(1, sizeof(m68k_run));
+	run->address = address;
+	run->next = *bucket;
+	*bucket = run;
+	m68k_run_head(opts, run);
+	return run;
+}
+
+code_ptr m68k_checked_run(m68k_context *context, uint32_t address)
+{
+	m68k_options *opts = context->options;
+	m68k_run *run;
+	for (run = *m68k_run_bucket(opts, address); run && run->address != address; run = run->next)
+	{
+	}
+	if (!run) {
+		fatal_error("No coalesced run at %X\n", address);
+	}
+	if (!run->checked) {
+		code_ptr end = get_native_address_trans(context, run->end);
+		code_info *code = &opts->gen.code;
+		check_code_prologue(code);
+		run->checked = code->cur;
+		m68kinst instbuf;
+		for (uint32_t cur = run->address; cur < run->end;)
+		{
+			uint16_t *encoded = get_native_pointer(cur, (void **)context->mem_pointers, &opts->gen);
+			cur = (m68k_decode(encoded, &instbuf, cur) - encoded) * 2 + cur;
+			//the head of the run has already done the check for the first instruction
+			//and doing it twice would throw off the interrupt latency emulation
+			translate_m68k(context, &instbuf, instbuf.address != run->address);
+		}
+		jmp(code, end);
+	}
+	return run->checked;
+}
+
+static m68k_trace **m68k_trace_bucket(m68k_options *opts, uint32_t address)
+{
+	if (!opts->traces) {
+		opts->traces = calloc(M68K_TRACE_BUCKETS, sizeof(m68k_trace *));
+	}
+	return opts->traces + (address >> 1) % M68K_TRACE_BUCKETS;
+}
+
+static void m68k_start_trace(m68k_context *context, uint32_t address)
+{
+	m68k_options *opts = context->options;
+	code_ptr start = opts->gen.code.cur;
+	m68k_trace **bucket = m68k_trace_bucket(opts, address);
+	m68k_trace *trace = calloc(1, sizeof(m68k_trace));
+	trace->address = address;
+	trace->count = M68K_TRACE_THRESHOLD;
+	trace->next = *bucket;
+	*bucket = trace;
+	m68k_trace_head(opts, trace);
+	m68k_debug_handler bp = find_breakpoint(context, address);
+	if (bp) {
+		m68k_breakpoint_patch(context, address, bp, start);
+	}
+}
+
+//superblocks are never mapped, so they can only contain code that won't change or have a breakpoint
+static uint8_t m68k_trace_ok(m68k_context *context, uint32_t address)
+{
+	return !(address & 1) && is_static_rom(context->options, address) && !find_breakpoint(context, address);
+}
+
+//Returns the destination of a direct unconditional branch, jump or call or 0 if there isn't one
+static uint32_t m68k_trace_dest(m68kinst *inst)
+{
+	switch (inst->op)
+	{
+	case M68K_BCC:
+		return inst->extra.cond == COND_TRUE ? inst->address + 2 + inst->src.params.immed : 0;
+	case M68K_BSR:
+		return inst->address + 2 + inst->src.params.immed;
+	case M68K_JMP:
+	case M68K_JSR:
+		if (inst->src.addr_mode == MODE_PC_DISPLACE) {
+			return inst->address + 2 + inst->src.params.regs.displacement;
+		}
+		if (inst->src.addr_mode == MODE_ABSOLUTE || inst->src.addr_mode == MODE_ABSOLUTE_SHORT) {
+			return inst->src.params.immed;
+		}
+		return 0;
+	default:
+		return 0;
+	}
+}
+
+#define M68K_TRACE_MAX_CALLS 8
+
+static void m68k_build_trace(m68k_context *context, m68k_trace *trace)
+{
+	m68k_options *opts = context->options;
+	code_info *code = &opts->gen.code;
+	uint32_t returns[M68K_TRACE_MAX_CALLS];
+	uint32_t depth = 0;
+	m68kinst instbuf;
+	check_code_prologue(code);
+	trace->native = code->cur;
+	trace->num_insts = 0;
+	uint32_t address = trace->address;
+	for (;;)
+	{
+		uint8_t seen = 0;
+		for (uint32_t i = 0; i < trace->num_insts; i++)
+		{
+			seen |= trace->insts[i] == address;
+		}
+		if (seen || trace->num_insts == M68K_TRACE_MAX_INSTS || (trace->num_insts && !m68k_trace_ok(context, address))) {
+			jump_m68k_abs(opts, address);
+			break;
+		}
+		uint16_t *encoded = get_native_pointer(address, (void **)context->mem_pointers, &opts->gen);
+		uint16_t *next = m68k_decode(encoded, &instbuf, address);
+		if (instbuf.op == M68K_INVALID) {
+			instbuf.src.params.immed = *encoded;
+		}
+		trace->insts[trace->num_insts++] = address;
+		address += (next - encoded) * 2;
+		uint8_t is_call = instbuf.op == M68K_BSR || instbuf.op == M68K_JSR;
+		uint32_t dest = m68k_trace_dest(&instbuf) & opts->gen.address_mask;
+		if (dest && m68k_trace_ok(context, dest) && (!is_call || depth < M68K_TRACE_MAX_CALLS)) {
+			//lay out the destination right after the branch instead of jumping to it
+			opts->trace_follow = 1;
+			if (is_call) {
+				returns[depth++] = address;
+			}
+		} else if (instbuf.op == M68K_RTS && depth) {
+			//a return to the caller in the superblock only needs to confirm the address
+			dest = opts->trace_return = returns[--depth];
+		} else {
+			dest = 0;
+		}
+		//the first instruction was already checked at the original entry point
+		translate_m68k(context, &instbuf, trace->num_insts > 1);
+		if (dest) {
+			address = dest;
+		} else if (m68k_is_terminal(&instbuf)) {
+			break;
+		}
+	}
+	m68k_handle_deferred(context);
+}
+
+code_ptr m68k_hot_trace(m68k_context *context, uint32_t address)
+{
+	m68k_options *opts = context->options;
+	m68k_trace *trace;
+	for (trace = *m68k_trace_bucket(opts, address); trace && trace->address != address; trace = trace->next)
+	{
+	}
+	if (!trace) {
+		fatal_error("No superblock entry at %X\n", address);
+	}
+	if (!trace->native) {
+		m68k_build_trace(context, trace);
+		m68k_trace_link(trace);
+	}
+	return trace->native;
+}
+
+static void translate_m68k_stream_ex(uint32_t address, m68k_context * context, native_addr_func get_native)
 {
 	m68kinst instbuf;
 	m68k_options * opts = context->options;
@@ -1011,10 +1332,13 @@ void translate_m68k_stream(uint32_t address, m68k_context * context)
 		return;
 	}
 	uint16_t *encoded, *next;
+	m68k_run *run = NULL;
+	uint32_t run_start_cycles = 0, run_last_cycles = 0;
 	do {
-		if (opts->address_log) {
-			fprintf(opts->address_log, "%X\n", address);
-			fflush(opts->address_log);
+		uint8_t block_start = 1;
+		//with register logging every executed instruction is logged instead
+		if (opts->address_log && !(opts->gen.flags & M68K_OPT_LOG_REGS)) {
+			trace_pc(opts->address_log, address, context->current_cycle);
 		}
 		do {
 			encoded = get_native_pointer(address, (void **)context->mem_pointers, &opts->gen);
@@ -1043,17 +1367,97 @@ void translate_m68k_stream(uint32_t address, m68k_context * context)
 			//make sure the beginning of the code for an instruction is contiguous
 			check_code_prologue(code);
 			code_ptr start = code->cur;
-			translate_m68k(context, &instbuf);
+			uint8_t head = 0;
+			//block entries count how often they run so hot ones can be rebuilt as superblocks
+			uint8_t trace_head = block_start && (opts->gen.flags & M68K_OPT_TRACES)
+				&& !(instbuf.address & 1) && is_static_rom(opts, instbuf.address);
+			block_start = 0;
+			if (run && !m68k_can_coalesce(context, &instbuf)) {
+				patch_cycles_ahead(run->ahead, run_last_cycles - run_start_cycles);
+				run = NULL;
+			}
+			if (!run && !trace_head && m68k_can_coalesce(context, &instbuf) && m68k_can_coalesce_at(context, address)) {
+				run = m68k_start_run(context, instbuf.address);
+				run_start_cycles = opts->gen.static_cycles;
+				head = 1;
+			}
+			if (run) {
+				run_last_cycles = opts->gen.static_cycles;
+				run->end = address;
+			}
+			if (trace_head) {
+				m68k_start_trace(context, instbuf.address);
+			}
+			translate_m68k(context, &instbuf, !run && !trace_head);
 			code_ptr after = code->cur;
-			map_native_address(context, instbuf.address, start, m68k_size, after-start);
+			//instructions in the middle of a run have no check of their own so they can't be entry points
+			if (!run || head) {
+				map_native_address(context, instbuf.address, start, m68k_size, after-start);
+			}
 		} while(!m68k_is_terminal(&instbuf) && !(address & 1));
-		process_deferred(&opts->gen.deferred, context, (native_addr_func)get_native_from_context);
+		if (run) {
+			patch_cycles_ahead(run->ahead, run_last_cycles - run_start_cycles);
+			run = NULL;
+		}
+		process_deferred(&opts->gen.deferred, context, get_native);
 		if (opts->gen.deferred) {
 			address = opts->gen.deferred->address;
 		}
 	} while(opts->gen.deferred);
 }
 
+void translate_m68k_stream(uint32_t address, m68k_context * context)
+{
+	translate_m68k_stream_ex(address, context, (native_addr_func)get_native_from_context);
+}
+
+static code_ptr get_native_pretranslate(m68k_context * context, uint32_t address)
+{
+	m68k_options *opts = context->options;
+	code_ptr native = get_native_address(opts, address);
+	if (!native && !is_static_rom(opts, address)) {
+		//RAM and banked ROM may not hold the right code yet, so resolve the destination
+		//through native_addr when the branch is actually taken
+		code_info *code = &opts->gen.code;
+		check_code_prologue(code);
+		native = code->cur;
+		ldi_native(opts, address, opts->gen.scratch1);
+		call(code, opts->native_addr);
+		jmp_r(code, opts->gen.scratch1);
+	}
+	return native;
+}
+
+void m68k_pretranslate(m68k_context * context)
+{
+	m68k_options *opts = context->options;
+	uint16_t *vectors = get_native_pointer(0, (void **)context->mem_pointers, &opts->gen);
+	if (!vectors) {
+		return;
+	}
+	//The reset vector and the interrupt autovectors are the only entry points that are
+	//reliably code, everything else is found by following direct branches from those
+	static const uint8_t entry_vectors[] = {1, 24, 25, 26, 27, 28, 29, 30, 31};
+	for (uint32_t i = 0; i < sizeof(entry_vectors); i++)
+	{
+		uint32_t vector = entry_vectors[i];
+		uint32_t address = (vectors[vector*2] << 16 | vectors[vector*2+1]) & 0xFFFFFF;
+		m68k_pretranslate_entries(context, &address, 1);
+	}
+}
+
+void m68k_pretranslate_entries(m68k_context * context, uint32_t *entries, uint32_t num_entries)
+{
+	m68k_options *opts = context->options;
+	for (uint32_t i = 0; i < num_entries; i++)
+	{
+		uint32_t address = entries[i] & 0xFFFFFF;
+		if (!(address & 1) && is_static_rom(opts, address) && !get_native_address(opts, address)) {
+			translate_m68k_stream_ex(address, context, (native_addr_func)get_native_pretranslate);
+		}
+	}
+}
+
 void * m68k_retranslate_inst(uint32_t address, m68k_context * context)
 {
 	m68k_options * opts = context->options;
@@ -1071,7 +1475,7 @@ void * m68k_retranslate_inst(uint32_t address, m68k_context * context)
 		//make sure we have enough code space for the max size instruction
 		check_alloc_code(code, MAX_NATIVE_SIZE);
 		code_ptr native_start = code->cur;
-		translate_m68k(context, &instbuf);
+		translate_m68k(context, &instbuf, 1);
 		code_ptr native_end = code->cur;
 		/*uint8_t is_terminal = m68k_is_terminal(&instbuf);
 		if ((native_end - native_start) <= orig_size) {
@@ -1087,7 +1491,7 @@ void * m68k_retranslate_inst(uint32_t address, m68k_context * context)
 				tmp.last = code->last;
 				code->cur = orig_code.cur;
 				code->last = orig_code.last;
-				translate_m68k(context, &instbuf);
+				translate_m68k(context, &instbuf, 1);
 				native_end = orig_code.cur = code->cur;
 				code->cur = tmp.cur;
 				code->last = tmp.last;
@@ -1120,7 +1524,7 @@ void * m68k_retranslate_inst(uint32_t address, m68k_context * context)
 	} else {
 		code_info tmp = *code;
 		*code = orig_code;
-		translate_m68k(context, &instbuf);
+		translate_m68k(context, &instbuf, 1);
 		orig_code = *code;
 		*code = tmp;
 		if (!m68k_is_terminal(&instbuf)) {
@@ -1141,11 +1545,62 @@ code_ptr get_native_address_trans(m68k_context * context, uint32_t address)
 	return ret;
 }
 
+static code_ptr unpatch_breakpoint(m68k_context *context, uint32_t address)
+{
+	code_ptr native = get_native_address(context->options, address);
+	if (!native) {
+		return NULL;
+	}
+	code_info tmp = context->options->gen.code;
+	context->options->gen.code.cur = native;
+	context->options->gen.code.last = native + MAX_NATIVE_SIZE;
+	check_cycles_int(&context->options->gen, address);
+	context->options->gen.code = tmp;
+	return native;
+}
+
+static void free_condition(m68k_bp_condition *cond)
+{
+	if (cond) {
+		free(cond->terms);
+		free(cond);
+	}
+}
+
+//Keeps the space of a stub that is no longer referenced so a later condition can be compiled into it
+static void release_cond_stub(m68k_options *opts, code_ptr stub, uint32_t size)
+{
+	if (!stub) {
+		return;
+	}
+	if (opts->num_free_cond_stubs == opts->free_cond_storage) {
+		opts->free_cond_storage = opts->free_cond_storage ? opts->free_cond_storage * 2 : 4;
+		opts->free_cond_stubs = realloc(opts->free_cond_stubs, opts->free_cond_storage * sizeof(cond_stub_space));
+	}
+	opts->free_cond_stubs[opts->num_free_cond_stubs++] = (cond_stub_space){stub, size};
+}
+
+static code_ptr take_cond_stub(m68k_options *opts, uint32_t *size)
+{
+	for (uint32_t i = 0; i < opts->num_free_cond_stubs; i++)
+	{
+		if (opts->free_cond_stubs[i].size >= *size) {
+			code_ptr stub = opts->free_cond_stubs[i].start;
+			*size = opts->free_cond_stubs[i].size;
+			opts->free_cond_stubs[i] = opts->free_cond_stubs[--opts->num_free_cond_stubs];
+			return stub;
+		}
+	}
+	return NULL;
+}
+
 void remove_breakpoint(m68k_context * context, uint32_t address)
 {
 	for (uint32_t i = 0; i < context->num_breakpoints; i++)
 	{
 		if (context->breakpoints[i].address == address) {
+			free_condition(context->breakpoints[i].condition);
+			release_cond_stub(context->options, context->breakpoints[i].cond_stub, context->breakpoints[i].cond_stub_size);
 			if (i != (context->num_breakpoints-1)) {
 				context->breakpoints[i] = context->breakpoints[context->num_breakpoints-1];
 			}
@@ -1153,15 +1608,189 @@ void remove_breakpoint(m68k_context * context, uint32_t address)
 			break;
 		}
 	}
-	code_ptr native = get_native_address(context->options, address);
-	if (!native) {
-		return;
+	unpatch_breakpoint(context, address);
+}
+
+//Attaches a condition to an existing breakpoint, replacing any previous one. The condition is
+//compiled into a stub that the breakpoint site calls so that the handler is only entered when
+//the condition holds. Takes ownership of cond, pass NULL to make the breakpoint unconditional
+uint8_t m68k_breakpoint_condition(m68k_context *context, uint32_t address, m68k_bp_condition *cond)
+{
+	m68k_breakpoint *bp = NULL;
+	for (uint32_t i = 0; i < context->num_breakpoints; i++)
+	{
+		if (context->breakpoints[i].address == address) {
+			bp = context->breakpoints + i;
+			break;
+		}
 	}
-	code_info tmp = context->options->gen.code;
-	context->options->gen.code.cur = native;
-	context->options->gen.code.last = native + MAX_NATIVE_SIZE;
-	check_cycles_int(&context->options->gen, address);
-	context->options->gen.code = tmp;
+	if (!bp) {
+		free_condition(cond);
+		return 0;
+	}
+	m68k_options *opts = context->options;
+	code_ptr stub = NULL;
+	uint32_t size = 0;
+	if (cond) {
+		size = m68k_bp_condition_size(cond);
+		code_ptr space;
+		if (bp->cond_stub && bp->cond_stub_size >= size) {
+			//the old stub is not running while the debugger is, so the new one can replace it in place
+			space = bp->cond_stub;
+			size = bp->cond_stub_size;
+		} else {
+			space = take_cond_stub(opts, &size);
+		}
+		stub = m68k_bp_condition_stub(opts, cond, space, size);
+		if (!stub) {
+			if (space && space != bp->cond_stub) {
+				release_cond_stub(opts, space, size);
+			}
+			free_condition(cond);
+			return 0;
+		}
+	}
+	if (bp->cond_stub != stub) {
+		release_cond_stub(opts, bp->cond_stub, bp->cond_stub_size);
+	}
+	free_condition(bp->condition);
+	bp->condition = cond;
+	bp->cond_stub = stub;
+	bp->cond_stub_size = size;
+	code_ptr native = unpatch_breakpoint(context, address);
+	if (native) {
+		m68k_breakpoint_patch(context, address, bp->handler, native);
+	}
+	return 1;
+}
+
+static void update_watch_pages(m68k_context *context)
+{
+	memset(context->watch_pages, 0, sizeof(context->watch_pages));
+	for (uint32_t i = 0; i < context->num_watchpoints; i++)
+	{
+		uint32_t last = (context->watchpoints[i].end - 1) & 0xFFFFFF;
+		for (uint32_t page = context->watchpoints[i].start >> M68K_WATCH_PAGE_SHIFT; page <= last >> M68K_WATCH_PAGE_SHIFT; page++)
+		{
+			context->watch_pages[page >> 3] |= 1 << (page & 7);
+		}
+	}
+}
+
+static void watch_range(uint32_t *start, uint32_t *end)
+{
+	uint32_t len = *end > *start ? *end - *start : 1;
+	*start &= 0xFFFFFF;
+	*end = *start + len;
+	if (*end > 0x1000000) {
+		*end = 0x1000000;
+	}
+}
+
+void m68k_add_watchpoint(m68k_context *context, uint32_t start, uint32_t end, uint8_t type, m68k_debug_handler handler)
+{
+	watch_range(&start, &end);
+	if (context->watch_storage == context->num_watchpoints) {
+		context->watch_storage *= 2;
+		if (context->watch_storage < 4) {
+			context->watch_storage = 4;
+		}
+		context->watchpoints = realloc(context->watchpoints, context->watch_storage * sizeof(m68k_watchpoint));
+	}
+	context->watchpoints[context->num_watchpoints++] = (m68k_watchpoint){
+		.handler = handler,
+		.start = start,
+		.end = end,
+		.type = type
+	};
+	update_watch_pages(context);
+	m68k_watch_enable(context->options);
+}
+
+uint8_t m68k_remove_watchpoint(m68k_context *context, uint32_t start, uint32_t end, uint8_t type)
+{
+	watch_range(&start, &end);
+	for (uint32_t i = 0; i < context->num_watchpoints; i++)
+	{
+		m68k_watchpoint *watch = context->watchpoints + i;
+		if (watch->start == start && watch->end == end && watch->type == type) {
+			*watch = context->watchpoints[--context->num_watchpoints];
+			update_watch_pages(context);
+			if (!context->num_watchpoints) {
+				//restore the original entry points so unwatched code pays nothing
+				m68k_watch_disable(context->options);
+			}
+			return 1;
+		}
+	}
+	return 0;
+}
+
+//Called from the memory access functions when an access touches a watched page
+m68k_context *m68k_watch_hit(m68k_context *context, uint32_t address, uint32_t access)
+{
+	address &= 0xFFFFFF;
+	uint32_t end = address + ((access & M68K_WATCH_WORD) ? 2 : 1);
+	access &= M68K_WATCH_ACCESS;
+	if (context->watch_handler) {
+		//only the first hit in an instruction is reported
+		return context;
+	}
+	for (uint32_t i = 0; i < context->num_watchpoints; i++)
+	{
+		m68k_watchpoint *watch = context->watchpoints + i;
+		if ((watch->type & access) && address < watch->end && end > watch->start) {
+			context->watch_handler = watch->handler;
+			context->watch_address = address;
+			context->watch_access = access;
+			context->watch_type = watch->type;
+			//force a sync so the handler runs once the current instruction completes
+			context->sync_cycle = context->current_cycle;
+			if (context->target_cycle > context->sync_cycle) {
+				context->target_cycle = context->sync_cycle;
+			}
+			break;
+		}
+	}
+	return context;
+}
+
+//Called before each instruction when register logging is enabled. Register changes are
+//reported here, so they are attributed to the previously logged PC
+m68k_context *m68k_log_exec(m68k_context *context, uint32_t pc)
+{
+	m68k_options *opts = context->options;
+	uint32_t cycle = context->current_cycle;
+	for (int i = 0; i < 16; i++)
+	{
+		uint32_t value = i < 8 ? context->dregs[i] : context->aregs[i - 8];
+		if (value != opts->log_regs[i]) {
+			trace_reg(opts->address_log, cycle, i, value);
+			opts->log_regs[i] = value;
+		}
+	}
+	trace_pc(opts->address_log, pc, cycle);
+	return context;
+}
+
+m68k_context *m68k_log_write_16(m68k_context *context, uint32_t address, uint32_t value)
+{
+	trace_mem(context->options->address_log, context->current_cycle, address & 0xFFFFFF, 2, value & 0xFFFF);
+	return context;
+}
+
+m68k_context *m68k_log_write_8(m68k_context *context, uint32_t address, uint32_t value)
+{
+	trace_mem(context->options->address_log, context->current_cycle, address & 0xFFFFFF, 1, value & 0xFF);
+	return context;
+}
+
+void m68k_watch_dispatch(m68k_context *context, uint32_t pc)
+{
+	m68k_debug_handler handler = context->watch_handler;
+	context->watch_handler = NULL;
+	handler(context, pc);
+	context->watch_type = 0;
 }
 
 void start_68k_context(m68k_context * context, uint32_t address)
@@ -1190,13 +1819,63 @@ void m68k_reset(m68k_context * context)
 	start_68k_context(context, address);
 }
 
+static void free_runs_traces(m68k_options *opts)
+{
+	if (opts->runs) {
+		for (uint32_t i = 0; i < M68K_RUN_BUCKETS; i++)
+		{
+			m68k_run *run = opts->runs[i];
+			while (run)
+			{
+				m68k_run *next = run->next;
+				free(run);
+				run = next;
+			}
+		}
+		free(opts->runs);
+		opts->runs = NULL;
+	}
+	if (opts->traces) {
+		for (uint32_t i = 0; i < M68K_TRACE_BUCKETS; i++)
+		{
+			m68k_trace *trace = opts->traces[i];
+			while (trace)
+			{
+				m68k_trace *next = trace->next;
+				free(trace);
+				trace = next;
+			}
+		}
+		free(opts->traces);
+		opts->traces = NULL;
+	}
+}
+
 void m68k_options_free(m68k_options *opts)
 {
 	free(opts->gen.native_code_map);
 	free(opts->gen.ram_inst_sizes);
+	free_runs_traces(opts);
+	free(opts->free_cond_stubs);
 	free(opts);
 }
 
+//Drops all code translated from the current memory contents, the caller is responsible for
+//rewinding opts->gen.code to a point after the generated stubs
+void m68k_discard_translations(m68k_options *opts)
+{
+	//watch and log wrappers and remapped handlers live in the code buffer that is about to be reused
+	opts->watch_enabled = 0;
+	memset(opts->watch_wrappers, 0, sizeof(opts->watch_wrappers));
+	memset(opts->mem_impl, 0, sizeof(opts->mem_impl));
+	memset(opts->log_wrappers, 0, sizeof(opts->log_wrappers));
+	opts->num_free_cond_stubs = 0;
+	m68k_patch_mem_entries(opts);
+	discard_translations(&opts->gen, NATIVE_MAP_CHUNKS);
+	free_runs_traces(opts);
+	opts->num_movem = 0;
+	memset(&opts->extra_code, 0, sizeof(opts->extra_code));
+}
 
 m68k_context * init_68k_context(m68k_options * opts, m68k_reset_handler reset_handler)
 {
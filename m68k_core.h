@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include "backend.h"
 #include "serialize.h"
+#include "trace.h"
 //#include "68kinst.h"
 struct m68kinst;
 
@@ -18,12 +19,26 @@ struct m68kinst;
 #define MAX_NATIVE_SIZE 255
 
 #define M68K_OPT_BROKEN_READ_MODIFY 1
+#define M68K_OPT_COALESCE_CYCLES    2
+#define M68K_OPT_TRACES             4
+#define M68K_OPT_LOG_REGS           8
+#define M68K_OPT_LOG_MEM            16
 
 #define INT_PENDING_SR_CHANGE 254
 #define INT_PENDING_NONE 255
 
 #define M68K_STATUS_TRACE 0x80
 
+//watchpoints are tracked at this granularity by the memory access fast path
+#define M68K_WATCH_PAGE_SHIFT 12
+#define M68K_WATCH_PAGES (16 * 1024 * 1024 >> M68K_WATCH_PAGE_SHIFT)
+
+#define M68K_WATCH_WRITE  1
+#define M68K_WATCH_READ   2
+#define M68K_WATCH_ACCESS (M68K_WATCH_WRITE | M68K_WATCH_READ)
+//set in the access type passed to the slow path for word sized accesses
+#define M68K_WATCH_WORD   4
+
 typedef void (*start_fun)(uint8_t * addr, void * context);
 
 typedef struct {
@@ -34,13 +49,22 @@ typedef struct {
 	int8_t   dir;
 } movem_fun;
 
+//space left behind by a replaced breakpoint condition stub
+typedef struct {
+	code_ptr start;
+	uint32_t size;
+} cond_stub_space;
+
+typedef struct m68k_run m68k_run;
+typedef struct m68k_trace m68k_trace;
+
 typedef struct {
 	cpu_options     gen;
 
 	int8_t          dregs[8];
 	int8_t          aregs[8];
 	int8_t			flag_regs[5];
-	FILE            *address_log;
+	trace_writer    *address_log;
 	code_ptr        read_16;
 	code_ptr        write_16;
 	code_ptr        read_8;
@@ -59,21 +83,86 @@ typedef struct {
 	code_ptr		set_sr;
 	code_ptr		set_ccr;
 	code_ptr        bp_stub;
+	code_ptr        bp_skip;
+	cond_stub_space *free_cond_stubs;
+	uint32_t        num_free_cond_stubs;
+	uint32_t        free_cond_storage;
+	code_ptr        checked_run;
+	m68k_run        **runs;
+	code_ptr        hot_trace;
+	m68k_trace      **traces;
+	uint32_t        trace_return;
+	uint8_t         trace_follow;
 	code_info       extra_code;
 	movem_fun       *big_movem;
 	uint32_t        num_movem;
 	uint32_t        movem_storage;
 	code_word       prologue_start;
+	code_ptr        watch_wrappers[4];
+	code_ptr        mem_impl[4];
+	code_ptr        log_wrappers[4];
+	code_ptr        log_exec;
+	uint32_t        log_regs[16];
+	uint8_t         entry_saved[4][5];
+	uint8_t         entries_patched;
+	uint8_t         watch_enabled;
 } m68k_options;
 
 typedef struct m68k_context m68k_context;
 typedef void (*m68k_debug_handler)(m68k_context *context, uint32_t pc);
 
+enum {
+	M68K_COND_DREG,
+	M68K_COND_AREG,
+	M68K_COND_MEM,
+	M68K_COND_HITS,
+	M68K_COND_IMMED
+};
+
+//comparisons are unsigned
+enum {
+	M68K_COND_EQ,
+	M68K_COND_NE,
+	M68K_COND_LT,
+	M68K_COND_LE,
+	M68K_COND_GT,
+	M68K_COND_GE
+};
+
+typedef struct {
+	uint32_t value; //register number, address or immediate value
+	uint8_t  kind;
+	uint8_t  size;  //access size in bytes
+} m68k_cond_operand;
+
+typedef struct {
+	m68k_cond_operand left;
+	m68k_cond_operand right;
+	uint8_t           op;
+} m68k_cond_term;
+
+//breakpoint condition, all terms must hold for the handler to be called
+typedef struct {
+	m68k_cond_term *terms;
+	uint32_t       num_terms;
+	uint32_t       hits; //number of times the breakpoint address has been reached
+} m68k_bp_condition;
+
 typedef struct {
 	m68k_debug_handler handler;
+	m68k_bp_condition  *condition;
+	code_ptr           cond_stub;
+	uint32_t           cond_stub_size;
 	uint32_t           address;
 } m68k_breakpoint;
 
+typedef struct {
+	m68k_debug_handler handler;
+	uint32_t           start;
+	uint32_t           end;
+	uint8_t            type;
+} m68k_watchpoint;
+
 struct m68k_context {
 	uint8_t         flags[5];
 	uint8_t         status;
@@ -94,9 +183,17 @@ struct m68k_context {
 	m68k_breakpoint *breakpoints;
 	uint32_t        num_breakpoints;
 	uint32_t        bp_storage;
+	m68k_watchpoint *watchpoints;
+	uint32_t        num_watchpoints;
+	uint32_t        watch_storage;
+	m68k_debug_handler watch_handler; //handler of a watchpoint hit waiting for the next instruction boundary
+	uint32_t        watch_address;
+	uint8_t         watch_access;
+	uint8_t         watch_type;
 	uint8_t         int_pending;
 	uint8_t         trace_pending;
 	uint8_t         should_return;
+	uint8_t         watch_pages[M68K_WATCH_PAGES / 8];
 	uint8_t         ram_code_flags[];
 };
 
@@ -104,14 +201,23 @@ typedef m68k_context *(*m68k_reset_handler)(m68k_context *context);
 
 
 void translate_m68k_stream(uint32_t address, m68k_context * context);
+void m68k_pretranslate(m68k_context * context);
+void m68k_pretranslate_entries(m68k_context * context, uint32_t *entries, uint32_t num_entries);
 void start_68k_context(m68k_context * context, uint32_t address);
 void resume_68k(m68k_context *context);
 void init_m68k_opts(m68k_options * opts, memmap_chunk * memmap, uint32_t num_chunks, uint32_t clock_divider);
 m68k_context * init_68k_context(m68k_options * opts, m68k_reset_handler reset_handler);
 void m68k_reset(m68k_context * context);
 void m68k_options_free(m68k_options *opts);
+void m68k_discard_translations(m68k_options *opts);
+void m68k_remap(m68k_options *opts, memmap_chunk const *memmap, uint32_t num_chunks);
+void m68k_log_enable(m68k_options *opts);
 void insert_breakpoint(m68k_context * context, uint32_t address, m68k_debug_handler bp_handler);
 void remove_breakpoint(m68k_context * context, uint32_t address);
+uint8_t m68k_breakpoint_condition(m68k_context *context, uint32_t address, m68k_bp_condition *cond);
+void m68k_add_watchpoint(m68k_context *context, uint32_t start, uint32_t end, uint8_t type, m68k_debug_handler handler);
+uint8_t m68k_remove_watchpoint(m68k_context *context, uint32_t start, uint32_t end, uint8_t type);
+void m68k_watch_dispatch(m68k_context *context, uint32_t pc);
 m68k_context * m68k_handle_code_write(uint32_t address, m68k_context * context);
 uint32_t get_instruction_start(m68k_options *opts, uint32_t address);
 uint16_t m68k_get_ir(m68k_context *context);
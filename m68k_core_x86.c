@@ -2559,10 +2559,80 @@ void m68k_breakpoint_patch(m68k_context *context, uint32_t address, m68k_debug_h
 	native.last = native.cur + 128;
 	native.stack_off = 0;
 	code_ptr start_native = native.cur;
+	code_ptr stub = opts->bp_stub;
+	for (uint32_t i = 0; i < context->num_breakpoints; i++)
+	{
+		if (context->breakpoints[i].address == address && context->breakpoints[i].cond_stub) {
+			stub = context->breakpoints[i].cond_stub;
+			break;
+		}
+	}
 	mov_ir(&native, address, opts->gen.scratch1, SZ_D);
 	
 	
-	call(&native, opts->bp_stub);
+	call(&native, stub);
+}
+
+void m68k_run_head(m68k_options *opts, m68k_run *run)
+{
+	code_info *code = &opts->gen.code;
+	check_cycles_int(&opts->gen, run->address);
+	run->ahead = check_cycles_ahead(&opts->gen, &run->fast_off);
+	//the limit falls somewhere inside the run, so run a copy that checks before every instruction
+	mov_ir(code, run->address, opts->gen.scratch1, SZ_D);
+	call(code, opts->checked_run);
+	jmp_r(code, opts->gen.scratch1);
+	*run->fast_off = code->cur - (run->fast_off + 1);
+}
+
+void m68k_run_force_checked(m68k_run *run)
+{
+	*run->fast_off = 0;
+}
+
+static void m68k_trace_counter(m68k_options *opts, code_info *code, m68k_trace *trace)
+{
+	mov_ir(code, (intptr_t)&trace->count, opts->gen.scratch1, SZ_PTR);
+	sub_irdisp(code, 1, opts->gen.scratch1, 0, SZ_D);
+	code_ptr cold = code->cur + 1;
+	jcc(code, CC_NZ, code->cur + 2);
+	mov_ir(code, trace->address, opts->gen.scratch1, SZ_D);
+	call(code, opts->hot_trace);
+	jmp_r(code, opts->gen.scratch1);
+	*cold = code->cur - (cold + 1);
+}
+
+void m68k_trace_head(m68k_options *opts, m68k_trace *trace)
+{
+	code_info *code = &opts->gen.code;
+	check_cycles_int(&opts->gen, trace->address);
+	check_alloc_code(code, MAX_INST_LEN*6);
+	trace->patch = code->cur;
+	m68k_trace_counter(opts, code, trace);
+}
+
+void m68k_trace_reset(m68k_options *opts, m68k_trace *trace)
+{
+	code_info tmp = {trace->patch, trace->patch + MAX_INST_LEN*6, 0};
+	m68k_trace_counter(opts, &tmp, trace);
+}
+
+void m68k_trace_link(m68k_trace *trace)
+{
+	code_info tmp = {trace->patch, trace->patch + MAX_INST_LEN*6, 0};
+	jmp(&tmp, trace->native);
+}
+
+void m68k_trace_return(m68k_options *opts, uint32_t address)
+{
+	code_info *code = &opts->gen.code;
+	check_alloc_code(code, MAX_INST_LEN*4);
+	cmp_ir(code, address, opts->gen.scratch1, SZ_D);
+	code_ptr match = code->cur + 1;
+	jcc(code, CC_Z, code->cur + 2);
+	call(code, opts->native_addr);
+	jmp_r(code, opts->gen.scratch1);
+	*match = code->cur - (match + 1);
 }
 
 void init_m68k_opts(m68k_options * opts, memmap_chunk * memmap, uint32_t num_chunks, uint32_t clock_divider)
@@ -2690,6 +2760,24 @@ void init_m68k_opts(m68k_options * opts, memmap_chunk * memmap, uint32_t num_chu
 	call(code, opts->gen.load_context);
 	retn(code);
 
+	opts->checked_run = code->cur;
+	call(code, opts->gen.save_context);
+	push_r(code, opts->gen.context_reg);
+	call_args(code, (code_ptr)m68k_checked_run, 2, opts->gen.context_reg, opts->gen.scratch1);
+	mov_rr(code, RAX, opts->gen.scratch1, SZ_PTR);
+	pop_r(code, opts->gen.context_reg);
+	call(code, opts->gen.load_context);
+	retn(code);
+
+	opts->hot_trace = code->cur;
+	call(code, opts->gen.save_context);
+	push_r(code, opts->gen.context_reg);
+	call_args(code, (code_ptr)m68k_hot_trace, 2, opts->gen.context_reg, opts->gen.scratch1);
+	mov_rr(code, RAX, opts->gen.scratch1, SZ_PTR);
+	pop_r(code, opts->gen.context_reg);
+	call(code, opts->gen.load_context);
+	retn(code);
+
 	opts->native_addr_and_sync = code->cur;
 	call(code, opts->gen.save_context);
 	push_r(code, opts->gen.scratch1);
@@ -3213,6 +3301,8 @@ void init_m68k_opts(m68k_options * opts, memmap_chunk * memmap, uint32_t num_chu
 	//Restore context
 	call(code, opts->gen.load_context);
 	pop_r(code, opts->gen.scratch1);
+	//conditional breakpoint stubs jump here when their condition is false
+	opts->bp_skip = code->cur;
 	//do prologue stuff
 	cmp_rr(code, opts->gen.cycles, opts->gen.limit, SZ_D);
 	code_ptr jmp_off = code->cur + 1;
@@ -3227,3 +3317,328 @@ void init_m68k_opts(m68k_options * opts, memmap_chunk * memmap, uint32_t num_chu
 	
 	retranslate_calc(&opts->gen);
 }
+
+//Handler that unwatched accesses end up in, writes pass through the log wrappers when memory logging is on
+static code_ptr mem_target(m68k_options *opts, int i)
+{
+	return opts->log_wrappers[i] ? opts->log_wrappers[i] : opts->mem_impl[i];
+}
+
+//Points each memory access entry point at the watch wrapper while watchpoints are active and at
+//the handler for the current memory map otherwise. The original bytes are restored once neither exists
+void m68k_patch_mem_entries(m68k_options *opts)
+{
+	code_ptr entries[] = {opts->read_16, opts->read_8, opts->write_16, opts->write_8};
+	uint8_t patched = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		code_ptr target = opts->watch_enabled ? opts->watch_wrappers[i] : mem_target(opts, i);
+		if (!opts->entries_patched) {
+			memcpy(opts->entry_saved[i], entries[i], sizeof(opts->entry_saved[i]));
+		}
+		if (target) {
+			code_info patch = {entries[i], entries[i] + sizeof(opts->entry_saved[i])};
+			jmp(&patch, target);
+			patched = 1;
+		} else {
+			memcpy(entries[i], opts->entry_saved[i], sizeof(opts->entry_saved[i]));
+		}
+	}
+	opts->entries_patched = patched;
+}
+
+static void gen_watch_wrapper(m68k_options *opts, int i, ftype type)
+{
+	code_info *code = &opts->gen.code;
+	code_ptr impl = mem_target(opts, i);
+	uint8_t is_write = type == WRITE_16 || type == WRITE_8;
+	uint8_t adr_reg = is_write ? opts->gen.scratch2 : opts->gen.scratch1;
+	uint8_t access_reg = is_write ? opts->gen.scratch1 : opts->gen.scratch2;
+	uint32_t access = is_write ? M68K_WATCH_WRITE : M68K_WATCH_READ;
+	if (type == READ_16 || type == WRITE_16) {
+		access |= M68K_WATCH_WORD;
+	}
+	check_code_prologue(code);
+	opts->watch_wrappers[i] = code->cur;
+	push_r(code, adr_reg);
+	and_ir(code, opts->gen.address_mask, adr_reg, SZ_D);
+	shr_ir(code, M68K_WATCH_PAGE_SHIFT, adr_reg, SZ_D);
+	bt_rrdisp(code, adr_reg, opts->gen.context_reg, offsetof(m68k_context, watch_pages), SZ_D);
+	pop_r(code, adr_reg);
+	jcc(code, CC_NC, impl);
+	//watched page, check the exact ranges
+	push_r(code, opts->gen.scratch1);
+	push_r(code, opts->gen.scratch2);
+	call(code, opts->gen.save_context);
+	mov_ir(code, access, access_reg, SZ_D);
+	call_args_abi(code, (code_ptr)m68k_watch_hit, 3, opts->gen.context_reg, adr_reg, access_reg);
+	mov_rr(code, RAX, opts->gen.context_reg, SZ_PTR);
+	call(code, opts->gen.load_context);
+	pop_r(code, opts->gen.scratch2);
+	pop_r(code, opts->gen.scratch1);
+	jmp(code, impl);
+}
+
+static void gen_log_wrapper(m68k_options *opts, int i, ftype type)
+{
+	code_info *code = &opts->gen.code;
+	check_code_prologue(code);
+	opts->log_wrappers[i] = code->cur;
+	push_r(code, opts->gen.scratch1);
+	push_r(code, opts->gen.scratch2);
+	call(code, opts->gen.save_context);
+	code_ptr log_fun = type == WRITE_16 ? (code_ptr)m68k_log_write_16 : (code_ptr)m68k_log_write_8;
+	call_args_abi(code, log_fun, 3, opts->gen.context_reg, opts->gen.scratch2, opts->gen.scratch1);
+	mov_rr(code, RAX, opts->gen.context_reg, SZ_PTR);
+	call(code, opts->gen.load_context);
+	pop_r(code, opts->gen.scratch2);
+	pop_r(code, opts->gen.scratch1);
+	jmp(code, opts->mem_impl[i]);
+}
+
+//Rebuilds the log and watch wrappers in front of the current handlers and repoints the entry points
+static void gen_mem_chain(m68k_options *opts)
+{
+	ftype types[] = {READ_16, READ_8, WRITE_16, WRITE_8};
+	for (int i = 0; i < 4; i++)
+	{
+		if (!opts->mem_impl[i]) {
+			opts->mem_impl[i] = gen_mem_fun(&opts->gen, opts->gen.memmap, opts->gen.memmap_chunks, types[i], NULL);
+		}
+		opts->log_wrappers[i] = NULL;
+		if ((opts->gen.flags & M68K_OPT_LOG_MEM) && (types[i] == WRITE_16 || types[i] == WRITE_8)) {
+			gen_log_wrapper(opts, i, types[i]);
+		}
+		opts->watch_wrappers[i] = NULL;
+		if (opts->watch_enabled) {
+			gen_watch_wrapper(opts, i, types[i]);
+		}
+	}
+	m68k_patch_mem_entries(opts);
+}
+
+//Points the memory access stubs at a new memory map without regenerating the rest of the runtime.
+//New handlers are emitted at the current code position and the original entry points are patched
+//to jump to them so that code which already calls those entry points does not need to change
+void m68k_remap(m68k_options *opts, memmap_chunk const *memmap, uint32_t num_chunks)
+{
+	opts->gen.memmap = memmap;
+	opts->gen.memmap_chunks = num_chunks;
+	memset(opts->mem_impl, 0, sizeof(opts->mem_impl));
+	gen_mem_chain(opts);
+}
+
+//Generates the hooks for the events selected by M68K_OPT_LOG_REGS and M68K_OPT_LOG_MEM, opts->address_log must be open
+void m68k_log_enable(m68k_options *opts)
+{
+	code_info *code = &opts->gen.code;
+	if ((opts->gen.flags & M68K_OPT_LOG_REGS) && !opts->log_exec) {
+		check_code_prologue(code);
+		opts->log_exec = code->cur;
+		call(code, opts->gen.save_context);
+		call_args_abi(code, (code_ptr)m68k_log_exec, 2, opts->gen.context_reg, opts->gen.scratch1);
+		mov_rr(code, RAX, opts->gen.context_reg, SZ_PTR);
+		call(code, opts->gen.load_context);
+		retn(code);
+	}
+	if (opts->gen.flags & M68K_OPT_LOG_MEM) {
+		gen_mem_chain(opts);
+	}
+}
+
+void m68k_log_exec_call(m68k_options *opts, uint32_t address)
+{
+	mov_ir(&opts->gen.code, address, opts->gen.scratch1, SZ_D);
+	call(&opts->gen.code, opts->log_exec);
+}
+
+//Redirects the memory access entry points through a test of the watched page bitmap.
+//Accesses to unwatched pages only pay for the bit test and jump straight to a copy of the
+//normal handler. The wrappers are rebuilt by m68k_remap when the memory map changes
+void m68k_watch_enable(m68k_options *opts)
+{
+	if (opts->watch_enabled) {
+		return;
+	}
+	ftype types[] = {READ_16, READ_8, WRITE_16, WRITE_8};
+	for (int i = 0; i < 4; i++)
+	{
+		if (!opts->mem_impl[i]) {
+			opts->mem_impl[i] = gen_mem_fun(&opts->gen, opts->gen.memmap, opts->gen.memmap_chunks, types[i], NULL);
+		}
+		if (!opts->watch_wrappers[i]) {
+			gen_watch_wrapper(opts, i, types[i]);
+		}
+	}
+	opts->watch_enabled = 1;
+	m68k_patch_mem_entries(opts);
+}
+
+void m68k_watch_disable(m68k_options *opts)
+{
+	if (!opts->watch_enabled) {
+		return;
+	}
+	opts->watch_enabled = 0;
+	m68k_patch_mem_entries(opts);
+}
+
+//Loads a condition operand into reg. If the operand lives in a chunk whose pointer can be NULL,
+//*null_jump is set to the displacement of a jump that needs to go to the false path
+static uint8_t cond_operand_to_native(m68k_options *opts, m68k_cond_operand *op, m68k_bp_condition *cond, uint8_t reg, code_ptr *null_jump)
+{
+	code_info *code = &opts->gen.code;
+	*null_jump = NULL;
+	switch (op->kind)
+	{
+	case M68K_COND_DREG:
+		dreg_to_native(opts, op->value, reg);
+		break;
+	case M68K_COND_AREG:
+		areg_to_native(opts, op->value, reg);
+		break;
+	case M68K_COND_HITS:
+		mov_ir(code, (intptr_t)&cond->hits, reg, SZ_PTR);
+		mov_rdispr(code, reg, 0, reg, SZ_D);
+		return 1;
+	case M68K_COND_IMMED:
+		mov_ir(code, op->value, reg, SZ_D);
+		return 1;
+	case M68K_COND_MEM: {
+		//only memory that can be read without side effects is supported
+		uint32_t address = op->value & opts->gen.address_mask;
+		memmap_chunk const *chunk = find_map_chunk(address, &opts->gen, 0, NULL);
+		if (!chunk || !(chunk->flags & MMAP_READ) || (chunk->flags & (MMAP_ONLY_ODD|MMAP_ONLY_EVEN))
+			|| !(chunk->buffer || (chunk->flags & MMAP_PTR_IDX))
+			|| (op->size > 1 && (address & 1)) || address + op->size > chunk->end
+		) {
+			return 0;
+		}
+		int32_t offset = address & chunk->mask;
+		if (chunk->flags & MMAP_PTR_IDX) {
+			mov_rdispr(code, opts->gen.context_reg, opts->gen.mem_ptr_off + sizeof(void*) * chunk->ptr_index, reg, SZ_PTR);
+			if (chunk->flags & MMAP_FUNC_NULL) {
+				//the area is currently handled by the chunk's functions, which could have side effects,
+				//so the term is treated as false rather than calling them
+				cmp_ir(code, 0, reg, SZ_PTR);
+				*null_jump = code->cur + 2;
+				jcc(code, CC_Z, *null_jump + 512);//force 32-bit displacement
+			}
+		} else {
+			mov_ir(code, (intptr_t)chunk->buffer, reg, SZ_PTR);
+		}
+		if (op->size == 1) {
+			movzx_rdispr(code, reg, offset ^ 1, reg, SZ_B, SZ_D);
+		} else if (op->size == 2) {
+			movzx_rdispr(code, reg, offset, reg, SZ_W, SZ_D);
+		} else {
+			//words are stored in host order so swap the halves of the long
+			mov_rdispr(code, reg, offset, reg, SZ_D);
+			rol_ir(code, 16, reg, SZ_D);
+		}
+		return 1;
+	}
+	default:
+		return 0;
+	}
+	if (op->size == 1) {
+		and_ir(code, 0xFF, reg, SZ_D);
+	} else if (op->size == 2) {
+		and_ir(code, 0xFFFF, reg, SZ_D);
+	}
+	return 1;
+}
+
+//Upper bound on the size of the stub for cond
+uint32_t m68k_bp_condition_size(m68k_bp_condition *cond)
+{
+	return 32 + 96 * cond->num_terms;
+}
+
+//Emits a stub that breakpoint sites call in place of bp_stub. It bumps the hit counter and
+//evaluates the condition inline, only going through bp_stub to the debug handler when the
+//condition holds. Otherwise it jumps back into the instruction like bp_stub does after the
+//handler returns. The stub is written to space when it is non-NULL, otherwise size bytes are
+//reserved in the code buffer so the stub can be overwritten in place later.
+//Returns NULL, leaving space untouched, if the condition uses an operand that can't be compiled
+code_ptr m68k_bp_condition_stub(m68k_options *opts, m68k_bp_condition *cond, code_ptr space, uint32_t size)
+{
+	code_info *code = &opts->gen.code;
+	code_info start_code = *code;
+	uint32_t tmp_stack_off = code->stack_off;
+	uint8_t *backup = NULL;
+	if (space) {
+		backup = malloc(size);
+		memcpy(backup, space, size);
+		code->cur = space;
+		code->last = space + size;
+	} else {
+		check_alloc_code(code, size);
+	}
+	code_ptr stub = code->cur;
+	//each term has a jump for the comparison and possibly one for each operand's NULL check
+	code_ptr *false_jumps = calloc(cond->num_terms * 3, sizeof(code_ptr));
+	uint32_t num_false = 0;
+	code_ptr null_jump;
+	//scratch1 holds the breakpoint address which bp_stub and bp_skip both need
+	push_r(code, opts->gen.scratch1);
+	mov_ir(code, (intptr_t)&cond->hits, opts->gen.scratch2, SZ_PTR);
+	add_irdisp(code, 1, opts->gen.scratch2, 0, SZ_D);
+	static const uint8_t false_cc[] = {
+		[M68K_COND_EQ] = CC_NZ,
+		[M68K_COND_NE] = CC_Z,
+		[M68K_COND_LT] = CC_NC,
+		[M68K_COND_LE] = CC_A,
+		[M68K_COND_GT] = CC_BE,
+		[M68K_COND_GE] = CC_C
+	};
+	for (uint32_t i = 0; i < cond->num_terms; i++)
+	{
+		m68k_cond_term *term = cond->terms + i;
+		if (!cond_operand_to_native(opts, &term->left, cond, opts->gen.scratch1, &null_jump)) {
+			free(false_jumps);
+			*code = start_code;
+			if (space) {
+				memcpy(space, backup, size);
+				free(backup);
+			}
+			return NULL;
+		}
+		if (null_jump) {
+			false_jumps[num_false++] = null_jump;
+		}
+		if (term->right.kind == M68K_COND_IMMED) {
+			cmp_ir(code, term->right.value, opts->gen.scratch1, SZ_D);
+		} else {
+			if (!cond_operand_to_native(opts, &term->right, cond, opts->gen.scratch2, &null_jump)) {
+				free(false_jumps);
+				*code = start_code;
+				return NULL;
+			}
+			if (null_jump) {
+				false_jumps[num_false++] = null_jump;
+			}
+			cmp_rr(code, opts->gen.scratch2, opts->gen.scratch1, SZ_D);
+		}
+		false_jumps[num_false] = code->cur + 2;
+		jcc(code, false_cc[term->op], false_jumps[num_false++] + 512);//force 32-bit displacement
+	}
+	pop_r(code, opts->gen.scratch1);
+	jmp(code, opts->bp_stub);
+	for (uint32_t i = 0; i < num_false; i++)
+	{
+		*((uint32_t *)false_jumps[i]) = code->cur - (false_jumps[i] + 4);
+	}
+	free(false_jumps);
+	code->stack_off = tmp_stack_off + sizeof(void *);
+	pop_r(code, opts->gen.scratch1);
+	jmp(code, opts->bp_skip);
+	code->stack_off = tmp_stack_off;
+	if (space) {
+		free(backup);
+		*code = start_code;
+	} else {
+		code->cur = stub + size;
+	}
+	return stub;
+}
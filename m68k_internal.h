@@ -38,6 +38,21 @@ void m68k_trap_if_not_supervisor(m68k_options *opts, m68kinst *inst);
 void m68k_breakpoint_patch(m68k_context *context, uint32_t address, m68k_debug_handler bp_handler, code_ptr native_addr);
 void m68k_check_cycles_int_latch(m68k_options *opts);
 uint8_t translate_m68k_op(m68kinst * inst, host_ea * ea, m68k_options * opts, uint8_t dst);
+void m68k_run_head(m68k_options *opts, m68k_run *run);
+void m68k_run_force_checked(m68k_run *run);
+void m68k_trace_head(m68k_options *opts, m68k_trace *trace);
+void m68k_trace_reset(m68k_options *opts, m68k_trace *trace);
+void m68k_trace_link(m68k_trace *trace);
+void m68k_trace_return(m68k_options *opts, uint32_t address);
+void m68k_watch_enable(m68k_options *opts);
+void m68k_watch_disable(m68k_options *opts);
+void m68k_patch_mem_entries(m68k_options *opts);
+void m68k_log_exec_call(m68k_options *opts, uint32_t address);
+m68k_context *m68k_log_exec(m68k_context *context, uint32_t pc);
+m68k_context *m68k_log_write_16(m68k_context *context, uint32_t address, uint32_t value);
+m68k_context *m68k_log_write_8(m68k_context *context, uint32_t address, uint32_t value);
+uint32_t m68k_bp_condition_size(m68k_bp_condition *cond);
+code_ptr m68k_bp_condition_stub(m68k_options *opts, m68k_bp_condition *cond, code_ptr space, uint32_t size);
 
 //functions implemented in m68k_core.c
 int8_t native_reg(m68k_op_info * op, m68k_options * opts);
@@ -52,8 +67,34 @@ void swap_ssp_usp(m68k_options * opts);
 code_ptr get_native_address(m68k_options *opts, uint32_t address);
 uint8_t m68k_is_terminal(m68kinst * inst);
 code_ptr get_native_address_trans(m68k_context * context, uint32_t address);
+m68k_context *m68k_watch_hit(m68k_context *context, uint32_t address, uint32_t access);
 void * m68k_retranslate_inst(uint32_t address, m68k_context * context);
 m68k_context *m68k_bp_dispatcher(m68k_context *context, uint32_t address);
+code_ptr m68k_checked_run(m68k_context *context, uint32_t address);
+code_ptr m68k_hot_trace(m68k_context *context, uint32_t address);
+
+//a straight-line run of instructions that share a single cycle limit check
+struct m68k_run {
+	m68k_run *next;
+	code_ptr checked;   //copy of the run with a check before each instruction, translated on demand
+	code_ptr fast_off;  //offset of the jump that skips the slow path
+	uint8_t  *ahead;    //cycle count covered by the check
+	uint32_t address;
+	uint32_t end;
+};
+
+#define M68K_TRACE_MAX_INSTS 64
+
+//a frequently entered block retranslated as a superblock that follows direct branches and calls
+struct m68k_trace {
+	m68k_trace *next;
+	code_ptr   patch;   //entry counter, replaced with a jump to the superblock once it's built
+	code_ptr   native;  //superblock code, NULL until the entry gets hot
+	uint32_t   address;
+	uint32_t   count;   //entries left before the superblock is built
+	uint32_t   num_insts;
+	uint32_t   insts[M68K_TRACE_MAX_INSTS];
+};
 
 //individual instructions
 void translate_m68k_bcc(m68k_options * opts, m68kinst * inst);
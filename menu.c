@@ -8,6 +8,7 @@
 #include "backend.h"
 #include "util.h"
 #include "gst.h"
+#include "rom_library.h"
 #include "m68k_internal.h" //needed for get_native_address_trans, should be eliminated once handling of PC is cleaned up
 
 static menu_context *persist_path_menu;
@@ -198,6 +199,42 @@ cleanup:
 #include <windows.h>
 #endif
 
+static void clear_files(menu_context *menu)
+{
+	for (uint32_t i = 0; i < menu->num_files; i++)
+	{
+		free(menu->files[i].name);
+	}
+	free(menu->files);
+	menu->files = NULL;
+	menu->num_files = 0;
+}
+
+//Returns the title of a ROM from the ROM library if it has been indexed, NULL otherwise
+static char *get_title(char *dir, char *name)
+{
+	char const *pieces[] = {dir, PATH_SEP, name};
+	char *path = alloc_concat_m(3, pieces);
+	char *title = rom_library_title(path);
+	free(path);
+	return title;
+}
+
+typedef struct {
+	char    *shown; //title or file name
+	char    *name;
+	uint8_t is_dir;
+} listing_entry;
+
+static int listing_sort(const void *a, const void *b)
+{
+	const listing_entry *la = a, *lb = b;
+	if (la->is_dir != lb->is_dir) {
+		return lb->is_dir - la->is_dir;
+	}
+	return strcasecmp(la->shown, lb->shown);
+}
+
 uint32_t copy_dir_entry_to_guest(uint32_t dst, m68k_context *m68k, char *name, uint8_t is_dir)
 {
 	uint8_t *dest = get_native_pointer(dst, (void **)m68k->mem_pointers, &m68k->options->gen);
@@ -246,6 +283,7 @@ void * menu_write_w(uint32_t address, void * context, uint16_t value)
 		switch (address >> 2)
 		{
 		case 0: {
+			clear_files(menu);
 #ifdef _WIN32
 			//handle virtual "drives" directory
 			if (menu->curpath[0] == PATH_SEP[0]) {
@@ -294,7 +332,11 @@ void * menu_write_w(uint32_t address, void * context, uint16_t value)
 				ext_list[num_exts++] = cur_filter;
 				cur_filter = split_keyval(cur_filter);
 			}
-			for (size_t i = 0; dst && i < num_entries; i++)
+			listing_entry *listing = malloc(sizeof(listing_entry) * num_entries);
+			uint32_t num_listed = 0;
+			tern_node *shown_titles = NULL;
+			uint8_t show_titles = !strcmp("on", tern_find_path_default(config, "ui\0rom_titles\0", (tern_val){.ptrval = "on"}, TVAL_PTR).ptrval);
+			for (size_t i = 0; i < num_entries; i++)
 			{
 				if (num_exts && !entries[i].is_dir) {
 					char *ext = path_extension(entries[i].name);
@@ -312,10 +354,45 @@ void * menu_write_w(uint32_t address, void * context, uint16_t value)
 						continue;
 					}
 				}
-				dst = copy_dir_entry_to_guest(dst,  m68k, entries[i].name, entries[i].is_dir);
+				char *title = show_titles && !entries[i].is_dir ? get_title(menu->curpath, entries[i].name) : NULL;
+				if (title && tern_find_ptr(shown_titles, title)) {
+					//two files share a title, the second one is listed by file name
+					free(title);
+					title = NULL;
+				}
+				if (title) {
+					shown_titles = tern_insert_ptr(shown_titles, title, title);
+				}
+				listing[num_listed++] = (listing_entry){
+					.shown = title ? title : entries[i].name,
+					.name = entries[i].name,
+					.is_dir = entries[i].is_dir
+				};
 			}
+			tern_free(shown_titles);
 			free(ext_filter);
 			free(ext_list);
+			if (show_titles) {
+				//titles don't sort the same as the file names they replace
+				qsort(listing, num_listed, sizeof(listing_entry), listing_sort);
+			}
+			menu->files = malloc(sizeof(menu_file) * num_listed);
+			for (uint32_t i = 0; i < num_listed; i++)
+			{
+				if (dst) {
+					if (!listing[i].is_dir) {
+						menu->files[menu->num_files++] = (menu_file){
+							.name = strdup(listing[i].name),
+							.address = dst + 2
+						};
+					}
+					dst = copy_dir_entry_to_guest(dst, m68k, listing[i].shown, listing[i].is_dir);
+				}
+				if (listing[i].shown != listing[i].name) {
+					free(listing[i].shown);
+				}
+			}
+			free(listing);
 			//terminate list
 			uint8_t *dest = get_native_pointer(dst, (void **)m68k->mem_pointers, &m68k->options->gen);
 			if (dest) {
@@ -368,10 +445,22 @@ void * menu_write_w(uint32_t address, void * context, uint16_t value)
 		case 2:
 		case 8: {
 			char buf[4096];
-			copy_string_from_guest(m68k, dst, buf, sizeof(buf));
-			char const *pieces[] = {menu->curpath, PATH_SEP, buf};
+			char *fname = NULL;
+			for (uint32_t i = 0; i < menu->num_files; i++)
+			{
+				if (menu->files[i].address == dst) {
+					fname = menu->files[i].name;
+					break;
+				}
+			}
+			if (!fname) {
+				copy_string_from_guest(m68k, dst, buf, sizeof(buf));
+				fname = buf;
+			}
+			char const *pieces[] = {menu->curpath, PATH_SEP, fname};
 			char *selected = alloc_concat_m(3, pieces);
 			if ((address >> 2) == 2) {
+				rom_library_prepare_launch(selected);
 				gen->header.next_rom = selected;
 				m68k->should_return = 1;
 			} else {
@@ -5,11 +5,20 @@
 */
 #ifndef MENU_H_
 #define MENU_H_
+#include "tern.h"
+
+typedef struct {
+	char     *name;
+	uint32_t address; //guest address of the name shown for this file in the listing
+} menu_file;
+
 typedef struct {
-	char     *curpath;
-	uint16_t latch;
-	uint16_t state;
-	uint8_t  external_game_load;
+	char      *curpath;
+	menu_file *files; //files in the current listing, the menu ROM identifies a selection by the address of its name
+	uint32_t  num_files;
+	uint16_t  latch;
+	uint16_t  state;
+	uint8_t   external_game_load;
 } menu_context;
 
 
@@ -18,8 +18,25 @@ void psg_init(psg_context * context, uint32_t sample_rate, uint32_t master_clock
 	context->clock_inc = clock_div;
 	context->sample_rate = sample_rate;
 	context->samples_frame = samples_frame;
+	psg_reinit(context, master_clock, lowpass_cutoff);
+}
+
+//Returns the chip to its power on state without reallocating its buffers
+void psg_reinit(psg_context *context, uint32_t master_clock, uint32_t lowpass_cutoff)
+{
+	int16_t *audio_buffer = context->audio_buffer;
+	int16_t *back_buffer = context->back_buffer;
+	uint32_t clock_inc = context->clock_inc;
+	uint32_t sample_rate = context->sample_rate;
+	uint32_t samples_frame = context->samples_frame;
+	memset(context, 0, sizeof(*context));
+	context->audio_buffer = audio_buffer;
+	context->back_buffer = back_buffer;
+	context->clock_inc = clock_inc;
+	context->sample_rate = sample_rate;
+	context->samples_frame = samples_frame;
 	double rc = (1.0 / (double)lowpass_cutoff) / (2.0 * M_PI);
-	double dt = 1.0 / ((double)master_clock / (double)clock_div);
+	double dt = 1.0 / ((double)master_clock / (double)clock_inc);
 	double alpha = dt / (dt + rc);
 	context->lowpass_alpha = (int32_t)(((double)0x10000) * alpha);
 	psg_adjust_master_clock(context, master_clock);
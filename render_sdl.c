@@ -14,6 +14,10 @@
 #include "util.h"
 #include "ppm.h"
 
+#ifdef RENDER_RGB565
+#error "RENDER_RGB565 is only supported by the libretro renderer"
+#endif
+
 #ifndef DISABLE_OPENGL
 #include <GL/glew.h>
 #endif
@@ -545,7 +549,7 @@ void render_save_screenshot(char *path)
 
 uint32_t *locked_pixels;
 uint32_t locked_pitch;
-uint32_t *render_get_framebuffer(uint8_t which, int *pitch)
+pixel_t *render_get_framebuffer(uint8_t which, int *pitch)
 {
 #ifndef DISABLE_OPENGL
 	if (render_gl && which <= FRAMEBUFFER_EVEN) {
@@ -0,0 +1,321 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <SDL.h>
+#include "rom_library.h"
+#include "romdb.h"
+#include "util.h"
+#include "hash.h"
+#include "blastem.h"
+
+#define MAX_SCAN_THREADS 4
+#define SMD_HEADER_SIZE 512
+#define SMD_BLOCK_SIZE 0x4000
+//files larger than this can't be Genesis ROMs and aren't worth reading in full
+#define MAX_ROM_FILE (16*1024*1024)
+
+typedef struct scan_job scan_job;
+struct scan_job {
+	scan_job *next;
+	char     *path;
+};
+
+//library, pending, the job queue and the dirty flag are shared with the scan threads and protected by lock
+static SDL_mutex  *lock;
+static SDL_cond   *work_ready;
+static tern_node  *library;
+static tern_node  *pending;
+static tern_node  *rom_db;
+static scan_job   *queue_head;
+static scan_job   **queue_tail = &queue_head;
+static char       *index_path;
+static uint32_t   busy;
+static uint8_t    dirty;
+
+static void save_index(void);
+
+static char *get_index_path(void)
+{
+	char *template = tern_find_path_default(config, "ui\0library_index\0", (tern_val){.ptrval = "$USERDATA/blastem/rom_library"}, TVAL_PTR).ptrval;
+	tern_node *vars = tern_insert_ptr(NULL, "HOME", get_home_dir());
+	vars = tern_insert_ptr(vars, "EXEDIR", get_exe_dir());
+	vars = tern_insert_ptr(vars, "USERDATA", (char *)get_userdata_dir());
+	char *path = replace_vars(template, vars, 1);
+	tern_free(vars);
+	return path;
+}
+
+//one entry per line: SHA-1, file size, mtime, regions, in ROM DB flag, path and title separated by tabs
+static void load_index(void)
+{
+	FILE *f = fopen(index_path, "rb");
+	if (!f) {
+		return;
+	}
+	long size = file_size(f);
+	char *data = malloc(size + 1);
+	if (fread(data, 1, size, f) != size) {
+		warning("Failed to read ROM library index %s\n", index_path);
+		size = 0;
+	}
+	fclose(f);
+	data[size] = 0;
+	char *line = data;
+	while (*line)
+	{
+		char *end = strchr(line, '\n');
+		if (end) {
+			*end = 0;
+		}
+		char *fields[7];
+		uint32_t num_fields = 0;
+		for (char *cur = line; num_fields < 7;)
+		{
+			fields[num_fields++] = cur;
+			cur = strchr(cur, '\t');
+			if (!cur) {
+				break;
+			}
+			*(cur++) = 0;
+		}
+		if (num_fields == 7 && strlen(fields[0]) == 40) {
+			rom_library_entry *entry = malloc(sizeof(rom_library_entry));
+			for (int i = 0; i < 20; i++)
+			{
+				char byte[3] = {fields[0][i*2], fields[0][i*2+1], 0};
+				entry->hash[i] = strtol(byte, NULL, 16);
+			}
+			entry->file_size = strtoul(fields[1], NULL, 10);
+			entry->mtime = strtoll(fields[2], NULL, 10);
+			entry->regions = atoi(fields[3]);
+			entry->in_db = atoi(fields[4]);
+			entry->name = strdup(fields[6]);
+			library = tern_insert_ptr(library, fields[5], entry);
+		}
+		if (!end) {
+			break;
+		}
+		line = end + 1;
+	}
+	free(data);
+}
+
+static void write_entry(char *key, tern_val val, uint8_t valtype, void *data)
+{
+	rom_library_entry *entry = val.ptrval;
+	if (strpbrk(key, "\t\n") || strpbrk(entry->name, "\t\n")) {
+		return;
+	}
+	uint8_t hex_hash[41];
+	bin_to_hex(hex_hash, entry->hash, sizeof(entry->hash));
+	fprintf(data, "%s\t%u\t%lld\t%d\t%d\t%s\t%s\n", hex_hash, entry->file_size, (long long)entry->mtime, entry->regions, entry->in_db, key, entry->name);
+}
+
+//must be called with lock held
+static void save_index(void)
+{
+	if (!dirty) {
+		return;
+	}
+	char *dir = path_dirname(index_path);
+	if (dir) {
+		ensure_dir_exists(dir);
+		free(dir);
+	}
+	FILE *f = fopen(index_path, "wb");
+	if (!f) {
+		warning("Failed to open ROM library index %s for writing\n", index_path);
+		return;
+	}
+	tern_foreach(library, write_entry, f);
+	fclose(f);
+	dirty = 0;
+}
+
+static void save_index_at_exit(void)
+{
+	SDL_LockMutex(lock);
+	save_index();
+	SDL_UnlockMutex(lock);
+}
+
+//reads a ROM the same way load_rom does, deinterleaving SMD images
+static uint8_t *read_rom_file(char *path, uint32_t *size_out)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		return NULL;
+	}
+	long filesize = file_size(f);
+	if (filesize < 0x200 || filesize > MAX_ROM_FILE) {
+		fclose(f);
+		return NULL;
+	}
+	uint8_t *data = malloc(filesize);
+	if (fread(data, 1, filesize, f) != filesize) {
+		free(data);
+		fclose(f);
+		return NULL;
+	}
+	fclose(f);
+	if (data[1] == 0x03 && data[8] == 0xAA && data[9] == 0xBB && !data[2]
+		&& !data[3] && !data[4] && !data[5] && !data[6] && !data[7]
+	) {
+		uint32_t rom_size = filesize - SMD_HEADER_SIZE;
+		uint8_t *rom = calloc(1, rom_size);
+		for (uint32_t offset = 0; offset + SMD_BLOCK_SIZE <= rom_size; offset += SMD_BLOCK_SIZE)
+		{
+			uint8_t *block = data + SMD_HEADER_SIZE + offset;
+			for (uint32_t i = 0; i < SMD_BLOCK_SIZE/2; i++)
+			{
+				rom[offset + i*2] = block[SMD_BLOCK_SIZE/2 + i];
+				rom[offset + i*2 + 1] = block[i];
+			}
+		}
+		free(data);
+		*size_out = rom_size;
+		return rom;
+	}
+	*size_out = filesize;
+	return data;
+}
+
+static rom_library_entry *scan_rom(char *path)
+{
+	time_t mtime = get_modification_time(path);
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		return NULL;
+	}
+	long filesize = file_size(f);
+	fclose(f);
+	rom_library_entry *entry = calloc(1, sizeof(rom_library_entry));
+	entry->mtime = mtime;
+	entry->file_size = filesize;
+	uint32_t rom_size;
+	uint8_t *rom = read_rom_file(path, &rom_size);
+	//only Genesis images have a header and ROM DB entry worth indexing, other files are
+	//remembered with an empty title so they aren't read again every time they are listed
+	if (rom && rom_size >= 0x200 && !memcmp(rom + 0x100, "SEGA", 4)) {
+		sha1(rom, rom_size, entry->hash);
+		entry->name = rom_db_identify(rom_db, rom, entry->hash, &entry->regions, &entry->in_db);
+	} else {
+		entry->name = strdup("");
+	}
+	free(rom);
+	return entry;
+}
+
+static int scan_thread(void *data)
+{
+	SDL_LockMutex(lock);
+	for (;;)
+	{
+		while (!queue_head)
+		{
+			SDL_CondWait(work_ready, lock);
+		}
+		scan_job *job = queue_head;
+		queue_head = job->next;
+		if (!queue_head) {
+			queue_tail = &queue_head;
+		}
+		busy++;
+		SDL_UnlockMutex(lock);
+		
+		rom_library_entry *entry = scan_rom(job->path);
+		
+		SDL_LockMutex(lock);
+		busy--;
+		pending = tern_insert_int(pending, job->path, 0);
+		if (entry) {
+			rom_library_entry *old = tern_find_ptr(library, job->path);
+			if (old) {
+				free(old->name);
+				free(old);
+			}
+			library = tern_insert_ptr(library, job->path, entry);
+			dirty = 1;
+		}
+		free(job->path);
+		free(job);
+		if (!queue_head && !busy) {
+			//write the index as soon as a batch finishes so a crash doesn't lose the work
+			save_index();
+		}
+	}
+	return 0;
+}
+
+static void init_library(void)
+{
+	if (lock) {
+		return;
+	}
+	lock = SDL_CreateMutex();
+	work_ready = SDL_CreateCond();
+	index_path = get_index_path();
+	rom_db = load_rom_db();
+	load_index();
+	atexit(save_index_at_exit);
+	int num_threads = SDL_GetCPUCount();
+	if (num_threads > MAX_SCAN_THREADS) {
+		num_threads = MAX_SCAN_THREADS;
+	}
+	for (int i = 0; i < num_threads; i++)
+	{
+		SDL_Thread *thread = SDL_CreateThread(scan_thread, "ROM scan", NULL);
+		if (thread) {
+			SDL_DetachThread(thread);
+		} else {
+			warning("Failed to create ROM library scan thread: %s\n", SDL_GetError());
+		}
+	}
+}
+
+char *rom_library_title(char *path)
+{
+	init_library();
+	time_t mtime = get_modification_time(path);
+	char *title = NULL;
+	SDL_LockMutex(lock);
+	rom_library_entry *entry = tern_find_ptr(library, path);
+	if (entry && entry->mtime == mtime) {
+		title = *entry->name ? strdup(entry->name) : NULL;
+	} else if (!tern_find_int(pending, path, 0)) {
+		pending = tern_insert_int(pending, path, 1);
+		scan_job *job = malloc(sizeof(scan_job));
+		job->next = NULL;
+		job->path = strdup(path);
+		*queue_tail = job;
+		queue_tail = &job->next;
+		SDL_CondSignal(work_ready);
+	}
+	SDL_UnlockMutex(lock);
+	return title;
+}
+
+void rom_library_prepare_launch(char *path)
+{
+	if (!lock) {
+		return;
+	}
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		return;
+	}
+	uint8_t head[ROM_DB_HINT_HEAD];
+	long filesize = file_size(f);
+	size_t head_size = fread(head, 1, sizeof(head), f);
+	fclose(f);
+	time_t mtime = get_modification_time(path);
+	SDL_LockMutex(lock);
+	rom_library_entry *entry = tern_find_ptr(library, path);
+	//SMD images are deinterleaved on load so their first bytes can't be compared against the file
+	if (entry && *entry->name && entry->mtime == mtime && entry->file_size == filesize && (head_size == sizeof(head) || head_size == filesize)
+		&& !(head[1] == 0x03 && head[8] == 0xAA && head[9] == 0xBB)
+	) {
+		rom_db_hash_hint(filesize, head, entry->hash);
+	}
+	SDL_UnlockMutex(lock);
+}
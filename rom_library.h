@@ -0,0 +1,23 @@
+#ifndef ROM_LIBRARY_H_
+#define ROM_LIBRARY_H_
+
+#include <stdint.h>
+#include <time.h>
+
+typedef struct {
+	char     *name;      //title from the ROM DB or cartridge header, empty if the file is not a Genesis ROM
+	time_t   mtime;
+	uint32_t file_size;
+	uint8_t  hash[20];   //SHA-1 of the image as configure_rom sees it
+	uint8_t  regions;
+	uint8_t  in_db;
+} rom_library_entry;
+
+//Returns the title of the ROM at path in a newly allocated string, or NULL if it has not been indexed
+//since it was last modified. Files that are missing from the index or out of date are queued for scanning
+//on the worker pool so a later call can return their title
+char *rom_library_title(char *path);
+//Lets configure_rom reuse the indexed SHA-1 of path if the file has not changed since it was scanned
+void rom_library_prepare_launch(char *path);
+
+#endif //ROM_LIBRARY_H_
@@ -11,6 +11,7 @@
 #include "nor.h"
 #include "sega_mapper.h"
 #include "multi_game.h"
+#include "save_file.h"
 
 #define DOM_TITLE_START 0x120
 #define DOM_TITLE_END 0x150
@@ -37,26 +38,30 @@ char const *save_type_name(uint8_t save_type)
 extern char core_romdb[512];
 #endif
 
+static tern_node *rom_db;
+
 tern_node *load_rom_db()
 {
+	if (rom_db) {
+		return rom_db;
+	}
 #ifndef __LIBRETRO__
-	tern_node *db = parse_bundled_config("rom.db");
+	rom_db = parse_bundled_config("rom.db");
 #else
-	tern_node *db = parse_bundled_config(core_romdb);
-	db=parse_config_file(core_romdb);
-	if (!db)db = tern_insert_int(NULL, "zero", 0);
+	rom_db = parse_config_file(core_romdb);
+	if (!rom_db)rom_db = tern_insert_int(NULL, "zero", 0);
 #endif
-	if (!db) {
+	if (!rom_db) {
 		fatal_error("Failed to load ROM DB\n");
 	}
-	return db;
+	return rom_db;
 }
 
 void free_rom_info(rom_info *info)
 {
 	free(info->name);
 	if (info->save_type != SAVE_NONE) {
-		free(info->save_buffer);
+		free_save_buffer(info->save_buffer, info->save_size);
 		if (info->save_type == SAVE_I2C) {
 			free(info->eeprom_map);
 		}
@@ -247,7 +252,7 @@ uint32_t read_ram_header(rom_info *info, uint8_t *rom)
 		save_size /= 2;
 	}
 	info->save_size = save_size;
-	info->save_buffer = malloc(save_size);
+	info->save_buffer = alloc_save_buffer(save_size, 0);
 	return ram_start;
 }
 
@@ -454,8 +459,7 @@ void process_sram_def(char *key, map_iter_state *state)
 			fatal_error("SRAM size %s is invalid\n", size);
 		}
 		state->info->save_mask = nearest_pow2(state->info->save_size)-1;
-		state->info->save_buffer = malloc(state->info->save_size);
-		memset(state->info->save_buffer, 0, state->info->save_size);
+		state->info->save_buffer = alloc_save_buffer(state->info->save_size, 0);
 		char *bus = tern_find_path(state->root, "SRAM\0bus\0", TVAL_PTR).ptrval;
 		if (!strcmp(bus, "odd")) {
 			state->info->save_type = RAM_FLAG_ODD;
@@ -487,8 +491,7 @@ void process_eeprom_def(char * key, map_iter_state *state)
 		} else {
 			fatal_error("EEPROM type %s is invalid\n", etype);
 		}
-		state->info->save_buffer = malloc(state->info->save_size);
-		memset(state->info->save_buffer, 0xFF, state->info->save_size);
+		state->info->save_buffer = alloc_save_buffer(state->info->save_size, 0xFF);
 		state->info->eeprom_map = malloc(sizeof(eeprom_map) * state->num_els);
 		memset(state->info->eeprom_map, 0, sizeof(eeprom_map) * state->num_els);
 	}
@@ -527,8 +530,7 @@ void process_nor_def(char *key, map_iter_state *state)
 			state->info->save_bus = RAM_FLAG_BOTH;
 		}
 		state->info->save_type = SAVE_NOR;
-		state->info->save_buffer = malloc(state->info->save_size);
-		memset(state->info->save_buffer, 0xFF, state->info->save_size);
+		state->info->save_buffer = alloc_save_buffer(state->info->save_size, 0xFF);
 	}
 }
 
@@ -765,8 +767,12 @@ void map_iter_fun(char *key, tern_val val, uint8_t valtype, void *data)
 		state->info->mapper_type = MAPPER_MULTI_GAME;
 		state->info->mapper_start_index = state->ptr_index++;
 		//make a mirror copy of the ROM so we can efficiently support arbitrary start offsets
-		state->rom = realloc(state->rom, state->rom_size * 2);
-		memcpy(state->rom + state->rom_size, state->rom, state->rom_size);
+		//the ROM image may be a file mapping so copy it rather than using realloc
+		uint8_t *mirror = malloc(state->rom_size * 2);
+		memcpy(mirror, state->rom, state->rom_size);
+		memcpy(mirror + state->rom_size, state->rom, state->rom_size);
+		release_file_buffer(state->rom);
+		state->rom = mirror;
 		state->rom_size *= 2;
 		//make room for an extra map entry
 		state->info->map_chunks+=1;
@@ -790,10 +796,8 @@ void map_iter_fun(char *key, tern_val val, uint8_t valtype, void *data)
 	state->index++;
 }
 
-rom_info configure_rom(tern_node *rom_db, void *vrom, uint32_t rom_size, void *lock_on, uint32_t lock_on_size, memmap_chunk const *base_map, uint32_t base_chunks)
+static void get_product_id(uint8_t *rom, uint8_t *product_id)
 {
-	uint8_t product_id[GAME_ID_LEN+1];
-	uint8_t *rom = vrom;
 	product_id[GAME_ID_LEN] = 0;
 	for (int i = 0; i < GAME_ID_LEN; i++)
 	{
@@ -804,27 +808,85 @@ rom_info configure_rom(tern_node *rom_db, void *vrom, uint32_t rom_size, void *l
 		product_id[i] = rom[GAME_ID_OFF + i];
 
 	}
-	printf("Product ID: %s\n", product_id);
-	uint8_t raw_hash[20];
-	sha1(vrom, rom_size, raw_hash);
+}
+
+static tern_node *find_rom_db_entry(tern_node *rom_db, uint8_t *product_id, uint8_t *raw_hash)
+{
 	uint8_t hex_hash[41];
 	bin_to_hex(hex_hash, raw_hash, 20);
-	printf("SHA1: %s\n", hex_hash);
 	tern_node * entry = tern_find_node(rom_db, hex_hash);
 	if (!entry) {
 		entry = tern_find_node(rom_db, product_id);
 	}
+	return entry;
+}
+
+char *rom_db_identify(tern_node *rom_db, uint8_t *rom, uint8_t *hash, uint8_t *regions, uint8_t *in_db)
+{
+	uint8_t product_id[GAME_ID_LEN+1];
+	get_product_id(rom, product_id);
+	tern_node *entry = find_rom_db_entry(rom_db, product_id, hash);
+	*in_db = entry != NULL;
+	char *name = entry ? tern_find_ptr(entry, "name") : NULL;
+	char *dbreg = entry ? tern_find_ptr(entry, "regions") : NULL;
+	*regions = 0;
+	if (dbreg) {
+		while (*dbreg != 0)
+		{
+			*regions |= translate_region_char(*(dbreg++));
+		}
+	}
+	if (!*regions) {
+		*regions = get_header_regions(rom);
+	}
+	return name ? strdup(name) : get_header_name(rom);
+}
+
+static uint8_t  hint_hash[20];
+static uint8_t  hint_head[ROM_DB_HINT_HEAD];
+static uint32_t hint_size;
+static uint8_t  hint_valid;
+
+void rom_db_hash_hint(uint32_t rom_size, uint8_t *head, uint8_t *hash)
+{
+	hint_size = rom_size;
+	memcpy(hint_head, head, rom_size < ROM_DB_HINT_HEAD ? rom_size : ROM_DB_HINT_HEAD);
+	memcpy(hint_hash, hash, sizeof(hint_hash));
+	hint_valid = 1;
+}
+
+rom_info configure_rom(tern_node *rom_db, void *vrom, uint32_t rom_size, void *lock_on, uint32_t lock_on_size, memmap_chunk const *base_map, uint32_t base_chunks)
+{
+	uint8_t product_id[GAME_ID_LEN+1];
+	uint8_t *rom = vrom;
+	get_product_id(rom, product_id);
+	printf("Product ID: %s\n", product_id);
+	uint8_t raw_hash[20];
+	if (hint_valid && hint_size == rom_size && !memcmp(vrom, hint_head, rom_size < ROM_DB_HINT_HEAD ? rom_size : ROM_DB_HINT_HEAD)) {
+		//ROM library already hashed this image
+		memcpy(raw_hash, hint_hash, sizeof(raw_hash));
+	} else {
+		sha1(vrom, rom_size, raw_hash);
+	}
+	hint_valid = 0;
+	uint8_t hex_hash[41];
+	bin_to_hex(hex_hash, raw_hash, 20);
+	printf("SHA1: %s\n", hex_hash);
+	tern_node * entry = find_rom_db_entry(rom_db, product_id, raw_hash);
+	rom_info info;
 	if (!entry) {
 		puts("Not found in ROM DB, examining header\n");
 		if (xband_detect(rom, rom_size)) {
-			return xband_configure_rom(rom_db, rom, rom_size, lock_on, lock_on_size, base_map, base_chunks);
-		}
-		if (realtec_detect(rom, rom_size)) {
-			return realtec_configure_rom(rom, rom_size, base_map, base_chunks);
+			info = xband_configure_rom(rom_db, rom, rom_size, lock_on, lock_on_size, base_map, base_chunks);
+		} else if (realtec_detect(rom, rom_size)) {
+			info = realtec_configure_rom(rom, rom_size, base_map, base_chunks);
+		} else {
+			info = configure_rom_heuristics(rom, rom_size, base_map, base_chunks);
 		}
-		return configure_rom_heuristics(rom, rom_size, base_map, base_chunks);
+		memcpy(info.hash, raw_hash, sizeof(raw_hash));
+		return info;
 	}
-	rom_info info;
+	memcpy(info.hash, raw_hash, sizeof(raw_hash));
 	info.mapper_type = MAPPER_NONE;
 	info.name = tern_find_ptr(entry, "name");
 	if (info.name) {
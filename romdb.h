@@ -74,15 +74,25 @@ struct rom_info {
 	uint8_t       mapper_type;
 	uint8_t       regions;
 	uint8_t       is_save_lock_on; //Does the save buffer actually belong to a lock-on cart?
+	uint8_t       hash[20]; //SHA-1 of the ROM image as loaded
 };
 
 #define GAME_ID_OFF 0x183
 #define GAME_ID_LEN 8
 
+//loads the ROM database on first use, later calls return the same copy
 tern_node *load_rom_db();
 rom_info configure_rom(tern_node *rom_db, void *vrom, uint32_t rom_size, void *lock_on, uint32_t lock_on_size, memmap_chunk const *base_map, uint32_t base_chunks);
 rom_info configure_rom_heuristics(uint8_t *rom, uint32_t rom_size, memmap_chunk const *base_map, uint32_t base_chunks);
 uint8_t translate_region_char(uint8_t c);
+uint8_t get_header_regions(uint8_t *rom);
+char *get_header_name(uint8_t *rom);
+//Finds the title and regions of a ROM image with a known SHA-1 without configuring it,
+//the title comes from the ROM DB if the image is in it and is returned in a newly allocated string
+char *rom_db_identify(tern_node *rom_db, uint8_t *rom, uint8_t *hash, uint8_t *regions, uint8_t *in_db);
+//Lets the next configure_rom call skip hashing the ROM when its size and first ROM_DB_HINT_HEAD bytes match
+#define ROM_DB_HINT_HEAD 0x200
+void rom_db_hash_hint(uint32_t rom_size, uint8_t *head, uint8_t *hash);
 char const *save_type_name(uint8_t save_type);
 //Note: free_rom_info only frees things pointed to by a rom_info struct, not the struct itself
 //this is because rom_info structs are typically stack allocated
@@ -0,0 +1,171 @@
+#include <stdlib.h>
+#include <string.h>
+#include "save_file.h"
+#include "util.h"
+
+#ifdef _WIN32
+
+uint8_t *alloc_save_buffer(uint32_t size, uint8_t fill)
+{
+	uint8_t *buffer = malloc(size);
+	memset(buffer, fill, size);
+	return buffer;
+}
+
+void free_save_buffer(uint8_t *buffer, uint32_t size)
+{
+	free(buffer);
+}
+
+save_file *map_save_file(char *path, uint8_t *buffer, uint32_t size, uint32_t flush_interval)
+{
+	return NULL;
+}
+
+uint8_t sync_save_file(save_file *save)
+{
+	return 0;
+}
+
+void unmap_save_file(save_file *save)
+{
+}
+
+#else
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+struct save_file {
+	uint8_t         *mapped;
+	uint32_t        mapped_size;
+	uint32_t        interval;
+	uint8_t         flusher_running;
+	uint8_t         stop_flusher;
+	pthread_t       flusher;
+	pthread_mutex_t flush_lock;
+	pthread_cond_t  flush_wake;
+};
+
+static uint32_t page_round(uint32_t size)
+{
+	uint32_t page_size = sysconf(_SC_PAGESIZE);
+	return (size + page_size - 1) & ~(page_size - 1);
+}
+
+uint8_t *alloc_save_buffer(uint32_t size, uint8_t fill)
+{
+	uint8_t *buffer = mmap(NULL, page_round(size), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buffer == MAP_FAILED) {
+		fatal_error("Failed to allocate %u bytes for save memory\n", size);
+	}
+	if (fill) {
+		memset(buffer, fill, size);
+	}
+	return buffer;
+}
+
+static void *flush_thread(void *data)
+{
+	save_file *save = data;
+	pthread_mutex_lock(&save->flush_lock);
+	while (!save->stop_flusher)
+	{
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += save->interval;
+		if (pthread_cond_timedwait(&save->flush_wake, &save->flush_lock, &deadline) == ETIMEDOUT && !save->stop_flusher) {
+			//the kernel tracks which pages were written, so this only touches the disk if the save changed
+			msync(save->mapped, save->mapped_size, MS_SYNC);
+		}
+	}
+	pthread_mutex_unlock(&save->flush_lock);
+	return NULL;
+}
+
+save_file *map_save_file(char *path, uint8_t *buffer, uint32_t size, uint32_t flush_interval)
+{
+	int fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		return NULL;
+	}
+	struct stat st;
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+		close(fd);
+		return NULL;
+	}
+	//a new or short file gets the remainder of its contents from the default buffer fill
+	for (off_t cur = st.st_size; cur < size;)
+	{
+		ssize_t written = pwrite(fd, buffer + cur, size - cur, cur);
+		if (written <= 0) {
+			if (written < 0 && errno == EINTR) {
+				continue;
+			}
+			close(fd);
+			return NULL;
+		}
+		cur += written;
+	}
+	uint8_t *file = mmap(buffer, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+	close(fd);
+	if (file == MAP_FAILED) {
+		//MAP_FIXED failures leave the original mapping untouched
+		return NULL;
+	}
+	save_file *save = calloc(1, sizeof(save_file));
+	save->mapped = buffer;
+	save->mapped_size = size;
+	save->interval = flush_interval;
+	pthread_mutex_init(&save->flush_lock, NULL);
+	pthread_cond_init(&save->flush_wake, NULL);
+	if (save->interval) {
+		save->flusher_running = !pthread_create(&save->flusher, NULL, flush_thread, save);
+		if (!save->flusher_running) {
+			warning("Failed to start save flush thread, saves will only be written to disk on exit\n");
+		}
+	}
+	return save;
+}
+
+uint8_t sync_save_file(save_file *save)
+{
+	if (!save) {
+		return 0;
+	}
+	msync(save->mapped, save->mapped_size, MS_SYNC);
+	return 1;
+}
+
+void unmap_save_file(save_file *save)
+{
+	if (!save) {
+		return;
+	}
+	if (save->flusher_running) {
+		pthread_mutex_lock(&save->flush_lock);
+		save->stop_flusher = 1;
+		pthread_cond_signal(&save->flush_wake);
+		pthread_mutex_unlock(&save->flush_lock);
+		pthread_join(save->flusher, NULL);
+	}
+	msync(save->mapped, save->mapped_size, MS_SYNC);
+	pthread_mutex_destroy(&save->flush_lock);
+	pthread_cond_destroy(&save->flush_wake);
+	free(save);
+}
+
+void free_save_buffer(uint8_t *buffer, uint32_t size)
+{
+	if (!buffer) {
+		return;
+	}
+	munmap(buffer, page_round(size));
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef SAVE_FILE_H_
+#define SAVE_FILE_H_
+
+#include <stdint.h>
+
+typedef struct save_file save_file;
+
+//Allocates a buffer for SRAM, EEPROM or NOR flash contents with every byte set to fill
+//the buffer is page aligned so map_save_file can later replace it with a file mapping
+uint8_t *alloc_save_buffer(uint32_t size, uint8_t fill);
+//Releases a buffer from alloc_save_buffer, a file mapped over it must be closed with unmap_save_file first
+void free_save_buffer(uint8_t *buffer, uint32_t size);
+//Maps the file at path over buffer so that writes to the save reach the OS page cache immediately and
+//survive the process crashing. Missing bytes at the end of the file are taken from the current
+//buffer contents. Dirty pages are written to disk every flush_interval seconds (0 disables this).
+//Returns NULL if the file could not be mapped, in which case the caller should fall back to stdio
+save_file *map_save_file(char *path, uint8_t *buffer, uint32_t size, uint32_t flush_interval);
+//Synchronously writes back any dirty pages of a mapped save, returns 0 if save is NULL
+uint8_t sync_save_file(save_file *save);
+//Stops periodic flushing and writes back the save one last time, the buffer stays valid until it is freed
+void unmap_save_file(save_file *save);
+
+#endif //SAVE_FILE_H_
@@ -0,0 +1,131 @@
+#include <string.h>
+#include "sched.h"
+#include "backend.h"
+
+void sched_init(scheduler *sched)
+{
+	sched->count = 0;
+	memset(sched->index, SCHED_NONE, sizeof(sched->index));
+}
+
+static uint8_t sched_before(sched_event *a, sched_event *b)
+{
+	return a->cycle < b->cycle || (a->cycle == b->cycle && a->id < b->id);
+}
+
+static void sched_place(scheduler *sched, uint8_t pos, sched_event event)
+{
+	sched->heap[pos] = event;
+	sched->index[event.id] = pos;
+}
+
+static void sched_sift_up(scheduler *sched, uint8_t pos)
+{
+	sched_event event = sched->heap[pos];
+	while (pos)
+	{
+		uint8_t parent = (pos - 1) / 2;
+		if (!sched_before(&event, sched->heap + parent)) {
+			break;
+		}
+		sched_place(sched, pos, sched->heap[parent]);
+		pos = parent;
+	}
+	sched_place(sched, pos, event);
+}
+
+static void sched_sift_down(scheduler *sched, uint8_t pos)
+{
+	sched_event event = sched->heap[pos];
+	for (;;)
+	{
+		uint8_t child = pos * 2 + 1;
+		if (child >= sched->count) {
+			break;
+		}
+		if (child + 1 < sched->count && sched_before(sched->heap + child + 1, sched->heap + child)) {
+			child++;
+		}
+		if (!sched_before(sched->heap + child, &event)) {
+			break;
+		}
+		sched_place(sched, pos, sched->heap[child]);
+		pos = child;
+	}
+	sched_place(sched, pos, event);
+}
+
+void sched_cancel(scheduler *sched, uint8_t id)
+{
+	uint8_t pos = sched->index[id];
+	if (pos == SCHED_NONE) {
+		return;
+	}
+	sched->index[id] = SCHED_NONE;
+	sched->count--;
+	if (pos == sched->count) {
+		return;
+	}
+	sched_event moved = sched->heap[sched->count];
+	sched_place(sched, pos, moved);
+	sched_sift_up(sched, pos);
+	if (sched->index[moved.id] == pos) {
+		sched_sift_down(sched, pos);
+	}
+}
+
+//schedules event id at cycle, replacing any previous time for it; CYCLE_NEVER cancels
+void sched_set(scheduler *sched, uint8_t id, uint32_t cycle)
+{
+	if (cycle == CYCLE_NEVER) {
+		sched_cancel(sched, id);
+		return;
+	}
+	uint8_t pos = sched->index[id];
+	if (pos == SCHED_NONE) {
+		pos = sched->count++;
+		sched_place(sched, pos, (sched_event){.cycle = cycle, .id = id});
+		sched_sift_up(sched, pos);
+		return;
+	}
+	uint32_t old = sched->heap[pos].cycle;
+	if (old == cycle) {
+		return;
+	}
+	sched->heap[pos].cycle = cycle;
+	if (cycle < old) {
+		sched_sift_up(sched, pos);
+	} else {
+		sched_sift_down(sched, pos);
+	}
+}
+
+uint32_t sched_cycle(scheduler *sched, uint8_t id)
+{
+	uint8_t pos = sched->index[id];
+	return pos == SCHED_NONE ? CYCLE_NEVER : sched->heap[pos].cycle;
+}
+
+uint32_t sched_next(scheduler *sched, uint8_t *id)
+{
+	if (!sched->count) {
+		return CYCLE_NEVER;
+	}
+	if (id) {
+		*id = sched->heap[0].id;
+	}
+	return sched->heap[0].cycle;
+}
+
+void sched_adjust(scheduler *sched, uint32_t deduction)
+{
+	for (uint8_t i = 0; i < sched->count; i++)
+	{
+		sched->heap[i].cycle = sched->heap[i].cycle >= deduction ? sched->heap[i].cycle - deduction : 0;
+	}
+	//clamping past events to 0 can create new ties so restore heap order
+	for (uint8_t i = sched->count / 2; i-- > 0;)
+	{
+		sched_sift_down(sched, i);
+	}
+}
@@ -0,0 +1,29 @@
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#include <stdint.h>
+
+#define SCHED_MAX_EVENTS 8
+#define SCHED_NONE 0xFF
+
+typedef struct {
+	uint32_t cycle;
+	uint8_t  id;
+} sched_event;
+
+//min-heap of pending events keyed on master clock cycle
+//ties are broken in favor of the lower event id
+typedef struct {
+	sched_event heap[SCHED_MAX_EVENTS];
+	uint8_t     index[SCHED_MAX_EVENTS]; //heap position of each event id or SCHED_NONE
+	uint8_t     count;
+} scheduler;
+
+void sched_init(scheduler *sched);
+void sched_set(scheduler *sched, uint8_t id, uint32_t cycle);
+void sched_cancel(scheduler *sched, uint8_t id);
+uint32_t sched_cycle(scheduler *sched, uint8_t id);
+uint32_t sched_next(scheduler *sched, uint8_t *id);
+void sched_adjust(scheduler *sched, uint32_t deduction);
+
+#endif //SCHED_H_
@@ -428,10 +428,12 @@ static void soft_reset(system_header *system)
 static void free_sms(system_header *system)
 {
 	sms_context *sms = (sms_context *)system;
+	cleanup_io_devices(&sms->io);
 	vdp_free(sms->vdp);
 	z80_options_free(sms->z80->options);
 	free(sms->z80);
 	psg_free(sms->psg);
+	free(sms->header.save_filename);
 	free(sms);
 }
 
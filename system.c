@@ -68,3 +68,18 @@ system_header *alloc_config_system(system_type stype, system_media *media, uint3
 		return NULL;
 	}
 }
+
+system_header *reload_config_system(system_header *system, system_type stype, system_media *media, uint32_t opts, uint8_t force_region, rom_info *info_out)
+{
+	if (system->type != stype || media->chain) {
+		//lock-on carts are byteswapped in place so they always go through alloc_config_system
+		return NULL;
+	}
+	switch (stype)
+	{
+	case SYSTEM_GENESIS:
+		return &(reload_genesis((genesis_context *)system, media->buffer, media->size, opts, force_region, info_out))->header;
+	default:
+		return NULL;
+	}
+}
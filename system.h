@@ -26,6 +26,7 @@ typedef uint8_t (*system_u8_fun_r8)(system_header *, uint8_t);
 
 #include "arena.h"
 #include "romdb.h"
+#include "bench.h"
 
 struct system_header {
 	system_header     *next_context;
@@ -44,6 +45,9 @@ struct system_header {
 	arena             *arena;
 	char              *next_rom;
 	char              *save_dir;
+	char              *save_filename; //path of the cartridge save, NULL if the frontend manages saves itself
+	uint32_t          exit_after; //frames left to run before exiting, 0 to run until stopped
+	bench_state       *bench; //non-NULL when running in --benchmark mode
 	uint8_t           enter_debugger;
 	uint8_t           should_exit;
 	uint8_t           save_state;
@@ -61,8 +65,13 @@ struct system_media {
 };
 
 #define OPT_ADDRESS_LOG (1U << 31U)
+#define OPT_NO_Z80      (1U << 30U)
+#define OPT_LOG_REGS    (1U << 29U)
+#define OPT_LOG_MEM     (1U << 28U)
 
 system_type detect_system_type(system_media *media);
 system_header *alloc_config_system(system_type stype, system_media *media, uint32_t opts, uint8_t force_region, rom_info *info_out);
+//Loads new media into an existing system without rebuilding it, returns NULL if the system can't be reused
+system_header *reload_config_system(system_header *system, system_type stype, system_media *media, uint32_t opts, uint8_t force_region, rom_info *info_out);
 
 #endif //SYSTEM_H_
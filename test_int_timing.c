@@ -13,12 +13,12 @@ uint32_t render_map_color(uint8_t r, uint8_t g, uint8_t b)
 	return 0;
 }
 
-uint16_t read_dma_value(uint32_t address)
+uint16_t read_dma_value(system_header *system, uint32_t address)
 {
 	return 0;
 }
 
-uint32_t *render_get_framebuffer(uint8_t which, int *pitch)
+pixel_t *render_get_framebuffer(uint8_t which, int *pitch)
 {
 	*pitch = 0;
 	return NULL;
@@ -0,0 +1,105 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "jag_color.h"
+
+static uint32_t table_cry[0x10000];
+static uint32_t table_rgb[0x10000];
+static uint32_t table_variable[0x10000];
+static uint16_t input[0x10000 + 32];
+static uint32_t output[0x10000 + 32];
+
+static uint32_t pack(uint8_t r, uint8_t g, uint8_t b)
+{
+	return 255 << 24 | r << 16 | g << 8 | b;
+}
+
+static void build_tables(void)
+{
+	for (int i = 0; i < 0x10000; i++)
+	{
+		uint8_t r, g, b;
+		jag_cry_components(i, &r, &g, &b);
+		table_cry[i] = pack(r, g, b);
+		jag_rgb16_components(i, &r, &g, &b);
+		table_rgb[i] = pack(r, g, b);
+		if (i & 1) {
+			jag_rgb16_components(i & 0xFFFE, &r, &g, &b);
+		} else {
+			jag_cry_components(i, &r, &g, &b);
+		}
+		table_variable[i] = pack(r, g, b);
+	}
+}
+
+typedef void (*convert_fun)(uint32_t *dst, uint16_t *src, uint32_t len);
+
+//converts every possible pixel value starting at different alignments
+//and checks that the pixels after the end are left alone
+static int check(char *name, convert_fun convert, uint32_t *table)
+{
+	int failures = 0;
+	for (uint32_t offset = 0; offset < 17; offset++)
+	{
+		uint32_t len = 0x10000 - offset;
+		for (uint32_t i = 0; i < len; i++)
+		{
+			input[offset + i] = i + offset * 0x1001;
+		}
+		memset(output, 0, sizeof(output));
+		convert(output + offset, input + offset, len);
+		for (uint32_t i = 0; i < len; i++)
+		{
+			uint16_t pixel = input[offset + i];
+			if (output[offset + i] != table[pixel]) {
+				if (failures++ < 10) {
+					printf("%s: pixel %04X at offset %d converted to %08X, expected %08X\n", name, pixel, offset, output[offset + i], table[pixel]);
+				}
+			}
+		}
+		for (uint32_t i = offset + len; i < sizeof(output)/sizeof(*output); i++)
+		{
+			if (output[i]) {
+				printf("%s: wrote past the end of the line at offset %d\n", name, offset);
+				failures++;
+				break;
+			}
+		}
+	}
+	return failures;
+}
+
+static int check_rgb24(void)
+{
+	uint16_t words[] = {0x1234, 0x5678, 0xABCD, 0xEF01};
+	uint32_t pixels[2];
+	jag_convert_rgb24(pixels, words, 2);
+	if (pixels[0] != 0xFF341278 || pixels[1] != 0xFFCDAB01) {
+		printf("RGB24: got %08X %08X, expected FF341278 FFCDAB01\n", pixels[0], pixels[1]);
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char ** argv)
+{
+	char *names[] = {"scalar", "SSE2", "AVX2", "NEON"};
+	int failures = 0;
+	jag_color_init();
+	build_tables();
+	for (uint8_t impl = JAG_COLOR_SCALAR; impl <= JAG_COLOR_NEON; impl++)
+	{
+		if (!jag_color_supported(impl)) {
+			printf("%s: not supported, skipping\n", names[impl]);
+			continue;
+		}
+		jag_color_select(impl);
+		int impl_failures = check("CRY", jag_convert_cry, table_cry);
+		impl_failures += check("RGB16", jag_convert_rgb16, table_rgb);
+		impl_failures += check("Variable", jag_convert_variable, table_variable);
+		printf("%s: %s\n", names[impl], impl_failures ? "FAILED" : "passed");
+		failures += impl_failures;
+	}
+	failures += check_rgb24();
+	return failures ? 1 : 0;
+}
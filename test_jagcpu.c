@@ -0,0 +1,211 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jagcpu.h"
+
+//Runs random programs on the interpreter and the translator side by side and checks
+//that they agree on all CPU state and memory after every run slice
+
+#define EXT_WORDS 0x8000
+#define MAX_FAILURES 10
+
+int headless = 1;
+void render_errorbox(char * title, char * buf)
+{
+}
+
+void render_infobox(char * title, char * buf)
+{
+}
+
+typedef struct {
+	uint16_t ext[EXT_WORDS];
+	uint32_t cpu_ints;
+} test_system;
+
+static uint16_t ext_read_16(uint32_t address, void *system)
+{
+	return ((test_system *)system)->ext[address >> 1 & (EXT_WORDS - 1)];
+}
+
+static void ext_write_16(uint32_t address, void *system, uint16_t value)
+{
+	((test_system *)system)->ext[address >> 1 & (EXT_WORDS - 1)] = value;
+}
+
+static void ext_write_8(uint32_t address, void *system, uint8_t value)
+{
+	uint16_t *word = ((test_system *)system)->ext + (address >> 1 & (EXT_WORDS - 1));
+	if (address & 1) {
+		*word = (*word & 0xFF00) | value;
+	} else {
+		*word = (*word & 0xFF) | value << 8;
+	}
+}
+
+static void cpu_int(void *system, uint8_t is_gpu)
+{
+	((test_system *)system)->cpu_ints++;
+}
+
+static uint32_t rand32(void)
+{
+	return (uint32_t)random() ^ (uint32_t)random() << 15;
+}
+
+static uint8_t is_store(uint16_t opcode, uint8_t is_gpu)
+{
+	switch (opcode)
+	{
+	case JAG_STOREB:
+	case JAG_STOREW:
+	case JAG_STORE:
+	case JAG_STORE_R14_REL:
+	case JAG_STORE_R15_REL:
+	case JAG_STORE_R14_INDEXED:
+	case JAG_STORE_R15_INDEXED:
+		return 1;
+	case GPU_STOREP:
+		return is_gpu;
+	}
+	return 0;
+}
+
+static char *compare(jag_cpu *interp, jag_cpu *trans, uint32_t local_bytes)
+{
+	if (interp->pc != trans->pc) {
+		return "PC";
+	}
+	if (interp->cycles != trans->cycles) {
+		return "cycles";
+	}
+	if (memcmp(interp->regs, trans->regs, sizeof(interp->regs))) {
+		return "registers";
+	}
+	if (interp->flag_z != trans->flag_z || interp->flag_c != trans->flag_c || interp->flag_n != trans->flag_n) {
+		return "ZCN";
+	}
+	if (interp->flags != trans->flags || interp->ctrl != trans->ctrl) {
+		return "flags/control";
+	}
+	if (interp->accumulator != trans->accumulator) {
+		return "accumulator";
+	}
+	if (interp->resultreg != trans->resultreg || interp->flags_pending != trans->flags_pending) {
+		return "pipeline";
+	}
+	if (memcmp(interp->local, trans->local, local_bytes)) {
+		return "local RAM";
+	}
+	test_system *isys = interp->system, *tsys = trans->system;
+	if (memcmp(isys->ext, tsys->ext, sizeof(isys->ext))) {
+		return "external memory";
+	}
+	if (isys->cpu_ints != tsys->cpu_ints) {
+		return "CPU interrupts";
+	}
+	return NULL;
+}
+
+//mode 0: mostly ALU ops, 1: registers point into local RAM, 2: random register values,
+//3: stores allowed, including to the control registers
+static int run_program(jag_cpu_options *interp_opts, jag_cpu_options *trans_opts, int seed)
+{
+	uint8_t is_gpu = interp_opts->is_gpu;
+	uint32_t words = interp_opts->local_bytes / sizeof(uint32_t);
+	int mode = seed % 4;
+	srandom(seed);
+	uint32_t *interp_local = calloc(words, sizeof(uint32_t));
+	uint32_t *trans_local = calloc(words, sizeof(uint32_t));
+	test_system *interp_sys = calloc(1, sizeof(test_system));
+	test_system *trans_sys = calloc(1, sizeof(test_system));
+	for (uint32_t i = 0; i < words; i++)
+	{
+		uint16_t inst[2] = {rand32(), rand32()};
+		for (int j = 0; j < 2; j++)
+		{
+			uint16_t opcode = jag_opcode(inst[j], is_gpu);
+			if (mode != 3 && is_store(opcode, is_gpu)) {
+				inst[j] = (inst[j] & 0x3FF) | (rand32() % 20) << 10;
+			}
+		}
+		interp_local[i] = trans_local[i] = inst[0] << 16 | inst[1];
+	}
+	for (uint32_t i = 0; i < EXT_WORDS; i++)
+	{
+		interp_sys->ext[i] = trans_sys->ext[i] = rand32();
+	}
+	jag_cpu *interp = init_jag_cpu(interp_opts, interp_local, interp_sys);
+	jag_cpu *trans = init_jag_cpu(trans_opts, trans_local, trans_sys);
+	for (int reg = 0; reg < 64; reg++)
+	{
+		uint32_t value = rand32();
+		if (mode == 1 || reg % 3 == 0) {
+			value = interp_opts->local_start + rand32() % interp_opts->local_bytes;
+		}
+		if (mode == 3 && reg % 7 == 0) {
+			value = interp_opts->ctrl_start + (rand32() % 0x24 & ~3);
+		}
+		interp->regs[reg] = trans->regs[reg] = value;
+	}
+	interp->ctrl = trans->ctrl = JAG_CTRL_GO;
+	interp->flags = trans->flags = (seed & 8) ? 0x1F0 : 0;
+	if (is_gpu) {
+		interp->gpu.hidata = trans->gpu.hidata = rand32();
+	} else {
+		interp->dsp.modulo = trans->dsp.modulo = rand32() & 0xFFFF00;
+	}
+	int failed = 0;
+	uint32_t target = 0;
+	for (int slice = 0; slice < 200 && (interp->ctrl & JAG_CTRL_GO); slice++)
+	{
+		target += 1 + rand32() % 200;
+		if (slice % 37 == 36) {
+			jag_cpu_interrupt(interp, slice % 5);
+			jag_cpu_interrupt(trans, slice % 5);
+		}
+		jag_cpu_run(interp, target);
+		jag_cpu_run(trans, target);
+		char *mismatch = compare(interp, trans, interp_opts->local_bytes);
+		if (mismatch) {
+			printf("%s seed %d slice %d: %s mismatch, PC %X/%X, cycles %u/%u\n",
+				is_gpu ? "GPU" : "DSP", seed, slice, mismatch, interp->pc, trans->pc, interp->cycles, trans->cycles
+			);
+			failed = 1;
+			break;
+		}
+	}
+	jag_cpu_flush_code(trans);
+	free(interp);
+	free(trans);
+	free(interp_local);
+	free(trans_local);
+	free(interp_sys);
+	free(trans_sys);
+	return failed;
+}
+
+int main(int argc, char ** argv)
+{
+	int programs = argc > 1 ? atoi(argv[1]) : 2000;
+	int failures = 0;
+	for (uint8_t is_gpu = 0; is_gpu < 2; is_gpu++)
+	{
+		jag_cpu_options interp_opts, trans_opts;
+		init_jag_cpu_opts(&interp_opts, is_gpu, JAG_OPT_INTERPRET);
+		init_jag_cpu_opts(&trans_opts, is_gpu, 0);
+		interp_opts.read_16 = trans_opts.read_16 = ext_read_16;
+		interp_opts.write_16 = trans_opts.write_16 = ext_write_16;
+		interp_opts.write_8 = trans_opts.write_8 = ext_write_8;
+		interp_opts.cpu_int = trans_opts.cpu_int = cpu_int;
+		int core_failures = 0;
+		for (int seed = 0; seed < programs && failures + core_failures < MAX_FAILURES; seed++)
+		{
+			core_failures += run_program(&interp_opts, &trans_opts, seed);
+		}
+		printf("%s: %d of %d programs %s\n", is_gpu ? "GPU" : "DSP", programs - core_failures, programs, core_failures ? "matched, FAILED" : "matched");
+		failures += core_failures;
+	}
+	return failures ? 1 : 0;
+}
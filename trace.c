@@ -0,0 +1,221 @@
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <pthread.h>
+#define TRACE_THREADED
+#endif
+#include "trace.h"
+#include "util.h"
+
+//records are staged in a ring of chunks, full chunks are written out by a background thread
+#define TRACE_CHUNK_SIZE (256*1024)
+#define TRACE_CHUNKS 16
+#define TRACE_MAX_RECORD 32
+
+struct trace_writer {
+	FILE            *f;
+	trace_writer    *next;
+	uint8_t         *chunks[TRACE_CHUNKS];
+	uint32_t        chunk_used[TRACE_CHUNKS];
+	uint8_t         *cur;
+	uint8_t         *cur_end;
+	uint64_t        cycle_base;
+	uint64_t        last_cycle;
+	uint32_t        last_pc;
+	//number of chunks handed off to and written by the writer thread
+	uint32_t        produced;
+	uint32_t        consumed;
+#ifdef TRACE_THREADED
+	pthread_t       thread;
+	pthread_mutex_t lock;
+	pthread_cond_t  filled;
+	pthread_cond_t  drained;
+	uint8_t         done;
+#endif
+};
+
+static trace_writer *open_traces;
+
+static uint8_t *put_varint(uint8_t *dst, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		*(dst++) = value | 0x80;
+		value >>= 7;
+	}
+	*(dst++) = value;
+	return dst;
+}
+
+static uint8_t *put_delta(uint8_t *dst, int64_t delta)
+{
+	return put_varint(dst, (uint64_t)delta << 1 ^ (uint64_t)(delta >> 63));
+}
+
+static void write_chunk(trace_writer *trace, uint32_t index)
+{
+	if (trace->chunk_used[index] != fwrite(trace->chunks[index], 1, trace->chunk_used[index], trace->f)) {
+		warning("Failed to write to trace file\n");
+	}
+}
+
+#ifdef TRACE_THREADED
+static void *trace_thread(void *data)
+{
+	trace_writer *trace = data;
+	pthread_mutex_lock(&trace->lock);
+	for (;;)
+	{
+		while (trace->consumed == trace->produced && !trace->done)
+		{
+			pthread_cond_wait(&trace->filled, &trace->lock);
+		}
+		if (trace->consumed == trace->produced) {
+			break;
+		}
+		uint32_t index = trace->consumed % TRACE_CHUNKS;
+		pthread_mutex_unlock(&trace->lock);
+		write_chunk(trace, index);
+		pthread_mutex_lock(&trace->lock);
+		trace->consumed++;
+		pthread_cond_signal(&trace->drained);
+	}
+	pthread_mutex_unlock(&trace->lock);
+	return NULL;
+}
+#endif
+
+static void submit_chunk(trace_writer *trace)
+{
+	uint32_t index = trace->produced % TRACE_CHUNKS;
+	trace->chunk_used[index] = trace->cur - trace->chunks[index];
+#ifdef TRACE_THREADED
+	pthread_mutex_lock(&trace->lock);
+	trace->produced++;
+	pthread_cond_signal(&trace->filled);
+	//only block the emulator when the writer has fallen a full ring behind
+	while (trace->produced - trace->consumed >= TRACE_CHUNKS)
+	{
+		pthread_cond_wait(&trace->drained, &trace->lock);
+	}
+	pthread_mutex_unlock(&trace->lock);
+#else
+	write_chunk(trace, index);
+	trace->produced++;
+	trace->consumed++;
+#endif
+	index = trace->produced % TRACE_CHUNKS;
+	trace->cur = trace->chunks[index];
+	trace->cur_end = trace->cur + TRACE_CHUNK_SIZE - TRACE_MAX_RECORD;
+}
+
+static void close_all_traces(void)
+{
+	while (open_traces)
+	{
+		trace_close(open_traces);
+	}
+}
+
+trace_writer *trace_open(char *path)
+{
+	FILE *f = fopen(path, "wb");
+	if (!f) {
+		warning("Failed to open trace file %s for writing\n", path);
+		return NULL;
+	}
+	fwrite(TRACE_MAGIC, 1, strlen(TRACE_MAGIC), f);
+	fputc(TRACE_VERSION, f);
+	trace_writer *trace = calloc(1, sizeof(trace_writer));
+	trace->f = f;
+	for (int i = 0; i < TRACE_CHUNKS; i++)
+	{
+		trace->chunks[i] = malloc(TRACE_CHUNK_SIZE);
+	}
+	trace->cur = trace->chunks[0];
+	trace->cur_end = trace->cur + TRACE_CHUNK_SIZE - TRACE_MAX_RECORD;
+#ifdef TRACE_THREADED
+	pthread_mutex_init(&trace->lock, NULL);
+	pthread_cond_init(&trace->filled, NULL);
+	pthread_cond_init(&trace->drained, NULL);
+	if (pthread_create(&trace->thread, NULL, trace_thread, trace)) {
+		fatal_error("Failed to start trace writer thread\n");
+	}
+#endif
+	//traces are usually left running until the emulator exits, make sure buffered records make it to disk
+	if (!open_traces) {
+		atexit(close_all_traces);
+	}
+	trace->next = open_traces;
+	open_traces = trace;
+	return trace;
+}
+
+static uint8_t *begin_record(trace_writer *trace, uint8_t type, uint32_t cycle)
+{
+	if (trace->cur >= trace->cur_end) {
+		submit_chunk(trace);
+	}
+	uint8_t *dst = trace->cur;
+	*(dst++) = type;
+	uint64_t full_cycle = trace->cycle_base + cycle;
+	dst = put_delta(dst, full_cycle - trace->last_cycle);
+	trace->last_cycle = full_cycle;
+	return dst;
+}
+
+void trace_pc(trace_writer *trace, uint32_t pc, uint32_t cycle)
+{
+	uint8_t *dst = begin_record(trace, TRACE_PC, cycle);
+	trace->cur = put_delta(dst, (int32_t)(pc - trace->last_pc));
+	trace->last_pc = pc;
+}
+
+void trace_reg(trace_writer *trace, uint32_t cycle, uint8_t reg, uint32_t value)
+{
+	uint8_t *dst = begin_record(trace, TRACE_REG, cycle);
+	*(dst++) = reg;
+	trace->cur = put_varint(dst, value);
+}
+
+void trace_mem(trace_writer *trace, uint32_t cycle, uint32_t address, uint8_t size, uint32_t value)
+{
+	uint8_t *dst = begin_record(trace, TRACE_MEM, cycle);
+	dst = put_varint(dst, address);
+	*(dst++) = size;
+	trace->cur = put_varint(dst, value);
+}
+
+void trace_adjust_cycles(trace_writer *trace, uint32_t deduction)
+{
+	//cycle counters are periodically rebased, keep the traced cycle count monotonic
+	trace->cycle_base += deduction;
+}
+
+void trace_close(trace_writer *trace)
+{
+	for (trace_writer **cur = &open_traces; *cur; cur = &(*cur)->next)
+	{
+		if (*cur == trace) {
+			*cur = trace->next;
+			break;
+		}
+	}
+	submit_chunk(trace);
+#ifdef TRACE_THREADED
+	pthread_mutex_lock(&trace->lock);
+	trace->done = 1;
+	pthread_cond_signal(&trace->filled);
+	pthread_mutex_unlock(&trace->lock);
+	pthread_join(trace->thread, NULL);
+	pthread_mutex_destroy(&trace->lock);
+	pthread_cond_destroy(&trace->filled);
+	pthread_cond_destroy(&trace->drained);
+#endif
+	fclose(trace->f);
+	for (int i = 0; i < TRACE_CHUNKS; i++)
+	{
+		free(trace->chunks[i]);
+	}
+	free(trace);
+}
@@ -0,0 +1,27 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define TRACE_MAGIC "BTRC"
+#define TRACE_VERSION 1
+
+//Every record starts with a type byte and a cycle delta followed by LEB128 varints.
+//PCs and cycles are stored as zigzag encoded deltas from the previous record
+enum {
+	TRACE_PC = 1, //pc delta
+	TRACE_REG,    //register number byte, value
+	TRACE_MEM     //address, size byte, value
+};
+
+typedef struct trace_writer trace_writer;
+
+trace_writer *trace_open(char *path);
+void trace_pc(trace_writer *trace, uint32_t pc, uint32_t cycle);
+void trace_reg(trace_writer *trace, uint32_t cycle, uint8_t reg, uint32_t value);
+void trace_mem(trace_writer *trace, uint32_t cycle, uint32_t address, uint8_t size, uint32_t value);
+void trace_adjust_cycles(trace_writer *trace, uint32_t deduction);
+void trace_close(trace_writer *trace);
+
+#endif //TRACE_H_
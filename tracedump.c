@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+typedef struct {
+	uint64_t cycle;
+	uint32_t pc;
+	uint32_t address;
+	uint32_t value;
+	uint8_t  type;
+	uint8_t  reg;
+	uint8_t  size;
+} trace_record;
+
+typedef struct {
+	FILE     *f;
+	uint64_t last_cycle;
+	uint32_t last_pc;
+} trace_reader;
+
+static uint8_t get_varint(FILE *f, uint64_t *out)
+{
+	uint64_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		int byte = fgetc(f);
+		if (byte == EOF) {
+			return 0;
+		}
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			*out = value;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static uint8_t get_delta(FILE *f, int64_t *out)
+{
+	uint64_t value;
+	if (!get_varint(f, &value)) {
+		return 0;
+	}
+	*out = (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+	return 1;
+}
+
+static uint8_t trace_reader_open(trace_reader *reader, FILE *f)
+{
+	char magic[4];
+	memset(reader, 0, sizeof(*reader));
+	reader->f = f;
+	if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) || memcmp(magic, TRACE_MAGIC, sizeof(magic))) {
+		return 0;
+	}
+	return fgetc(f) == TRACE_VERSION;
+}
+
+static uint8_t trace_read(trace_reader *reader, trace_record *record)
+{
+	int type = fgetc(reader->f);
+	if (type == EOF) {
+		return 0;
+	}
+	if (type < TRACE_PC || type > TRACE_MEM) {
+		fprintf(stderr, "Unknown trace record type %d\n", type);
+		return 0;
+	}
+	memset(record, 0, sizeof(*record));
+	record->type = type;
+	int64_t delta;
+	uint64_t value;
+	if (!get_delta(reader->f, &delta)) {
+		return 0;
+	}
+	reader->last_cycle += delta;
+	record->cycle = reader->last_cycle;
+	if (type == TRACE_PC) {
+		if (!get_delta(reader->f, &delta)) {
+			return 0;
+		}
+		reader->last_pc += delta;
+	} else if (type == TRACE_REG) {
+		int reg = fgetc(reader->f);
+		if (reg == EOF || !get_varint(reader->f, &value)) {
+			return 0;
+		}
+		record->reg = reg;
+		record->value = value;
+	} else if (type == TRACE_MEM) {
+		if (!get_varint(reader->f, &value)) {
+			return 0;
+		}
+		record->address = value;
+		int size = fgetc(reader->f);
+		if (size == EOF || !get_varint(reader->f, &value)) {
+			return 0;
+		}
+		record->size = size;
+		record->value = value;
+	}
+	record->pc = reader->last_pc;
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	uint8_t verbose = 0;
+	char *fname = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-v")) {
+			verbose = 1;
+		} else {
+			fname = argv[i];
+		}
+	}
+	if (!fname) {
+		fputs("Usage: tracedump [-v] TRACE_FILE\n"
+			"Converts a binary BlastEm trace to text. By default only the traced PCs are\n"
+			"printed, one per line, in the format accepted by dis -f\n"
+			"	-v    Print every record with its cycle count\n", stderr);
+		return 1;
+	}
+	FILE *f = fopen(fname, "rb");
+	if (!f) {
+		fprintf(stderr, "Failed to open %s for reading\n", fname);
+		return 1;
+	}
+	trace_reader reader;
+	if (!trace_reader_open(&reader, f)) {
+		fprintf(stderr, "%s is not a BlastEm trace file\n", fname);
+		return 1;
+	}
+	trace_record record;
+	while (trace_read(&reader, &record))
+	{
+		if (!verbose) {
+			if (record.type == TRACE_PC) {
+				printf("%X\n", record.pc);
+			}
+			continue;
+		}
+		switch (record.type)
+		{
+		case TRACE_PC:
+			printf("%llu: PC %X\n", (unsigned long long)record.cycle, record.pc);
+			break;
+		case TRACE_REG:
+			//68K registers are numbered D0-D7 then A0-A7
+			printf("%llu: %c%d = %X\n", (unsigned long long)record.cycle, record.reg < 8 ? 'D' : 'A', record.reg & 7, record.value);
+			break;
+		case TRACE_MEM:
+			printf("%llu: MEM %X.%d = %X\n", (unsigned long long)record.cycle, record.address, record.size, record.value);
+			break;
+		}
+	}
+	fclose(f);
+	return 0;
+}
@@ -5,7 +5,10 @@
 */
 #include "68kinst.h"
 #include "m68k_core.h"
+#include "m68k_internal.h"
 #include "mem.h"
+#include "hash.h"
+#include "util.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -38,6 +41,115 @@ m68k_context *reset_handler(m68k_context *context)
 	return context;
 }
 
+#define ROM_END 0x400000
+
+uint32_t *entries;
+uint32_t num_entries, entry_storage;
+uint8_t *visited;
+
+void add_entry(uint32_t address)
+{
+	for (uint32_t i = 0; i < num_entries; i++)
+	{
+		if (entries[i] == address) {
+			return;
+		}
+	}
+	if (num_entries == entry_storage) {
+		entry_storage = entry_storage ? entry_storage * 2 : 1024;
+		entries = realloc(entries, entry_storage * sizeof(uint32_t));
+	}
+	entries[num_entries++] = address;
+}
+
+//Follows direct branches and calls from address to find every block entry reachable from it
+void walk_code(uint16_t *filebuf, uint32_t address)
+{
+	uint32_t dregs[8] = {0}, aregs[8] = {0};
+	uint32_t *pending = NULL;
+	uint32_t num_pending = 0, pending_storage = 0;
+	m68kinst inst;
+	for (;;)
+	{
+		address &= 0xFFFFFF;
+		if (!(address & 1) && address < ROM_END) {
+			add_entry(address);
+			while (address < ROM_END && !visited[address >> 1])
+			{
+				visited[address >> 1] = 1;
+				uint16_t *next = m68k_decode(filebuf + (address >> 1), &inst, address);
+				address += (next - (filebuf + (address >> 1))) * 2;
+				if (inst.op == M68K_INVALID) {
+					break;
+				}
+				uint8_t direct = inst.op == M68K_BCC || inst.op == M68K_BSR || inst.op == M68K_DBCC
+					|| inst.src.addr_mode == MODE_PC_DISPLACE || inst.src.addr_mode == MODE_ABSOLUTE
+					|| inst.src.addr_mode == MODE_ABSOLUTE_SHORT;
+				if (m68k_is_branch(&inst) && direct) {
+					if (num_pending == pending_storage) {
+						pending_storage = pending_storage ? pending_storage * 2 : 64;
+						pending = realloc(pending, pending_storage * sizeof(uint32_t));
+					}
+					pending[num_pending++] = m68k_branch_target(&inst, dregs, aregs);
+				}
+				if (m68k_is_terminal(&inst)) {
+					break;
+				}
+			}
+		}
+		if (!num_pending) {
+			break;
+		}
+		address = pending[--num_pending];
+	}
+	free(pending);
+}
+
+//Writes a code map for BlastEm to translate at load time, named after the ROM's SHA-1
+//Entries come from the ROM's vectors and any address logs from a previous run with -l
+void write_code_map(m68k_context *context, uint16_t *filebuf, uint8_t *raw_hash, int num_logs, char **logs)
+{
+	visited = calloc(ROM_END >> 1, 1);
+	for (uint32_t vector = 1; vector < 64; vector++)
+	{
+		uint32_t address = (filebuf[vector*2] << 16 | filebuf[vector*2+1]) & 0xFFFFFF;
+		//unused vectors are often left pointing at the vector table or the header
+		if (address >= 0x200) {
+			walk_code(filebuf, address);
+		}
+	}
+	for (int i = 0; i < num_logs; i++)
+	{
+		FILE *f = fopen(logs[i], "r");
+		if (!f) {
+			fatal_error("Failed to open address log %s\n", logs[i]);
+		}
+		unsigned int address;
+		while (fscanf(f, "%X", &address) == 1)
+		{
+			walk_code(filebuf, address);
+		}
+		fclose(f);
+	}
+	free(visited);
+	//make sure everything in the map can actually be translated before BlastEm tries to at load time
+	m68k_pretranslate_entries(context, entries, num_entries);
+	uint8_t hex_hash[41];
+	bin_to_hex(hex_hash, raw_hash, 20);
+	char *path = alloc_concat((char *)hex_hash, ".map");
+	FILE *f = fopen(path, "w");
+	if (!f) {
+		fatal_error("Failed to open %s for writing\n", path);
+	}
+	for (uint32_t i = 0; i < num_entries; i++)
+	{
+		fprintf(f, "%X\n", entries[i]);
+	}
+	fclose(f);
+	printf("Wrote %d entry points to %s\n", num_entries, path);
+	free(path);
+}
+
 int main(int argc, char ** argv)
 {
 	long filesize;
@@ -45,14 +157,26 @@ int main(int argc, char ** argv)
 	char disbuf[1024];
 	unsigned short * cur;
 	m68k_options opts;
-	FILE * f = fopen(argv[1], "rb");
+	uint8_t make_map = argc > 1 && !strcmp(argv[1], "-m");
+	if (argc < 2 + make_map) {
+		fatal_error("Usage: trans [-m] ROM [ADDRESS_LOG...]\n");
+	}
+	FILE * f = fopen(argv[1 + make_map], "rb");
+	if (!f) {
+		fatal_error("Failed to open %s\n", argv[1 + make_map]);
+	}
 	fseek(f, 0, SEEK_END);
 	filesize = ftell(f);
 	fseek(f, 0, SEEK_SET);
-	filebuf = malloc(0x400000);
-	memset(filebuf, 0, 0x400000);
-	fread(filebuf, 2, filesize/2 > 0x200000 ? 0x200000 : filesize/2, f);
+	if (filesize > ROM_END) {
+		filesize = ROM_END;
+	}
+	filebuf = malloc(ROM_END);
+	memset(filebuf, 0, ROM_END);
+	fread(filebuf, 2, filesize/2, f);
 	fclose(f);
+	uint8_t raw_hash[20];
+	sha1((uint8_t *)filebuf, filesize, raw_hash);
 	for(cur = filebuf; cur - filebuf < (filesize/2); ++cur)
 	{
 		*cur = (*cur >> 8) | (*cur << 8);
@@ -77,6 +201,10 @@ int main(int argc, char ** argv)
 	context->target_cycle = context->sync_cycle = 0x80000000;
 	uint32_t address;
 	address = filebuf[2] << 16 | filebuf[3];
+	if (make_map) {
+		write_code_map(context, filebuf, raw_hash, argc - 2, argv + 2);
+		return 0;
+	}
 	translate_m68k_stream(address, context);
 	m68k_reset(context);
 	return 0;
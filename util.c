@@ -145,7 +145,14 @@ char *replace_vars(char *base, tern_node *vars, uint8_t allow_env)
 
 void byteswap_rom(int filesize, uint16_t *cart)
 {
-	for(uint16_t *cur = cart; cur - cart < filesize/2; ++cur)
+	//swap four words at a time, ROM buffers are always at least 8-byte aligned
+	uint64_t *cur64 = (uint64_t *)cart, *end64 = cur64 + filesize / 8;
+	for (; cur64 < end64; ++cur64)
+	{
+		uint64_t val = *cur64;
+		*cur64 = (val >> 8 & 0x00FF00FF00FF00FFULL) | (val << 8 & 0xFF00FF00FF00FF00ULL);
+	}
+	for(uint16_t *cur = (uint16_t *)end64; cur - cart < filesize/2; ++cur)
 	{
 		*cur = (*cur >> 8) | (*cur << 8);
 	}
@@ -489,6 +496,16 @@ time_t get_modification_time(char *path)
 	return (time_t)wintime;
 }
 
+void *map_file_private(FILE *f, long filesize, uint32_t alloc_size)
+{
+	return NULL;
+}
+
+void release_file_buffer(void *buffer)
+{
+	free(buffer);
+}
+
 int ensure_dir_exists(char *path)
 {
 	if (CreateDirectory(path, NULL)) {
@@ -523,12 +540,62 @@ int ensure_dir_exists(char *path)
 }
 
 #else
+#include <sys/mman.h>
 
 char * get_home_dir()
 {
 	return getenv("HOME");
 }
 
+typedef struct {
+	void     *base;
+	uint32_t size;
+} file_map;
+
+static file_map *file_maps;
+static uint32_t num_file_maps, file_map_storage;
+
+void *map_file_private(FILE *f, long filesize, uint32_t alloc_size)
+{
+	if (filesize <= 0 || filesize > alloc_size) {
+		return NULL;
+	}
+	//reserve the whole zero-filled region first so the padding past EOF is accessible
+	uint8_t *base = mmap(NULL, alloc_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) {
+		return NULL;
+	}
+	int flags = MAP_PRIVATE | MAP_FIXED;
+#ifdef MAP_POPULATE
+	//callers byteswap the whole image right away so there's no point in faulting pages in one at a time
+	flags |= MAP_POPULATE;
+#endif
+	if (mmap(base, filesize, PROT_READ | PROT_WRITE, flags, fileno(f), 0) == MAP_FAILED) {
+		munmap(base, alloc_size);
+		return NULL;
+	}
+	if (num_file_maps == file_map_storage) {
+		file_map_storage = file_map_storage ? file_map_storage * 2 : 4;
+		file_maps = realloc(file_maps, file_map_storage * sizeof(file_map));
+	}
+	file_maps[num_file_maps].base = base;
+	file_maps[num_file_maps++].size = alloc_size;
+	return base;
+}
+
+void release_file_buffer(void *buffer)
+{
+	for (uint32_t i = 0; i < num_file_maps; i++)
+	{
+		if (file_maps[i].base == buffer) {
+			munmap(buffer, file_maps[i].size);
+			file_maps[i] = file_maps[--num_file_maps];
+			return;
+		}
+	}
+	free(buffer);
+}
+
 char * readlink_alloc(char * path)
 {
 	char * linktext = NULL;
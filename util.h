@@ -64,6 +64,10 @@ dir_entry *get_dir_list(char *path, size_t *numret);
 void free_dir_list(dir_entry *list, size_t numentries);
 //Gets the modification time of a file
 time_t get_modification_time(char *path);
+//Maps a file copy-on-write at the start of a zero-filled region of alloc_size bytes, returns NULL if that isn't possible
+void *map_file_private(FILE *f, long filesize, uint32_t alloc_size);
+//Frees a buffer returned by map_file_private or malloc
+void release_file_buffer(void *buffer);
 //Recusrively creates a directory if it does not exist
 int ensure_dir_exists(char *path);
 //Returns the contents of a symlink in a newly allocated string
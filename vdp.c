@@ -53,15 +53,13 @@
 #define BORDER_BOT_V28_PAL 32
 #define BORDER_BOT_V30_PAL 24
 
-#define INVALID_LINE 0x200
-
 enum {
 	INACTIVE = 0,
 	PREPARING, //used for line 0x1FF
 	ACTIVE
 };
 
-static int32_t color_map[1 << 12];
+static pixel_t color_map[1 << 12];
 static uint16_t mode4_address_map[0x4000];
 static uint32_t planar_to_chunky[256];
 static uint8_t levels[] = {0, 27, 49, 71, 87, 103, 119, 130, 146, 157, 174, 190, 206, 228, 255};
@@ -76,6 +74,7 @@ static uint8_t debug_base[][3] = {
 
 static void update_video_params(vdp_context *context)
 {
+	context->timing_serial++;
 	if (context->regs[REG_MODE_2] & BIT_MODE_5) {
 		if (context->regs[REG_MODE_2] & BIT_PAL) {
 			if (context->flags2 & FLAG2_REGION_PAL) {
@@ -142,18 +141,37 @@ void init_vdp_context(vdp_context * context, uint8_t region_pal)
 {
 	memset(context, 0, sizeof(*context));
 	context->vdpmem = malloc(VRAM_SIZE);
+	if (headless) {
+		context->output = malloc(LINEBUF_SIZE * sizeof(pixel_t));
+	}
+	context->linebuf = malloc(LINEBUF_SIZE + SCROLL_BUFFER_SIZE*2);
+	context->sprite_lines = malloc(SPRITE_INDEX_LINES * 2 * sizeof(uint64_t));
+	vdp_reset(context, region_pal);
+}
+
+//Returns the VDP to its power on state, reusing the buffers allocated by init_vdp_context
+void vdp_reset(vdp_context *context, uint8_t region_pal)
+{
+	uint8_t *vdpmem = context->vdpmem;
+	uint8_t *linebuf = context->linebuf;
+	uint64_t *sprite_lines = context->sprite_lines;
+	pixel_t *output = context->output;
+	memset(context, 0, sizeof(*context));
+	context->vdpmem = vdpmem;
 	memset(context->vdpmem, 0, VRAM_SIZE);
-	/*
-	*/
 	if (headless) {
-		context->output = malloc(LINEBUF_SIZE * sizeof(uint32_t));
+		context->output = output;
 		context->output_pitch = 0;
 	} else {
 		context->cur_buffer = FRAMEBUFFER_ODD;
 		context->fb = render_get_framebuffer(FRAMEBUFFER_ODD, &context->output_pitch);
 	}
-	context->linebuf = malloc(LINEBUF_SIZE + SCROLL_BUFFER_SIZE*2);
+	context->linebuf = linebuf;
 	memset(context->linebuf, 0, LINEBUF_SIZE + SCROLL_BUFFER_SIZE*2);
+	context->sprite_lines = sprite_lines;
+	memset(context->sprite_lines, 0, SPRITE_INDEX_LINES * 2 * sizeof(uint64_t));
+	context->sprite_lines_dirty[0] = context->sprite_lines_dirty[1] = 0xFFFFFFFFFFFFFFFFULL;
+	context->frame_writes = FRAME_WRITES_CUR | FRAME_WRITES_PREV;
 	context->tmp_buf_a = context->linebuf + LINEBUF_SIZE;
 	context->tmp_buf_b = context->tmp_buf_a + SCROLL_BUFFER_SIZE;
 	context->sprite_draws = MAX_DRAWS;
@@ -248,7 +266,7 @@ void init_vdp_context(vdp_context * context, uint8_t region_pal)
 	}
 	update_video_params(context);
 	if (!headless) {
-		context->output = (uint32_t *)(((char *)context->fb) + context->output_pitch * context->border_top);
+		context->output = (pixel_t *)(((char *)context->fb) + context->output_pitch * context->border_top);
 	}
 }
 
@@ -256,6 +274,7 @@ void vdp_free(vdp_context *context)
 {
 	free(context->vdpmem);
 	free(context->linebuf);
+	free(context->sprite_lines);
 	free(context);
 }
 
@@ -550,6 +569,38 @@ static uint8_t is_active(vdp_context *context)
 	return context->state != INACTIVE && (context->regs[REG_MODE_2] & BIT_DISP_EN) != 0;
 }
 
+//Brings the line index entry for a sprite up to date with sat_cache
+static void update_sprite_lines(vdp_context *context, uint8_t sprite, uint16_t ymask, uint8_t height_mult)
+{
+	uint64_t bit = 1ULL << (sprite & 63);
+	uint64_t *lines = context->sprite_lines + (sprite >> 6);
+	for (uint16_t line = context->sprite_lines_y[sprite]; line < context->sprite_lines_end[sprite]; line++)
+	{
+		lines[line * 2] &= ~bit;
+	}
+	uint16_t address = sprite * 4;
+	uint16_t y = ((context->sat_cache[address] & 0x3) << 8 | context->sat_cache[address+1]) & ymask;
+	uint16_t end = y + ((context->sat_cache[address+2] & 0x3) + 1) * height_mult;
+	if (end > ymask + 1) {
+		end = ymask + 1;
+	}
+	for (uint16_t line = y; line < end; line++)
+	{
+		lines[line * 2] |= bit;
+	}
+	context->sprite_lines_y[sprite] = y;
+	context->sprite_lines_end[sprite] = end;
+	context->sprite_lines_dirty[sprite >> 6] &= ~bit;
+}
+
+static uint8_t sprite_on_line(vdp_context *context, uint8_t sprite, uint16_t line, uint16_t ymask, uint8_t height_mult)
+{
+	if (context->sprite_lines_dirty[sprite >> 6] & (1ULL << (sprite & 63))) {
+		update_sprite_lines(context, sprite, ymask, height_mult);
+	}
+	return (context->sprite_lines[line * 2 + (sprite >> 6)] >> (sprite & 63)) & 1;
+}
+
 static void scan_sprite_table(uint32_t line, vdp_context * context)
 {
 	if (context->sprite_index && ((uint8_t)context->slot_counter) < context->max_sprites_line) {
@@ -569,6 +620,11 @@ static void scan_sprite_table(uint32_t line, vdp_context * context)
 			ymin = 128;
 			height_mult = 8;
 		}
+		if (context->double_res != context->sprite_lines_double) {
+			//every entry changes meaning when switching in or out of double resolution mode
+			context->sprite_lines_double = context->double_res;
+			context->sprite_lines_dirty[0] = context->sprite_lines_dirty[1] = 0xFFFFFFFFFFFFFFFFULL;
+		}
 		context->sprite_index &= 0x7F;
 		//TODO: Implement squirelly behavior documented by Kabuto
 		if (context->sprite_index >= context->max_sprites_frame) {
@@ -578,11 +634,8 @@ static void scan_sprite_table(uint32_t line, vdp_context * context)
 		uint16_t address = context->sprite_index * 4;
 		line += ymin;
 		line &= ymask;
-		uint16_t y = ((context->sat_cache[address] & 0x3) << 8 | context->sat_cache[address+1]) & ymask;
-		uint8_t height = ((context->sat_cache[address+2] & 0x3) + 1) * height_mult;
-		//printf("Sprite %d | y: %d, height: %d\n", context->sprite_index, y, height);
-		if (y <= line && line < (y + height)) {
-			//printf("Sprite %d at y: %d with height %d is on line %d\n", context->sprite_index, y, height, line);
+		if (sprite_on_line(context, context->sprite_index, line, ymask, height_mult)) {
+			//printf("Sprite %d is on line %d\n", context->sprite_index, line);
 			context->sprite_info_list[context->slot_counter].size = context->sat_cache[address+2];
 			context->sprite_info_list[context->slot_counter++].index = context->sprite_index;
 		}
@@ -595,11 +648,8 @@ static void scan_sprite_table(uint32_t line, vdp_context * context)
 				return;
 			}
 			address = context->sprite_index * 4;
-			y = ((context->sat_cache[address] & 0x3) << 8 | context->sat_cache[address+1]) & ymask;
-			height = ((context->sat_cache[address+2] & 0x3) + 1) * height_mult;
-			//printf("Sprite %d | y: %d, height: %d\n", context->sprite_index, y, height);
-			if (y <= line && line < (y + height)) {
-				//printf("Sprite %d at y: %d with height %d is on line %d\n", context->sprite_index, y, height, line);
+			if (sprite_on_line(context, context->sprite_index, line, ymask, height_mult)) {
+				//printf("Sprite %d is on line %d\n", context->sprite_index, line);
 				context->sprite_info_list[context->slot_counter].size = context->sat_cache[address+2];
 				context->sprite_info_list[context->slot_counter++].index = context->sprite_index;
 			}
@@ -785,6 +835,7 @@ static void update_color_map(vdp_context *context, uint16_t index, uint16_t valu
 
 void write_cram_internal(vdp_context * context, uint16_t addr, uint16_t value)
 {
+	context->frame_writes |= FRAME_WRITES_CUR;
 	context->cram[addr] = value;
 	update_color_map(context, addr, value);
 }
@@ -806,7 +857,7 @@ static void write_cram(vdp_context * context, uint16_t address, uint16_t value)
 	)) {
 		uint8_t bg_end_slot = BG_START_SLOT + (context->regs[REG_MODE_4] & BIT_H40) ? LINEBUF_SIZE/2 : (256+HORIZ_BORDER)/2;
 		if (context->hslot < bg_end_slot) {
-			uint32_t color = (context->regs[REG_MODE_2] & BIT_MODE_5) ? context->colors[addr] : context->colors[addr + CRAM_SIZE*3];
+			pixel_t color = (context->regs[REG_MODE_2] & BIT_MODE_5) ? context->colors[addr] : context->colors[addr + CRAM_SIZE*3];
 			context->output[(context->hslot - BG_START_SLOT)*2 + 1] = color;
 		}
 	}
@@ -838,6 +889,10 @@ static void vdp_check_update_sat(vdp_context *context, uint32_t address, uint16_
 				cache_address = (cache_address & 3) | (cache_address >> 1 & 0x1FC);
 				context->sat_cache[cache_address] = value >> 8;
 				context->sat_cache[cache_address^1] = value;
+				if ((cache_address & 3) < 3) {
+					uint8_t sprite = cache_address >> 2;
+					context->sprite_lines_dirty[sprite >> 6] |= 1ULL << (sprite & 63);
+				}
 			}
 		}
 	}
@@ -852,6 +907,10 @@ void vdp_check_update_sat_byte(vdp_context *context, uint32_t address, uint8_t v
 				uint16_t cache_address = address - sat_address;
 				cache_address = (cache_address & 3) | (cache_address >> 1 & 0x1FC);
 				context->sat_cache[cache_address] = value;
+				if ((cache_address & 3) < 3) {
+					uint8_t sprite = cache_address >> 2;
+					context->sprite_lines_dirty[sprite >> 6] |= 1ULL << (sprite & 63);
+				}
 			}
 		}
 	}
@@ -887,6 +946,7 @@ static void external_slot(vdp_context * context)
 	}
 	fifo_entry * start = context->fifo + context->fifo_read;
 	if (context->fifo_read >= 0 && start->cycle <= context->cycles) {
+		context->frame_writes |= FRAME_WRITES_CUR;
 		switch (start->cd & 0xF)
 		{
 		case VRAM_WRITE:
@@ -952,6 +1012,7 @@ static void external_slot(vdp_context * context)
 		}
 	} else if ((context->flags & FLAG_DMA_RUN) && (context->regs[REG_DMASRC_H] & 0xC0) == 0xC0) {
 		if (context->flags & FLAG_READ_FETCHED) {
+			context->frame_writes |= FRAME_WRITES_CUR;
 			write_vram_byte(context, context->address ^ 1, context->prefetch);
 			
 			//Update DMA state
@@ -1029,7 +1090,7 @@ static void run_dma_src(vdp_context * context, int32_t slot)
 			cur = context->fifo + context->fifo_write;
 			cur->cycle = context->cycles + ((context->regs[REG_MODE_4] & BIT_H40) ? 16 : 20)*FIFO_LATENCY;
 			cur->address = context->address;
-			cur->value = read_dma_value((context->regs[REG_DMASRC_H] << 16) | (context->regs[REG_DMASRC_M] << 8) | context->regs[REG_DMASRC_L]);
+			cur->value = read_dma_value(context->system, (context->regs[REG_DMASRC_H] << 16) | (context->regs[REG_DMASRC_M] << 8) | context->regs[REG_DMASRC_L]);
 			cur->cd = context->cd;
 			cur->partial = 0;
 			if (context->fifo_read < 0) {
@@ -1274,7 +1335,7 @@ static void fetch_map_mode4(uint16_t col, uint32_t line, vdp_context *context)
 
 static void render_map_output(uint32_t line, int32_t col, vdp_context * context)
 {
-	uint32_t *dst;
+	pixel_t *dst;
 	uint8_t output_disabled = (context->test_port & TEST_BIT_DISABLE) != 0;
 	uint8_t test_layer = context->test_port >> 7 & 3;
 	if (context->state == PREPARING && !test_layer) {
@@ -1283,7 +1344,7 @@ static void render_map_output(uint32_t line, int32_t col, vdp_context * context)
 			dst = context->output + BORDER_LEFT + col * 8;
 		} else {
 			dst = context->output;
-			uint32_t bg_color = context->colors[context->regs[REG_BG_COLOR] & 0x3F];
+			pixel_t bg_color = context->colors[context->regs[REG_BG_COLOR] & 0x3F];
 			for (int i = 0; i < BORDER_LEFT; i++, dst++)
 			{
 				*dst = bg_color;
@@ -1291,7 +1352,7 @@ static void render_map_output(uint32_t line, int32_t col, vdp_context * context)
 			context->done_output = dst;
 			return;
 		}
-		uint32_t color = context->colors[context->regs[REG_BG_COLOR] & 0x3F];
+		pixel_t color = context->colors[context->regs[REG_BG_COLOR] & 0x3F];
 		for (int i = 0; i < 16; i++)
 		{
 			*(dst++) = color;
@@ -1325,7 +1386,7 @@ static void render_map_output(uint32_t line, int32_t col, vdp_context * context)
 					plane_a = context->tmp_buf_a + (plane_a_off & SCROLL_BUFFER_MASK);
 					plane_b = context->tmp_buf_b + (plane_b_off & SCROLL_BUFFER_MASK);
 					uint8_t pixel = context->regs[REG_BG_COLOR];
-					uint32_t *colors = context->colors;
+					pixel_t *colors = context->colors;
 					src = DBG_SRC_BG;
 					if (*plane_b & 0xF) {
 						pixel = *plane_b;
@@ -1386,7 +1447,7 @@ static void render_map_output(uint32_t line, int32_t col, vdp_context * context)
 						break;
 					}
 
-					uint32_t outpixel;
+					pixel_t outpixel;
 					if (context->debug) {
 						outpixel = context->debugcolors[src];
 					} else {
@@ -1438,7 +1499,7 @@ static void render_map_output(uint32_t line, int32_t col, vdp_context * context)
 						}
 						break;
 					}
-					uint32_t outpixel;
+					pixel_t outpixel;
 					if (context->debug) {
 						outpixel = context->debugcolors[src];
 					} else {
@@ -1497,7 +1558,7 @@ static void render_map_output(uint32_t line, int32_t col, vdp_context * context)
 		if (output_disabled) {
 			pixel = 0x3F;
 		}
-		uint32_t bg_color = context->colors[pixel];
+		pixel_t bg_color = context->colors[pixel];
 		if (test_layer) {
 			switch(test_layer)
 			{
@@ -1587,7 +1648,7 @@ static void render_map_mode4(uint32_t line, int32_t col, vdp_context * context)
 	context->buf_a_off = (context->buf_a_off + 8) & 15;
 	
 	uint8_t bgcolor = 0x10 | (context->regs[REG_BG_COLOR] & 0xF) + CRAM_SIZE*3;
-	uint32_t *dst = context->output + col * 8 + BORDER_LEFT;
+	pixel_t *dst = context->output + col * 8 + BORDER_LEFT;
 	if (context->state == PREPARING) {
 		for (int i = 0; i < 16; i++)
 		{
@@ -1701,6 +1762,7 @@ static void vdp_advance_line(vdp_context *context)
 	context->vcounter &= 0x1FF;
 	if (context->state == PREPARING) {
 		context->state = ACTIVE;
+		context->timing_serial++;
 	}
 	if (context->vcounter == 0x1FF) {
 		context->flags2 &= ~FLAG2_PAUSE;
@@ -1714,6 +1776,7 @@ static void vdp_advance_line(vdp_context *context)
 		context->flags2 |= FLAG2_HINT_PENDING;
 		context->pending_hint_start = context->cycles;
 		context->hint_counter = context->regs[REG_HINT];
+		context->timing_serial++;
 	}
 }
 
@@ -1730,6 +1793,9 @@ static void advance_output_line(vdp_context *context)
 			: 224 + BORDER_TOP_V28 + BORDER_BOT_V28;
 
 		if (context->output_lines == lines_max) {
+			//a frame only repeats the previous one if nothing that affects rendering was written during either
+			context->frame_unchanged = !context->frame_writes && !context->test_port;
+			context->frame_writes = (context->frame_writes & FRAME_WRITES_CUR) ? FRAME_WRITES_PREV : 0;
 			render_framebuffer_updated(context->cur_buffer, context->h40_lines > (context->inactive_start + context->border_top) / 2 ? LINEBUF_SIZE : (256+HORIZ_BORDER));
 			context->cur_buffer = context->flags2 & FLAG2_EVEN_FIELD ? FRAMEBUFFER_EVEN : FRAMEBUFFER_ODD;
 			context->fb = render_get_framebuffer(context->cur_buffer, &context->output_pitch);
@@ -1754,7 +1820,7 @@ static void advance_output_line(vdp_context *context)
 		} else {
 			output_line = INVALID_LINE;
 		}
-		context->output = (uint32_t *)(((char *)context->fb) + context->output_pitch * output_line);
+		context->output = (pixel_t *)(((char *)context->fb) + context->output_pitch * output_line);
 		context->done_output = context->output;
 #ifdef DEBUG_FB_FILL
 		for (int i = 0; i < LINEBUF_SIZE; i++)
@@ -1781,9 +1847,9 @@ void vdp_reacquire_framebuffer(vdp_context *context)
 			? 240 + BORDER_TOP_V30_PAL + BORDER_BOT_V30_PAL
 			: 224 + BORDER_TOP_V28 + BORDER_BOT_V28;
 	if (context->output_lines <= lines_max && context->output_lines > 0) {
-		context->output = (uint32_t *)(((char *)context->fb) + context->output_pitch * (context->output_lines - 1));
+		context->output = (pixel_t *)(((char *)context->fb) + context->output_pitch * (context->output_lines - 1));
 	} else {
-		context->output = (uint32_t *)(((char *)context->fb) + context->output_pitch * INVALID_LINE);
+		context->output = (pixel_t *)(((char *)context->fb) + context->output_pitch * INVALID_LINE);
 	}
 }
 
@@ -1800,12 +1866,12 @@ static void render_border_garbage(vdp_context *context, uint32_t address, uint8_
 
 static void draw_right_border(vdp_context *context)
 {
-	uint32_t *dst = context->output + BORDER_LEFT + ((context->regs[REG_MODE_4] & BIT_H40) ? 320 : 256);
+	pixel_t *dst = context->output + BORDER_LEFT + ((context->regs[REG_MODE_4] & BIT_H40) ? 320 : 256);
 	uint8_t pixel = context->regs[REG_BG_COLOR] & 0x3F;
 	if ((context->test_port & TEST_BIT_DISABLE) != 0) {
 		pixel = 0x3F;
 	}
-	uint32_t bg_color = context->colors[pixel];
+	pixel_t bg_color = context->colors[pixel];
 	uint8_t test_layer = context->test_port >> 7 & 3;
 	if (test_layer) {
 		switch(test_layer)
@@ -2041,8 +2107,8 @@ static void draw_right_border(vdp_context *context)
 		MODE4_CHECK_SLOT_LINE(CALC_SLOT(slot, 2))\
 	case CALC_SLOT(slot, 3):\
 		if ((slot + 3) == 140) {\
-			uint32_t *dst = context->output + BORDER_LEFT + 256 + 8;\
-			uint32_t bgcolor = context->colors[0x10 | (context->regs[REG_BG_COLOR] & 0xF) + CRAM_SIZE*3];\
+			pixel_t *dst = context->output + BORDER_LEFT + 256 + 8;\
+			pixel_t bgcolor = context->colors[0x10 | (context->regs[REG_BG_COLOR] & 0xF) + CRAM_SIZE*3];\
 			for (int i = 0; i < BORDER_RIGHT-8; i++, dst++)\
 			{\
 				*dst = bgcolor;\
@@ -2077,8 +2143,8 @@ static void vdp_h40(vdp_context * context, uint32_t target_cycles)
 			context->vscroll_latch[1] = context->vsram[1];
 		}
 		if (context->state == PREPARING) {
-			uint32_t bg_color = context->colors[context->regs[REG_BG_COLOR] & 0x3F];
-			uint32_t *dst = context->output + (context->hslot - BG_START_SLOT) * 2;
+			pixel_t bg_color = context->colors[context->regs[REG_BG_COLOR] & 0x3F];
+			pixel_t *dst = context->output + (context->hslot - BG_START_SLOT) * 2;
 			if (dst >= context->done_output) {
 				*dst = bg_color;
 			}
@@ -2093,8 +2159,8 @@ static void vdp_h40(vdp_context * context, uint32_t target_cycles)
 		CHECK_LIMIT
 	case 166:
 		if (context->state == PREPARING) {
-			uint32_t bg_color = context->colors[context->regs[REG_BG_COLOR] & 0x3F];
-			uint32_t *dst = context->output + (context->hslot - BG_START_SLOT) * 2;
+			pixel_t bg_color = context->colors[context->regs[REG_BG_COLOR] & 0x3F];
+			pixel_t *dst = context->output + (context->hslot - BG_START_SLOT) * 2;
 			if (dst >= context->done_output) {
 				*dst = bg_color;
 			}
@@ -2115,8 +2181,8 @@ static void vdp_h40(vdp_context * context, uint32_t target_cycles)
 	//sprite attribute table scan starts
 	case 167:
 		if (context->state == PREPARING) {
-			uint32_t bg_color = context->colors[context->regs[REG_BG_COLOR] & 0x3F];
-			uint32_t *dst = context->output + (context->hslot - BG_START_SLOT) * 2;
+			pixel_t bg_color = context->colors[context->regs[REG_BG_COLOR] & 0x3F];
+			pixel_t *dst = context->output + (context->hslot - BG_START_SLOT) * 2;
 			for (int i = 0; i < LINEBUF_SIZE - 2 * (context->hslot - BG_START_SLOT); i++, dst++)
 			{
 				if (dst >= context->done_output) {
@@ -2294,8 +2360,8 @@ static void vdp_h32(vdp_context * context, uint32_t target_cycles)
 	{
 	case 133:
 		if (context->state == PREPARING) {
-			uint32_t bg_color = context->colors[context->regs[REG_BG_COLOR] & 0x3F];
-			uint32_t *dst = context->output + (context->hslot - BG_START_SLOT) * 2;
+			pixel_t bg_color = context->colors[context->regs[REG_BG_COLOR] & 0x3F];
+			pixel_t *dst = context->output + (context->hslot - BG_START_SLOT) * 2;
 			if (dst >= context->done_output) {
 				*dst = bg_color;
 			}
@@ -2310,8 +2376,8 @@ static void vdp_h32(vdp_context * context, uint32_t target_cycles)
 		CHECK_LIMIT
 	case 134:
 		if (context->state == PREPARING) {
-			uint32_t bg_color = context->colors[context->regs[REG_BG_COLOR] & 0x3F];
-			uint32_t *dst = context->output + (context->hslot - BG_START_SLOT) * 2;
+			pixel_t bg_color = context->colors[context->regs[REG_BG_COLOR] & 0x3F];
+			pixel_t *dst = context->output + (context->hslot - BG_START_SLOT) * 2;
 			if (dst >= context->done_output) {
 				*dst = bg_color;
 			}
@@ -2332,8 +2398,8 @@ static void vdp_h32(vdp_context * context, uint32_t target_cycles)
 	//sprite attribute table scan starts
 	case 135:
 		if (context->state == PREPARING) {
-			uint32_t bg_color = context->colors[context->regs[REG_BG_COLOR] & 0x3F];
-			uint32_t *dst = context->output + (context->hslot - BG_START_SLOT) * 2;
+			pixel_t bg_color = context->colors[context->regs[REG_BG_COLOR] & 0x3F];
+			pixel_t *dst = context->output + (context->hslot - BG_START_SLOT) * 2;
 			for (int i = 0; i < (256+HORIZ_BORDER) - 2 * (context->hslot - BG_START_SLOT); i++)
 			{
 				if (dst >= context->done_output) {
@@ -2561,8 +2627,8 @@ static void vdp_h32_mode4(vdp_context * context, uint32_t target_cycles)
 		CHECK_LIMIT
 	case 0: {
 		scan_sprite_table_mode4(context);
-		uint32_t *dst = context->output;;
-		uint32_t bgcolor = context->colors[0x10 | (context->regs[REG_BG_COLOR] & 0xF) + CRAM_SIZE*3];
+		pixel_t *dst = context->output;;
+		pixel_t bgcolor = context->colors[0x10 | (context->regs[REG_BG_COLOR] & 0xF) + CRAM_SIZE*3];
 		for (int i = 0; i < BORDER_LEFT-8; i++, dst++)
 		{
 			*dst = bgcolor;
@@ -2583,8 +2649,8 @@ static void vdp_h32_mode4(vdp_context * context, uint32_t target_cycles)
 		scan_sprite_table_mode4(context);
 		context->buf_a_off = 8;
 		memset(context->tmp_buf_a, 0, 8);
-		uint32_t *dst = context->output + BORDER_LEFT - 8;
-		uint32_t bgcolor = context->colors[0x10 | (context->regs[REG_BG_COLOR] & 0xF) + CRAM_SIZE*3];
+		pixel_t *dst = context->output + BORDER_LEFT - 8;
+		pixel_t bgcolor = context->colors[0x10 | (context->regs[REG_BG_COLOR] & 0xF) + CRAM_SIZE*3];
 		for (int i = 0; i < 8; i++, dst++)
 		{
 			*dst = bgcolor;
@@ -2639,8 +2705,8 @@ static void vdp_h32_mode4(vdp_context * context, uint32_t target_cycles)
 		memset(context->linebuf, 0, LINEBUF_SIZE);
 		context->cur_slot = context->sprite_index = MAX_DRAWS_H32_MODE4-1;
 		context->sprite_draws = MAX_DRAWS_H32_MODE4;
-		uint32_t *dst = context->output + BORDER_LEFT + 256;
-		uint32_t bgcolor = context->colors[0x10 | (context->regs[REG_BG_COLOR] & 0xF) + CRAM_SIZE*3];
+		pixel_t *dst = context->output + BORDER_LEFT + 256;
+		pixel_t bgcolor = context->colors[0x10 | (context->regs[REG_BG_COLOR] & 0xF) + CRAM_SIZE*3];
 		for (int i = 0; i < 8; i++, dst++)
 		{
 			*dst = bgcolor;
@@ -2660,7 +2726,7 @@ static void inactive_test_output(vdp_context *context, uint8_t is_h40, uint8_t t
 	if (context->hslot > max_slot) {
 		return;
 	}
-	uint32_t *dst = context->output + (context->hslot >> 3) * SCROLL_BUFFER_DRAW;
+	pixel_t *dst = context->output + (context->hslot >> 3) * SCROLL_BUFFER_DRAW;
 	int32_t len;
 	uint32_t src_off;
 	if (context->hslot) {
@@ -2701,7 +2767,42 @@ static void check_switch_inactive(vdp_context *context, uint8_t is_h40)
 	//technically the second hcounter check should be different for H40, but this is probably close enough for now
 	if (context->state == ACTIVE && context->vcounter == context->inactive_start && (context->hslot >= (is_h40 ? 167 : 135) || context->hslot < 133)) {
 		context->state = INACTIVE;
+		context->timing_serial++;
+	}
+}
+
+static pixel_t *inactive_bg_pixels(vdp_context *context, pixel_t *dst, pixel_t bg_color)
+{
+	if (dst >= context->done_output) {
+		*(dst++) = bg_color;
+	} else {
+		dst++;
 	}
+	if (dst >= context->done_output) {
+		*(dst++) = bg_color;
+		context->done_output = dst;
+	} else {
+		dst++;
+	}
+	return dst;
+}
+
+static void inactive_slot_cycles(vdp_context *context, uint8_t is_h40)
+{
+	if (is_h40) {
+		if (context->hslot >= HSYNC_SLOT_H40 && context->hslot < HSYNC_END_H40) {
+			context->cycles += h40_hsync_cycles[context->hslot - HSYNC_SLOT_H40];
+		} else {
+			context->cycles += MCLKS_SLOT_H40;
+		}
+	} else {
+		context->cycles += MCLKS_SLOT_H32;
+	}
+}
+
+static void mark_slot(uint64_t *slots, uint8_t slot)
+{
+	slots[slot >> 6] |= 1ULL << (slot & 63);
 }
 
 static void vdp_inactive(vdp_context *context, uint32_t target_cycles, uint8_t is_h40, uint8_t mode_5)
@@ -2709,7 +2810,7 @@ static void vdp_inactive(vdp_context *context, uint32_t target_cycles, uint8_t i
 	uint8_t buf_clear_slot, index_reset_slot, bg_end_slot, vint_slot, line_change, jump_start, jump_dest, latch_slot;
 	uint8_t index_reset_value, max_draws, max_sprites;
 	uint16_t vint_line, active_line;
-	uint32_t bg_color;
+	pixel_t bg_color;
 
 	if (mode_5) {
 		if (is_h40) {
@@ -2763,7 +2864,7 @@ static void vdp_inactive(vdp_context *context, uint32_t target_cycles, uint8_t i
 			active_line = 0x200;
 		}
 	}
-	uint32_t *dst = (
+	pixel_t *dst = (
 		context->vcounter < context->inactive_start + context->border_bot 
 		|| context->vcounter >= 0x200 - context->border_top
 	) && context->hslot >= BG_START_SLOT && context->hslot < bg_end_slot
@@ -2782,8 +2883,43 @@ static void vdp_inactive(vdp_context *context, uint32_t target_cycles, uint8_t i
 		dst = NULL;
 	}
 	
+	//Outside of the slots marked here, a Mode 5 blanked line does nothing but service the FIFO/DMA
+	//and fill the background so those slots can skip the per-slot event checks below
+	uint64_t special_slots[4] = {0, 0, 0, 0};
+	uint8_t bulk = mode_5 && !test_layer;
+	if (bulk) {
+		mark_slot(special_slots, buf_clear_slot);
+		mark_slot(special_slots, index_reset_slot);
+		mark_slot(special_slots, latch_slot);
+		mark_slot(special_slots, vint_slot);
+		mark_slot(special_slots, 1);
+		mark_slot(special_slots, BG_START_SLOT);
+		mark_slot(special_slots, bg_end_slot - 1);
+		mark_slot(special_slots, bg_end_slot);
+		mark_slot(special_slots, jump_start);
+		mark_slot(special_slots, line_change - 1);
+	}
+	
 	while(context->cycles < target_cycles)
 	{
+		if (
+			bulk && !(special_slots[context->hslot >> 6] & 1ULL << (context->hslot & 63))
+			&& (context->state != ACTIVE || context->vcounter != context->inactive_start)
+		) {
+			context->serial_address += 1024;
+			if (dst) {
+				dst = inactive_bg_pixels(context, dst, context->colors[context->regs[REG_BG_COLOR] & 0x3F]);
+			}
+			if (!is_refresh(context, context->hslot)) {
+				external_slot(context);
+				if (context->flags & FLAG_DMA_RUN) {
+					run_dma_src(context, context->hslot);
+				}
+			}
+			inactive_slot_cycles(context, is_h40);
+			context->hslot++;
+			continue;
+		}
 		check_switch_inactive(context, is_h40);
 		if (context->hslot == BG_START_SLOT && !test_layer && (
 			context->vcounter < context->inactive_start + context->border_bot 
@@ -2838,8 +2974,10 @@ static void vdp_inactive(vdp_context *context, uint32_t target_cycles, uint8_t i
 		} else if (context->vcounter == vint_line && context->hslot == vint_slot) {
 			context->flags2 |= FLAG2_VINT_PENDING;
 			context->pending_vint_start = context->cycles;
+			context->timing_serial++;
 		} else if (context->vcounter == context->inactive_start && context->hslot == 1 && (context->regs[REG_MODE_4] & BIT_INTERLACE)) {
 			context->flags2 ^= FLAG2_EVEN_FIELD;
+			context->frame_writes |= FRAME_WRITES_CUR;
 		}
 		
 		if (dst) {
@@ -2848,17 +2986,7 @@ static void vdp_inactive(vdp_context *context, uint32_t target_cycles, uint8_t i
 			} else if (context->regs[REG_MODE_1] & BIT_MODE_4) {
 				bg_color = context->colors[CRAM_SIZE * 3 + 0x10 + (context->regs[REG_BG_COLOR] & 0xF)];
 			}
-			if (dst >= context->done_output) {
-				*(dst++) = bg_color;
-			} else {
-				dst++;
-			}
-			if (dst >= context->done_output) {
-				*(dst++) = bg_color;
-				context->done_output = dst;
-			} else {
-				dst++;
-			}
+			dst = inactive_bg_pixels(context, dst, bg_color);
 			if (context->hslot == (bg_end_slot-1)) {
 				*(dst++) = bg_color;
 				context->done_output = dst;
@@ -2872,15 +3000,7 @@ static void vdp_inactive(vdp_context *context, uint32_t target_cycles, uint8_t i
 			}
 		}
 		
-		if (is_h40) {
-			if (context->hslot >= HSYNC_SLOT_H40 && context->hslot < HSYNC_END_H40) {
-				context->cycles += h40_hsync_cycles[context->hslot - HSYNC_SLOT_H40];
-			} else {
-				context->cycles += MCLKS_SLOT_H40;
-			}
-		} else {
-			context->cycles += MCLKS_SLOT_H32;
-		}
+		inactive_slot_cycles(context, is_h40);
 		if (context->hslot == jump_start) {
 			context->hslot = jump_dest;
 		} else {
@@ -2890,6 +3010,7 @@ static void vdp_inactive(vdp_context *context, uint32_t target_cycles, uint8_t i
 			vdp_advance_line(context);
 			if (context->vcounter == active_line) {
 				context->state = PREPARING;
+				context->timing_serial++;
 				return;
 			}
 		}
@@ -3009,6 +3130,7 @@ uint16_t vdp_hv_counter_read(vdp_context * context)
 int vdp_control_port_write(vdp_context * context, uint16_t value)
 {
 	//printf("control port write: %X at %d\n", value, context->cycles);
+	context->timing_serial++;
 	if (context->flags & FLAG_DMA_RUN) {
 		return -1;
 	}
@@ -3063,6 +3185,9 @@ int vdp_control_port_write(vdp_context * context, uint16_t value)
 				/*if (reg == REG_MODE_4 && ((value ^ context->regs[reg]) & BIT_H40)) {
 					printf("Mode changed from H%d to H%d @ %d, frame: %d\n", context->regs[reg] & BIT_H40 ? 40 : 32, value & BIT_H40 ? 40 : 32, context->cycles, context->frame);
 				}*/
+				if (context->regs[reg] != (uint8_t)value) {
+					context->frame_writes |= FRAME_WRITES_CUR;
+				}
 				context->regs[reg] = value;
 				if (reg == REG_MODE_4) {
 					context->double_res = (value & (BIT_INTERLACE | BIT_DOUBLE_RES)) == (BIT_INTERLACE | BIT_DOUBLE_RES);
@@ -3180,6 +3305,7 @@ void vdp_data_port_write_pbc(vdp_context * context, uint8_t value)
 void vdp_test_port_write(vdp_context * context, uint16_t value)
 {
 	context->test_port = value;
+	context->frame_writes |= FRAME_WRITES_CUR;
 }
 
 uint16_t vdp_control_port_read(vdp_context * context)
@@ -3267,6 +3393,7 @@ uint16_t vdp_test_port_read(vdp_context * context)
 void vdp_adjust_cycles(vdp_context * context, uint32_t deduction)
 {
 	context->cycles -= deduction;
+	context->timing_serial++;
 	if (context->pending_vint_start >= deduction) {
 		context->pending_vint_start -= deduction;
 	} else {
@@ -3539,6 +3666,7 @@ void vdp_pbc_pause(vdp_context *context)
 
 void vdp_int_ack(vdp_context * context)
 {
+	context->timing_serial++;
 	//CPU interrupt acknowledge is only used in Mode 5
 	if (context->regs[REG_MODE_2] & BIT_MODE_5) {
 		//Apparently the VDP interrupt controller is not very smart
@@ -3649,6 +3777,8 @@ void vdp_deserialize(deserialize_buffer *buf, void *vcontext)
 	}
 	load_buffer16(buf, context->vsram, VSRAM_SIZE);
 	load_buffer8(buf, context->sat_cache, SAT_CACHE_SIZE);
+	context->sprite_lines_dirty[0] = context->sprite_lines_dirty[1] = 0xFFFFFFFFFFFFFFFFULL;
+	context->frame_writes = FRAME_WRITES_CUR | FRAME_WRITES_PREV;
 	for (int i = 0; i <= REG_DMASRC_H; i++)
 	{
 		context->regs[i] = load_int8(buf);
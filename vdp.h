@@ -11,6 +11,13 @@
 #include "system.h"
 #include "serialize.h"
 
+//RENDER_RGB565 switches VDP output to 16-bit RGB565 pixels to halve framebuffer bandwidth
+#ifdef RENDER_RGB565
+typedef uint16_t pixel_t;
+#else
+typedef uint32_t pixel_t;
+#endif
+
 #define VDP_REGS 24
 #define CRAM_SIZE 64
 #define VSRAM_SIZE 40
@@ -20,6 +27,7 @@
 #define HORIZ_BORDER (BORDER_LEFT+BORDER_RIGHT)
 #define LINEBUF_SIZE (320+HORIZ_BORDER) //H40 + full border
 #define BORDER_BOTTOM 13 //TODO: Replace with actual value
+#define INVALID_LINE 0x200 //output line used for lines outside of the visible area, renderers must provide a buffer that covers it
 #define MAX_DRAWS 40
 #define MAX_DRAWS_H32 32
 #define MAX_DRAWS_H32_MODE4 8
@@ -28,6 +36,7 @@
 #define MAX_SPRITES_FRAME 80
 #define MAX_SPRITES_FRAME_H32 64
 #define SAT_CACHE_SIZE (MAX_SPRITES_FRAME * 4)
+#define SPRITE_INDEX_LINES 1024
 
 #define FBUF_SHADOW 0x0001
 #define FBUF_HILIGHT 0x0010
@@ -62,6 +71,9 @@
 #define FLAG2_BYTE_PENDING   0x40
 #define FLAG2_PAUSE          0x80
 
+#define FRAME_WRITES_CUR  0x01
+#define FRAME_WRITES_PREV 0x02
+
 #define DISPLAY_ENABLE 0x40
 
 enum {
@@ -160,17 +172,22 @@ typedef struct {
 	uint32_t    cycles;
 	uint32_t    pending_vint_start;
 	uint32_t    pending_hint_start;
+	//bumped whenever state feeding vdp_next_hint/vdp_next_vint/vdp_cycles_to_frame_end changes
+	//other than the normal passage of time, lets callers cache those results
+	uint32_t    timing_serial;
+	uint8_t     frame_writes;    //FRAME_WRITES_* bits for writes that can change the rendered output
+	uint8_t     frame_unchanged; //set when the last completed frame is identical to the one before it
 	uint8_t     *vdpmem;
 	//stores 2-bit palette + 4-bit palette index + priority for current sprite line
 	uint8_t     *linebuf;
 	//pointer to current line in framebuffer
-	uint32_t    *output;
-	uint32_t    *done_output;
-	uint32_t    *fb;
+	pixel_t     *output;
+	pixel_t     *done_output;
+	pixel_t     *fb;
 	system_header  *system;
 	uint16_t    cram[CRAM_SIZE];
-	uint32_t    colors[CRAM_SIZE*4];
-	uint32_t    debugcolors[1 << (3 + 1 + 1 + 1)];//3 bits for source, 1 bit for priority, 1 bit for shadow, 1 bit for hilight
+	pixel_t     colors[CRAM_SIZE*4];
+	pixel_t     debugcolors[1 << (3 + 1 + 1 + 1)];//3 bits for source, 1 bit for priority, 1 bit for shadow, 1 bit for hilight
 	uint16_t    vsram[VSRAM_SIZE];
 	uint16_t    vscroll_latch[2];
 	uint32_t    output_pitch;
@@ -186,6 +203,12 @@ typedef struct {
 	sprite_draw sprite_draw_list[MAX_DRAWS];
 	sprite_info sprite_info_list[MAX_SPRITES_LINE];
 	uint8_t     sat_cache[SAT_CACHE_SIZE];
+	//per-line bitmaps of the sprites whose Y range covers that line, 2 words per line
+	uint64_t    *sprite_lines;
+	uint64_t    sprite_lines_dirty[2];
+	uint16_t    sprite_lines_y[MAX_SPRITES_FRAME];
+	uint16_t    sprite_lines_end[MAX_SPRITES_FRAME];
+	uint8_t     sprite_lines_double;
 	uint16_t    col_1;
 	uint16_t    col_2;
 	uint16_t    hv_latch;
@@ -215,6 +238,7 @@ typedef struct {
 } vdp_context;
 
 void init_vdp_context(vdp_context * context, uint8_t region_pal);
+void vdp_reset(vdp_context *context, uint8_t region_pal);
 void vdp_free(vdp_context *context);
 void vdp_run_context_full(vdp_context * context, uint32_t target_cycles);
 void vdp_run_context(vdp_context * context, uint32_t target_cycles);
@@ -6,6 +6,7 @@
 #include "tern.h"
 #include "xband.h"
 #include "util.h"
+#include "save_file.h"
 
 #define BIT_ROM_HI 4
 
@@ -325,7 +326,7 @@ rom_info xband_configure_rom(tern_node *rom_db, void *rom, uint32_t rom_size, vo
 		info.regions = REGION_J|REGION_U|REGION_E;
 	}
 	info.save_size = 64*1024;
-	info.save_buffer = malloc(info.save_size);
+	info.save_buffer = alloc_save_buffer(info.save_size, 0);
 	info.save_mask = info.save_size-1;
 	info.save_type = RAM_FLAG_BOTH;
 	info.port1_override = info.ext_override = info.mouse_mode = NULL;
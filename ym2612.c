@@ -163,6 +163,14 @@ void ym_reset(ym2612_context *context)
 	}
 }
 
+static void ym_set_lowpass(ym2612_context *context, uint32_t master_clock, uint32_t lowpass_cutoff)
+{
+	double rc = (1.0 / (double)lowpass_cutoff) / (2.0 * M_PI);
+	double dt = 1.0 / ((double)master_clock / (double)(context->clock_inc * NUM_OPERATORS));
+	double alpha = dt / (dt + rc);
+	context->lowpass_alpha = (int32_t)(((double)0x10000) * alpha);
+}
+
 void ym_init(ym2612_context * context, uint32_t sample_rate, uint32_t master_clock, uint32_t clock_div, uint32_t sample_limit, uint32_t options, uint32_t lowpass_cutoff)
 {
 	static uint8_t registered_finalize;
@@ -173,11 +181,7 @@ void ym_init(ym2612_context * context, uint32_t sample_rate, uint32_t master_clo
 	context->sample_rate = sample_rate;
 	context->clock_inc = clock_div * 6;
 	ym_adjust_master_clock(context, master_clock);
-	
-	double rc = (1.0 / (double)lowpass_cutoff) / (2.0 * M_PI);
-	double dt = 1.0 / ((double)master_clock / (double)(context->clock_inc * NUM_OPERATORS));
-	double alpha = dt / (dt + rc);
-	context->lowpass_alpha = (int32_t)(((double)0x10000) * alpha);
+	ym_set_lowpass(context, master_clock, lowpass_cutoff);
 
 	context->sample_limit = sample_limit*2;
 	
@@ -264,6 +268,25 @@ void ym_init(ym2612_context * context, uint32_t sample_rate, uint32_t master_clo
 	ym_reset(context);
 }
 
+//Returns the chip to its power on state without reallocating its buffers
+void ym_reinit(ym2612_context *context, uint32_t master_clock, uint32_t lowpass_cutoff)
+{
+	int16_t *audio_buffer = context->audio_buffer;
+	int16_t *back_buffer = context->back_buffer;
+	uint32_t sample_rate = context->sample_rate;
+	uint32_t clock_inc = context->clock_inc;
+	uint32_t sample_limit = context->sample_limit;
+	memset(context, 0, sizeof(*context));
+	context->audio_buffer = audio_buffer;
+	context->back_buffer = back_buffer;
+	context->sample_rate = sample_rate;
+	context->clock_inc = clock_inc;
+	context->sample_limit = sample_limit;
+	ym_adjust_master_clock(context, master_clock);
+	ym_set_lowpass(context, master_clock, lowpass_cutoff);
+	ym_reset(context);
+}
+
 void ym_free(ym2612_context *context)
 {
 	if (context == log_context) {
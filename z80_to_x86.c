@@ -323,6 +323,20 @@ void z80_print_regs_exit(z80_context * context)
 	exit(0);
 }
 
+//jumps back to the start of a block instruction for another iteration
+static void z80_jmp_repeat(z80_options *opts, code_ptr start, uint16_t address, uint8_t interp)
+{
+	code_info *code = &opts->gen.code;
+	if (interp) {
+		//go back through the interpreter stub so the opcode fetch is accounted for
+		mov_ir(code, address, opts->gen.scratch1, SZ_W);
+		call(code, opts->native_addr);
+		jmp_r(code, opts->gen.scratch1);
+	} else {
+		jmp(code, start);
+	}
+}
+
 void translate_z80inst(z80inst * inst, z80_context * context, uint16_t address, uint8_t interp)
 {
 	uint32_t num_cycles;
@@ -331,17 +345,20 @@ void translate_z80inst(z80inst * inst, z80_context * context, uint16_t address,
 	z80_options *opts = context->options;
 	uint8_t * start = opts->gen.code.cur;
 	code_info *code = &opts->gen.code;
-	if (!interp) {
+	if (interp) {
+		//interpreter stub has already handled the opcode fetch M-cycle and cycle check
+		num_cycles = 4 * (inst->opcode_bytes - 1);
+	} else {
 		check_cycles_int(&opts->gen, address);
 		if (context->breakpoint_flags[address / 8] & (1 << (address % 8))) {
 			zbreakpoint_patch(context, address, start);
 		}
 		num_cycles = 4 * inst->opcode_bytes;
-		add_ir(code, inst->opcode_bytes > 1 ? 2 : 1, opts->regs[Z80_R], SZ_B);
 #ifdef Z80_LOG_ADDRESS
 		log_address(&opts->gen, address, "Z80: %X @ %d\n");
 #endif
 	}
+	add_ir(code, inst->opcode_bytes > 1 ? 2 : 1, opts->regs[Z80_R], SZ_B);
 	switch(inst->op)
 	{
 	case Z80_LD:
@@ -628,7 +645,7 @@ void translate_z80inst(z80inst * inst, z80_context * context, uint16_t address,
 		jcc(code, CC_Z, code->cur+2);
 		cycles(&opts->gen, 7);
 		mov_irdisp(code, 1, opts->gen.context_reg, zf_off(ZF_PV), SZ_B);
-		jmp(code, start);
+		z80_jmp_repeat(opts, start, address, interp);
 		*cont = code->cur - (cont + 1);
 		cycles(&opts->gen, 2);
 		mov_irdisp(code, 0, opts->gen.context_reg, zf_off(ZF_PV), SZ_B);
@@ -704,7 +721,7 @@ void translate_z80inst(z80inst * inst, z80_context * context, uint16_t address,
 		jcc(code, CC_Z, code->cur+2);
 		cycles(&opts->gen, 7);
 		mov_irdisp(code, 1, opts->gen.context_reg, zf_off(ZF_PV), SZ_B);
-		jmp(code, start);
+		z80_jmp_repeat(opts, start, address, interp);
 		*cont = code->cur - (cont + 1);
 		cycles(&opts->gen, 2);
 		mov_irdisp(code, 0, opts->gen.context_reg, zf_off(ZF_PV), SZ_B);
@@ -784,7 +801,7 @@ void translate_z80inst(z80inst * inst, z80_context * context, uint16_t address,
 		jcc(code, CC_Z, code->cur+2);
 		//repeat case
 		cycles(&opts->gen, 5);//T-States 5
-		jmp(code, start);
+		z80_jmp_repeat(opts, start, address, interp);
 		*cont = code->cur - (cont + 1);
 		*cont2 = code->cur - (cont2 + 1);
 		break;
@@ -863,7 +880,7 @@ void translate_z80inst(z80inst * inst, z80_context * context, uint16_t address,
 		jcc(code, CC_Z, code->cur+2);
 		//repeat case
 		cycles(&opts->gen, 5);//T-States 5
-		jmp(code, start);
+		z80_jmp_repeat(opts, start, address, interp);
 		*cont = code->cur - (cont + 1);
 		*cont2 = code->cur - (cont2 + 1);
 		break;
@@ -1408,6 +1425,11 @@ void translate_z80inst(z80inst * inst, z80_context * context, uint16_t address,
 		cycles(&opts->gen, num_cycles);
 		break;
 	case Z80_HALT: {
+		if (interp) {
+			//first M-cycle was already handled by the interpreter stub
+			check_cycles_int(&opts->gen, address+1);
+			num_cycles = 4;
+		}
 		code_ptr loop_top = code->cur;
 		//this isn't terribly efficient, but it's good enough for now
 		cycles(&opts->gen, num_cycles);
@@ -2464,7 +2486,7 @@ void translate_z80inst(z80inst * inst, z80_context * context, uint16_t address,
 		code_ptr done = code->cur+1;
 		jcc(code, CC_Z, code->cur+2);
 		cycles(&opts->gen, 5);
-		jmp(code, start);
+		z80_jmp_repeat(opts, start, address, interp);
 		*done = code->cur - (done + 1);
 		break;
 	}
@@ -2589,7 +2611,7 @@ void translate_z80inst(z80inst * inst, z80_context * context, uint16_t address,
 		code_ptr done = code->cur+1;
 		jcc(code, CC_Z, code->cur+2);
 		cycles(&opts->gen, 5);
-		jmp(code, start);
+		z80_jmp_repeat(opts, start, address, interp);
 		*done = code->cur - (done + 1);
 		break;
 	}
@@ -2710,7 +2732,7 @@ void translate_z80inst(z80inst * inst, z80_context * context, uint16_t address,
 		code_ptr done = code->cur+1;
 		jcc(code, CC_Z, code->cur+2);
 		cycles(&opts->gen, 5);
-		jmp(code, start);
+		z80_jmp_repeat(opts, start, address, interp);
 		*done = code->cur - (done + 1);
 		break;
 	}
@@ -2810,7 +2832,7 @@ void translate_z80inst(z80inst * inst, z80_context * context, uint16_t address,
 		code_ptr done = code->cur+1;
 		jcc(code, CC_Z, code->cur+2);
 		cycles(&opts->gen, 5);
-		jmp(code, start);
+		z80_jmp_repeat(opts, start, address, interp);
 		*done = code->cur - (done + 1);
 		break;
 	}
@@ -2825,48 +2847,108 @@ void translate_z80inst(z80inst * inst, z80_context * context, uint16_t address,
 	}
 }
 
+//Technically unbounded due to redundant prefixes, but this is the max useful size
+#define Z80_MAX_INST_SIZE 4
+
+//Reads the operand bytes of an instruction being interpreted
+//Bus cycles for these are accounted for in translate_z80inst like they would be for translated code
+static uint8_t z80_interp_read_byte(z80_context * context, uint16_t address)
+{
+	z80_options *opts = context->options;
+	memmap_chunk const *chunk = find_map_chunk(address, &opts->gen, 0, NULL);
+	if (!chunk) {
+		return 0xFF;
+	}
+	uint32_t offset = address & chunk->mask;
+	if (chunk->flags & MMAP_READ) {
+		uint8_t *base = chunk->flags & MMAP_PTR_IDX ? context->mem_pointers[chunk->ptr_index] : chunk->buffer;
+		if (base) {
+			if (chunk->flags & MMAP_BYTESWAP) {
+				offset ^= 1;
+			}
+			return base[offset];
+		}
+	}
+	if (chunk->read_8) {
+		return chunk->read_8(offset, context);
+	}
+	return 0xFF;
+}
+
+#define Z80_INTERP_BUCKETS 256
+
+struct z80_interp_entry {
+	z80_interp_entry *next;
+	code_ptr         native;
+	uint32_t         encoded;
+	uint16_t         address;
+};
+
 uint8_t * z80_interp_handler(uint8_t opcode, z80_context * context)
 {
-	if (!context->interp_code[opcode]) {
-		if (opcode == 0xCB || (opcode >= 0xDD && (opcode & 0xF) == 0xD)) {
-			fatal_error("Encountered prefix byte %X at address %X. Z80 interpeter doesn't support those yet.", opcode, context->pc);
+	uint8_t codebuf[8];
+	memset(codebuf, 0, sizeof(codebuf));
+	codebuf[0] = opcode;
+	z80inst inst;
+	uint8_t fetched = 1, size;
+	//prefixes and operands can change the length of the instruction so keep decoding until all bytes are present
+	while ((size = z80_decode(codebuf, &inst) - codebuf) > fetched && fetched < Z80_MAX_INST_SIZE)
+	{
+		for (; fetched < size && fetched < Z80_MAX_INST_SIZE; fetched++)
+		{
+			codebuf[fetched] = z80_interp_read_byte(context, context->pc + fetched);
 		}
-		uint8_t codebuf[8];
-		memset(codebuf, 0, sizeof(codebuf));
-		codebuf[0] = opcode;
-		z80inst inst;
-		uint8_t * after = z80_decode(codebuf, &inst);
-		if (after - codebuf > 1) {
-			fatal_error("Encountered multi-byte Z80 instruction at %X. Z80 interpeter doesn't support those yet.", context->pc);
+	}
+	//context->pc is not preserved if we sync in the middle of an instruction
+	//so translations are specific to an address in addition to the instruction bytes
+	uint16_t address = context->pc;
+	uint32_t encoded = 0;
+	for (uint8_t i = 0; i < size; i++)
+	{
+		encoded |= codebuf[i] << (i * 8);
+	}
+	z80_options * opts = context->options;
+	if (!opts->interp_cache) {
+		opts->interp_cache = calloc(Z80_INTERP_BUCKETS, sizeof(z80_interp_entry *));
+	}
+	z80_interp_entry **bucket = opts->interp_cache + ((address ^ encoded ^ encoded >> 16) % Z80_INTERP_BUCKETS);
+	for (z80_interp_entry *cur = *bucket; cur; cur = cur->next)
+	{
+		if (cur->address == address && cur->encoded == encoded) {
+			return cur->native;
 		}
-
-		z80_options * opts = context->options;
-		code_info *code = &opts->gen.code;
-		check_alloc_code(code, ZMAX_NATIVE_SIZE);
-		context->interp_code[opcode] = code->cur;
-		translate_z80inst(&inst, context, 0, 1);
-		mov_rdispr(code, opts->gen.context_reg, offsetof(z80_context, pc), opts->gen.scratch1, SZ_W);
-		add_ir(code, after - codebuf, opts->gen.scratch1, SZ_W);
-		call(code, opts->native_addr);
-		jmp_r(code, opts->gen.scratch1);
-		z80_handle_deferred(context);
 	}
-	return context->interp_code[opcode];
+
+	code_info *code = &opts->gen.code;
+	check_alloc_code(code, ZMAX_NATIVE_SIZE);
+	z80_interp_entry *entry = malloc(sizeof(z80_interp_entry));
+	entry->native = code->cur;
+	entry->encoded = encoded;
+	entry->address = address;
+	entry->next = *bucket;
+	*bucket = entry;
+	translate_z80inst(&inst, context, address, 1);
+	mov_ir(code, (address + size) & 0xFFFF, opts->gen.scratch1, SZ_W);
+	call(code, opts->native_addr);
+	jmp_r(code, opts->gen.scratch1);
+	z80_handle_deferred(context);
+	return entry->native;
 }
 
 code_info z80_make_interp_stub(z80_context * context, uint16_t address)
 {
 	z80_options *opts = context->options;
 	code_info * code = &opts->gen.code;
-	check_alloc_code(code, 32);
+	check_alloc_code(code, 64);
 	code_info stub = {code->cur, NULL};
 	//TODO: make this play well with the breakpoint code
+	//check cycles before the fetch like translated code does
+	//this also avoids clobbering the fetched opcode if we need to sync
+	check_cycles_int(&opts->gen, address);
 	mov_ir(code, address, opts->gen.scratch1, SZ_W);
 	call(code, opts->read_8);
 	//opcode fetch M-cycles have one extra T-state
 	cycles(&opts->gen, 1);
-	//TODO: increment R
-	check_cycles_int(&opts->gen, address);
 	call(code, opts->gen.save_context);
 	mov_irdisp(code, address, opts->gen.context_reg, offsetof(z80_context, pc), SZ_W);
 	push_r(code, opts->gen.context_reg);
@@ -2994,11 +3076,12 @@ uint32_t z80_get_instruction_start(z80_context *context, uint32_t address)
 	return address;
 }
 
-//Technically unbounded due to redundant prefixes, but this is the max useful size
-#define Z80_MAX_INST_SIZE 4
-
 z80_context * z80_handle_code_write(uint32_t address, z80_context * context)
 {
+	if (context->options->gen.flags & Z80_OPT_INTERPRET) {
+		//interpreter stubs fetch from memory each time so there is nothing to invalidate
+		return context;
+	}
 	uint32_t inst_start = z80_get_instruction_start(context, address);
 	while (inst_start != INVALID_INSTRUCTION_START && (address - inst_start) < Z80_MAX_INST_SIZE) {
 		code_ptr dst = z80_get_native_address(context, inst_start);
@@ -3015,6 +3098,9 @@ z80_context * z80_handle_code_write(uint32_t address, z80_context * context)
 void z80_invalidate_code_range(z80_context *context, uint32_t start, uint32_t end)
 {
 	z80_options *opts = context->options;
+	if (opts->gen.flags & Z80_OPT_INTERPRET) {
+		return;
+	}
 	native_map_slot * native_code_map = opts->gen.native_code_map;
 	memmap_chunk const *mem_chunk = find_map_chunk(start, &opts->gen, 0, NULL);
 	if (mem_chunk) {
@@ -3155,8 +3241,10 @@ void translate_z80_stream(z80_context * context, uint32_t address)
 				jmp(&opts->gen.code, existing);
 				break;
 			}
-			uint8_t * encoded, *next;
-			encoded = get_native_pointer(address, (void **)context->mem_pointers, &opts->gen);
+			uint8_t * encoded = NULL, *next;
+			if (!(opts->gen.flags & Z80_OPT_INTERPRET)) {
+				encoded = get_native_pointer(address, (void **)context->mem_pointers, &opts->gen);
+			}
 			if (!encoded) {
 				code_info stub = z80_make_interp_stub(context, address);
 				z80_map_native_address(context, address, stub.cur, 1, stub.last - stub.cur);
@@ -3642,13 +3730,39 @@ void z80_run(z80_context * context, uint32_t target_cycle)
 	}
 }
 
+static void free_interp_cache(z80_options *opts)
+{
+	if (opts->interp_cache) {
+		for (uint32_t i = 0; i < Z80_INTERP_BUCKETS; i++)
+		{
+			z80_interp_entry *cur = opts->interp_cache[i];
+			while (cur)
+			{
+				z80_interp_entry *next = cur->next;
+				free(cur);
+				cur = next;
+			}
+		}
+		free(opts->interp_cache);
+		opts->interp_cache = NULL;
+	}
+}
+
 void z80_options_free(z80_options *opts)
 {
 	free(opts->gen.native_code_map);
 	free(opts->gen.ram_inst_sizes);
+	free_interp_cache(opts);
 	free(opts);
 }
 
+//Drops all translated code, the caller is responsible for rewinding opts->gen.code
+void z80_discard_translations(z80_options *opts)
+{
+	discard_translations(&opts->gen, NATIVE_MAP_CHUNKS);
+	free_interp_cache(opts);
+}
+
 void z80_assert_reset(z80_context * context, uint32_t cycle)
 {
 	z80_run(context, cycle);
@@ -10,6 +10,8 @@
 #include "serialize.h"
 
 #define ZNUM_MEM_AREAS 4
+//Interpret all code rather than translating it
+#define Z80_OPT_INTERPRET 1
 #ifdef Z80_LOG_ADDRESS
 #define ZMAX_NATIVE_SIZE 255
 #else
@@ -28,6 +30,7 @@ enum {
 };
 
 typedef struct z80_context z80_context;
+typedef struct z80_interp_entry z80_interp_entry;
 typedef void (*z80_ctx_fun)(z80_context * context);
 
 typedef struct {
@@ -46,6 +49,7 @@ typedef struct {
 	code_ptr        write_16_lowfirst;
 	code_ptr		read_io;
 	code_ptr		write_io;
+	z80_interp_entry **interp_cache;
 
 	uint32_t        flags;
 	int8_t          regs[Z80_UNUSED];
@@ -81,7 +85,6 @@ struct z80_context {
 	uint8_t           breakpoint_flags[(16 * 1024)/sizeof(uint8_t)];
 	uint8_t *         bp_handler;
 	uint8_t *         bp_stub;
-	uint8_t *         interp_code[256];
 	z80_ctx_fun       next_int_pulse;
 	uint8_t           reset;
 	uint8_t           busreq;
@@ -93,6 +96,7 @@ struct z80_context {
 void translate_z80_stream(z80_context * context, uint32_t address);
 void init_z80_opts(z80_options * options, memmap_chunk const * chunks, uint32_t num_chunks, memmap_chunk const * io_chunks, uint32_t num_io_chunks, uint32_t clock_divider, uint32_t io_address_mask);
 void z80_options_free(z80_options *opts);
+void z80_discard_translations(z80_options *opts);
 z80_context * init_z80_context(z80_options * options);
 code_ptr z80_get_native_address(z80_context * context, uint32_t address);
 code_ptr z80_get_native_address_trans(z80_context * context, uint32_t address);
@@ -55,6 +55,7 @@ int main(int argc, char ** argv)
 	z80_context *context;
 	char *fname = NULL;
 	uint8_t retranslate = 0;
+	uint8_t interpret = 0;
 	for (int i = 1; i < argc; i++)
 	{
 		if (argv[i][0] == '-') {
@@ -63,6 +64,9 @@ int main(int argc, char ** argv)
 			case 'r':
 				retranslate = 1;
 				break;
+			case 'i':
+				interpret = 1;
+				break;
 			default:
 				fprintf(stderr, "Unrecognized switch -%c\n", argv[i][1]);
 				exit(1);
@@ -90,6 +94,9 @@ int main(int argc, char ** argv)
 	}
 	fclose(f);
 	init_z80_opts(&opts, z80_map, 2, port_map, 1, 1, 0xFF);
+	if (interpret) {
+		opts.gen.flags |= Z80_OPT_INTERPRET;
+	}
 	context = init_z80_context(&opts);
 	//Z80 RAM
 	context->mem_pointers[0] = z80_ram;